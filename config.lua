@@ -30,6 +30,9 @@ render =
     antialias_samples = 4;                      -- Maximum depends and is limited by hardware capabilities.
     z_depth = 24;                               -- Maximum and recommended is 24.
     texture_border = 16;
+    texture_array = 0;                          -- Draw rooms with one texture array (1) instead of per atlas page textures (0).
+    transparency_mode = 0;                      -- 0 - one BSP of all transparency per frame, 1 - prebuilt rooms BSPs and sorted objects batches.
+    occlusion_culling = 0;                      -- Cull static meshes and entities hidden behind big room polygons by CPU depth buffer (1).
     fog_color = {r = 255, g = 255, b = 255};
 }
 
@@ -21,20 +21,24 @@ function door_init(id)   -- NORMAL doors only!
         entity_funcs[id].state_on = 0;
         entity_funcs[id].state_off = 1;
     end;
+    setEntityBoxBlocked(id, entity_funcs[id].state_off == 0);  -- closed door blocks creatures pathing
 
     entity_funcs[id].onActivate = function(object_id, activator_id)
         setEntityAnimStateHeavy(object_id, ANIM_TYPE_BASE, entity_funcs[object_id].state_on);
+        setEntityBoxBlocked(object_id, entity_funcs[object_id].state_on == 0);
         return ENTITY_TRIGGERING_ACTIVATED;
     end;
     
     entity_funcs[id].onDeactivate = function(object_id, activator_id)
         setEntityAnimStateHeavy(object_id, ANIM_TYPE_BASE, entity_funcs[object_id].state_off);
+        setEntityBoxBlocked(object_id, entity_funcs[object_id].state_off == 0);
         return ENTITY_TRIGGERING_DEACTIVATED;
     end;
     
     entity_funcs[id].onLoop = function(object_id, tick_state)
         if((tick_state == TICK_STOPPED) and (getEntityEvent(object_id) ~= 0)) then
             setEntityAnimStateHeavy(object_id, ANIM_TYPE_BASE, entity_funcs[object_id].state_off);
+            setEntityBoxBlocked(object_id, entity_funcs[object_id].state_off == 0);
             setEntityEvent(object_id, 0);
         end;
     end
@@ -1,6 +1,7 @@
 
 #include <stdlib.h>
 
+#include "core/system.h"
 #include "core/vmath.h"
 #include "core/console.h"
 #include "core/polygon.h"
@@ -21,6 +22,7 @@
 #include "engine_string.h"
 #include "game.h"
 #include "controls.h"
+#include "spatial_hash.h"
 
 void Character_Create(struct entity_s *ent)
 {
@@ -112,6 +114,14 @@ void Character_Create(struct entity_s *ent)
 
         ret->traversed_object = NULL;
 
+        ret->path.state = NAV_PATH_NONE;
+        ret->path.length = 0;
+        ret->path.next_request = NULL;
+        ret->ai_think_time = 0.0f;
+        vec3_set_zero(ret->ai_goal);
+        ret->ai_target_visible = 0x00;
+        ret->ai_has_goal = 0x00;
+
         ent->self->collision_group = COLLISION_GROUP_CHARACTERS;
         ent->self->collision_mask = COLLISION_GROUP_STATIC_ROOM | COLLISION_GROUP_STATIC_OBLECT | COLLISION_GROUP_KINEMATIC |
                                     COLLISION_GROUP_CHARACTERS | COLLISION_GROUP_DYNAMICS | COLLISION_GROUP_DYNAMICS_NI | COLLISION_GROUP_TRIGGERS;
@@ -131,6 +141,7 @@ void Character_Delete(struct entity_s *ent)
     }
 
     actor->ent = NULL;
+    Nav_CancelRequest(&actor->path);
     if(actor->hairs)
     {
         for(int i = 0; i < actor->hair_count; i++)
@@ -1608,7 +1619,7 @@ int Character_FindTraverse(struct entity_s *ch)
             if(cont->object_type == OBJECT_ENTITY)
             {
                 entity_p e = (entity_p)cont->object;
-                if((e->type_flags & ENTITY_TYPE_TRAVERSE) && OBB_OBB_Test(e->obb, ch->obb, 32.0f) && (fabs(e->transform[12 + 2] - ch->transform[12 + 2]) < 1.1f))
+                if((e->type_flags & ENTITY_TYPE_TRAVERSE) && OBB_OBB_Test(Entity_GetOBB(e), Entity_GetOBB(ch), 32.0f) && (fabs(e->transform[12 + 2] - ch->transform[12 + 2]) < 1.1f))
                 {
                     int oz = (ch->angles[0] + 45.0f) / 90.0f;
                     ch->angles[0] = oz * 90.0f;
@@ -1625,7 +1636,7 @@ int Character_FindTraverse(struct entity_s *ch)
         if(cont->object_type == OBJECT_ENTITY)
         {
             entity_p e = (entity_p)cont->object;
-            if((e->type_flags & ENTITY_TYPE_TRAVERSE) && OBB_OBB_Test(e->obb, ch->obb, 32.0f) && (fabs(e->transform[12 + 2] - ch->transform[12 + 2]) < 1.1f))
+            if((e->type_flags & ENTITY_TYPE_TRAVERSE) && OBB_OBB_Test(Entity_GetOBB(e), Entity_GetOBB(ch), 32.0f) && (fabs(e->transform[12 + 2] - ch->transform[12 + 2]) < 1.1f))
             {
                 int oz = (ch->angles[0] + 45.0f) / 90.0f;
                 ch->angles[0] = oz * 90.0f;
@@ -1647,10 +1658,10 @@ int Character_FindTraverse(struct entity_s *ch)
  */
 int Sector_AllowTraverse(struct room_sector_s *rs, float floor)
 {
-    float f0 = rs->floor_corners[0][2];
-    if((rs->floor_corners[0][2] != f0) || (rs->floor_corners[1][2] != f0) ||
-       (rs->floor_corners[2][2] != f0) || (rs->floor_corners[3][2] != f0) ||
-       (rs->floor_penetration_config != TR_PENETRATION_CONFIG_SOLID) ||
+    float f0 = rs->geometry->floor_corners[0][2];
+    if((rs->geometry->floor_corners[0][2] != f0) || (rs->geometry->floor_corners[1][2] != f0) ||
+       (rs->geometry->floor_corners[2][2] != f0) || (rs->geometry->floor_corners[3][2] != f0) ||
+       (rs->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_SOLID) ||
        (rs->ceiling - floor < TR_METERING_SECTORSIZE))
     {
         return 0x00;
@@ -1888,7 +1899,7 @@ void Character_UpdateParams(struct entity_s *ent)
         entity_p target = World_GetEntityByID(ent->character->target_id);
         if(target)
         {
-            Character_LookAt(ent, target->obb->centre);
+            Character_LookAt(ent, Entity_GetOBB(target)->centre);
         }
         else
         {
@@ -2030,7 +2041,7 @@ int Character_IsTargetAccessible(struct entity_s *character, struct entity_s *ta
         vec3_sub(dir, target->transform + 12, character->transform + 12);
         vec3_norm(dir, t);
         t = vec3_dot(character->transform + 4, dir);
-        ret = (t > 0.0f) && (!Physics_RayTest(&cs, character->obb->centre, target->obb->centre, character->self, COLLISION_FILTER_CHARACTER) || (cs.obj == target->self));
+        ret = (t > 0.0f) && (!Physics_RayTest(&cs, Entity_GetOBB(character)->centre, Entity_GetOBB(target)->centre, character->self, COLLISION_FILTER_CHARACTER) || (cs.obj == target->self));
     }
 
     return ret;
@@ -2040,33 +2051,72 @@ int Character_IsTargetAccessible(struct entity_s *character, struct entity_s *ta
 struct entity_s *Character_FindTarget(struct entity_s *ent)
 {
     entity_p ret = NULL;
-    float max_dot = 0.0f;
+    entity_p stack_candidates[CHARACTER_TARGET_MAX_CANDIDATES];
+    entity_p *candidates = stack_candidates;
+    float *dots;
+    float radius = 0.0f;
+    uint32_t count = 0;
+    uint32_t found;
     collision_result_t cs;
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
 
+    // query radius covers the farthest corner of the near rooms, so spatial query misses nothing that rooms test accepts
     for(int ri = -1; ri < ent->self->room->near_room_list_size; ++ri)
     {
         room_p r = (ri >= 0) ? (ent->self->room->near_room_list[ri]) : (ent->self->room);
-        for(engine_container_p cont = r->content->containers; cont; cont = cont->next)
+        float d[3];
+        for(int i = 0; i < 3; ++i)
         {
-            if(cont->object_type == OBJECT_ENTITY)
+            float d_min = fabsf(ent->transform[12 + i] - r->bb_min[i]);
+            float d_max = fabsf(ent->transform[12 + i] - r->bb_max[i]);
+            d[i] = (d_min > d_max) ? (d_min) : (d_max);
+        }
+        float dist = vec3_abs(d);
+        radius = (dist > radius) ? (dist) : (radius);
+    }
+
+    found = Spatial_QueryCone(ent->transform + 12, ent->transform + 4, 0.0f, radius,
+                              ENTITY_TYPE_ACTOR, ENTITY_STATE_ACTIVE, candidates, CHARACTER_TARGET_MAX_CANDIDATES);
+    if(found > CHARACTER_TARGET_MAX_CANDIDATES)
+    {
+        candidates = (entity_p*)Sys_GetTempMem(found * sizeof(entity_p));
+        found = Spatial_QueryCone(ent->transform + 12, ent->transform + 4, 0.0f, radius,
+                                  ENTITY_TYPE_ACTOR, ENTITY_STATE_ACTIVE, candidates, found);
+    }
+    dots = (float*)Sys_GetTempMem(found * sizeof(float));
+
+    // insertion sort by view angle over all candidates, so ray tests are done from the best one until the first visible
+    for(uint32_t i = 0; i < found; ++i)
+    {
+        entity_p target = candidates[i];
+        if((target != ent) && Room_IsInNearRoomsList(ent->self->room, target->self->room) &&
+           (!target->character || (target->character->parameters.param[PARAM_HEALTH] > 0.0f)))
+        {
+            float dir[3], t;
+            uint32_t j = count++;
+            vec3_sub(dir, target->transform + 12, ent->transform + 12);
+            vec3_norm(dir, t);
+            t = vec3_dot(ent->transform + 4, dir);
+            for(; (j > 0) && (dots[j - 1] < t); --j)
             {
-                entity_p target = (entity_p)cont->object;
-                if((target->type_flags & ENTITY_TYPE_ACTOR) && (target->state_flags & ENTITY_STATE_ACTIVE) &&
-                   (!target->character || (target->character->parameters.param[PARAM_HEALTH] > 0.0f)))
-                {
-                    float dir[3], t;
-                    vec3_sub(dir, target->transform + 12, ent->transform + 12);
-                    vec3_norm(dir, t);
-                    t = vec3_dot(ent->transform + 4, dir);
-                    if((t > max_dot) && (!Physics_RayTest(&cs, ent->obb->centre, target->obb->centre, ent->self, COLLISION_FILTER_CHARACTER) || (cs.obj == target->self)))
-                    {
-                        max_dot = t;
-                        ret = target;
-                    }
-                }
+                dots[j] = dots[j - 1];
+                candidates[j] = candidates[j - 1];
             }
+            dots[j] = t;
+            candidates[j] = target;
+        }
+    }
+
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        entity_p target = candidates[i];
+        if((dots[i] > 0.0f) && (!Physics_RayTest(&cs, Entity_GetOBB(ent)->centre, Entity_GetOBB(target)->centre, ent->self, COLLISION_FILTER_CHARACTER) || (cs.obj == target->self)))
+        {
+            ret = target;
+            break;
         }
     }
+    Sys_RollbackTempMem(temp_marker);
 
     return ret;
 }
@@ -2239,7 +2289,7 @@ int Character_DoOneHandWeponFrame(struct entity_s *ent, struct  ss_animation_s *
         {
             float targeting_limit[4] = {0.0f, 1.0f, 0.0f, 0.224f};
             ss_anim->targeting_flags = 0x0000;
-            SSBoneFrame_SetTarget(ss_anim, targeted_bone, target->obb->centre, bone_dir);
+            SSBoneFrame_SetTarget(ss_anim, targeted_bone, Entity_GetOBB(target)->centre, bone_dir);
             if(ss_anim->type == ANIM_TYPE_WEAPON_LH)
             {
                 vec3_RotateZ(targeting_limit, targeting_limit, 40.0f);
@@ -2531,7 +2581,7 @@ int Character_DoTwoHandWeponFrame(struct entity_s *ent, struct  ss_animation_s *
             const float bone_dir[3] = {0.0f, 1.0f, 0.0f};
             const float targeting_limit[4] = {0.0f, 1.0f, 0.0f, 0.624f};
             ss_anim->targeting_flags = 0x0000;
-            SSBoneFrame_SetTarget(ss_anim, ent->character->bone_torso, target->obb->centre, bone_dir);
+            SSBoneFrame_SetTarget(ss_anim, ent->character->bone_torso, Entity_GetOBB(target)->centre, bone_dir);
             SSBoneFrame_SetTargetingLimit(ss_anim, targeting_limit);
 
             if(!SSBoneFrame_CheckTargetBoneLimit(ent->bf, ss_anim))
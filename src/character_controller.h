@@ -7,6 +7,7 @@
 #include "physics/physics.h"
 #include "physics/hair.h"
 #include "physics/ragdoll.h"
+#include "navigation.h"
 
 /*------ Lara's model-------
              .=.
@@ -82,6 +83,7 @@
 #define MOVE_FLY                (12)
 
 #define CHARACTER_USE_COMPLEX_COLLISION         (1)
+#define CHARACTER_TARGET_MAX_CANDIDATES         (32)                            // on stack, more goes to temp memory
 
 // Lara's character behavior constants
 #define DEFAULT_MIN_STEP_UP_HEIGHT              (128.0)                         ///@FIXME: check original
@@ -302,6 +304,12 @@ typedef struct character_s
     struct climb_info_s         climb;
 
     struct entity_s            *traversed_object;
+
+    struct nav_path_s           path;                   // AI path to target, filled by navigation requests
+    float                       ai_think_time;          // time since last AI think, grows while job is deferred
+    float                       ai_goal[3];             // steering point: next path box centre
+    int8_t                      ai_target_visible;
+    int8_t                      ai_has_goal;
 }character_t, *character_p;
 
 void Character_Create(struct entity_s *ent);
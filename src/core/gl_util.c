@@ -270,6 +270,8 @@ PFNGLGENVERTEXARRAYSPROC                qglGenVertexArrays = NULL;
 PFNGLISVERTEXARRAYPROC                  qglIsVertexArray = NULL;
 
 PFNGLGENERATEMIPMAPEXTPROC              qglGenerateMipmap = NULL;
+PFNGLTEXIMAGE3DPROC                     qglTexImage3D = NULL;
+PFNGLTEXSUBIMAGE3DPROC                  qglTexSubImage3D = NULL;
 
 static char *engine_gl_ext_str = NULL;
 static GLuint whiteTexture = 0;
@@ -512,6 +514,8 @@ void InitGLExtFuncs()
         qglIsVertexArray = (PFNGLISVERTEXARRAYPROC)SDL_GL_GetProcAddress("glIsVertexArray");
 
         qglGenerateMipmap = (PFNGLGENERATEMIPMAPPROC)SDL_GL_GetProcAddress("glGenerateMipmap");
+        qglTexImage3D = (PFNGLTEXIMAGE3DPROC)SDL_GL_GetProcAddress("glTexImage3D");
+        qglTexSubImage3D = (PFNGLTEXSUBIMAGE3DPROC)SDL_GL_GetProcAddress("glTexSubImage3D");
     }
     else
     {
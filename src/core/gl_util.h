@@ -427,6 +427,8 @@ extern PFNGLGENVERTEXARRAYSPROC qglGenVertexArrays;
 extern PFNGLISVERTEXARRAYPROC qglIsVertexArray;
 
 extern PFNGLGENERATEMIPMAPPROC qglGenerateMipmap;
+extern PFNGLTEXIMAGE3DPROC qglTexImage3D;
+extern PFNGLTEXSUBIMAGE3DPROC qglTexSubImage3D;
 
 void InitGLExtFuncs();
 int IsGLExtensionSupported(const char *ext);
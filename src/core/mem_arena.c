@@ -0,0 +1,313 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_arena.h"
+
+
+#define MEM_ALIGN_SIZE(size, align) (((size) + (align) - 1) & ~((size_t)(align) - 1))
+#define MEM_BLOCK_HEADER_SIZE MEM_ALIGN_SIZE(sizeof(mem_arena_block_t), MEM_ARENA_ALIGN)
+
+/*
+ * LINEAR ARENA
+ */
+static mem_arena_block_p MemArena_NewBlock(mem_arena_p arena, size_t min_size)
+{
+    size_t size = (min_size > arena->block_size) ? (min_size) : (arena->block_size);
+    mem_arena_block_p block = (mem_arena_block_p)malloc(MEM_BLOCK_HEADER_SIZE + size);
+
+    if(block)
+    {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+        arena->allocated += size;
+        arena->blocks_count++;
+    }
+
+    return block;
+}
+
+
+void MemArena_Init(mem_arena_p arena, size_t block_size)
+{
+    arena->blocks = NULL;
+    arena->current = NULL;
+    arena->block_size = MEM_ALIGN_SIZE(block_size, MEM_ARENA_ALIGN);
+    arena->used = 0;
+    arena->allocated = 0;
+    arena->blocks_count = 0;
+    arena->allocs = 0;
+}
+
+
+void *MemArena_Alloc(mem_arena_p arena, size_t size)
+{
+    mem_arena_block_p block = arena->current;
+
+    size = MEM_ALIGN_SIZE(size, MEM_ARENA_ALIGN);
+    if(size == 0)
+    {
+        return NULL;
+    }
+
+    // blocks after current one are empty (they are kept by reset), so first fit is searched forward
+    while(block && (block->used + size > block->size))
+    {
+        block = block->next;
+    }
+
+    if(!block)
+    {
+        block = MemArena_NewBlock(arena, size);
+        if(!block)
+        {
+            return NULL;
+        }
+        if(arena->current)
+        {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        }
+        else
+        {
+            arena->blocks = block;
+        }
+    }
+
+    arena->current = block;
+    arena->used += size;
+    arena->allocs++;
+    block->used += size;
+
+    return (uint8_t*)block + MEM_BLOCK_HEADER_SIZE + block->used - size;
+}
+
+
+void *MemArena_Calloc(mem_arena_p arena, size_t count, size_t size)
+{
+    void *ret = MemArena_Alloc(arena, count * size);
+    if(ret)
+    {
+        memset(ret, 0, count * size);
+    }
+    return ret;
+}
+
+
+void MemArena_Reset(mem_arena_p arena)
+{
+    mem_arena_block_p block = (arena->blocks) ? (arena->blocks->next) : (NULL);
+
+    // oversized and extra blocks are returned to the system, so level peaks do not stay forever
+    while(block)
+    {
+        mem_arena_block_p next = block->next;
+        arena->allocated -= block->size;
+        arena->blocks_count--;
+        free(block);
+        block = next;
+    }
+
+    if(arena->blocks)
+    {
+        arena->blocks->next = NULL;
+        arena->blocks->used = 0;
+    }
+    arena->current = arena->blocks;
+    arena->used = 0;
+    arena->allocs = 0;
+}
+
+
+void MemArena_Destroy(mem_arena_p arena)
+{
+    MemArena_Reset(arena);
+    if(arena->blocks)
+    {
+        free(arena->blocks);
+    }
+    MemArena_Init(arena, arena->block_size);
+}
+
+
+/*
+ * ITEMS POOL
+ */
+void MemPool_Init(mem_pool_p pool, size_t item_size, uint32_t chunk_items)
+{
+    pool->item_size = item_size;
+    pool->chunk_items = chunk_items;
+    pool->used = 0;
+    pool->capacity = 0;
+    pool->chunks = NULL;
+    pool->free_items = NULL;
+}
+
+
+void *MemPool_Alloc(mem_pool_p pool)
+{
+    void *ret;
+    size_t item_size = MEM_ALIGN_SIZE((pool->item_size > sizeof(void*)) ? (pool->item_size) : (sizeof(void*)), MEM_ARENA_ALIGN);
+
+    if(!pool->free_items)
+    {
+        size_t header_size = MEM_ALIGN_SIZE(sizeof(mem_pool_chunk_t), MEM_ARENA_ALIGN);
+        mem_pool_chunk_p chunk = (mem_pool_chunk_p)malloc(header_size + item_size * pool->chunk_items);
+        if(!chunk)
+        {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->capacity += pool->chunk_items;
+        for(uint32_t i = pool->chunk_items; i > 0; i--)
+        {
+            void **item = (void**)((uint8_t*)chunk + header_size + (i - 1) * item_size);
+            *item = pool->free_items;
+            pool->free_items = item;
+        }
+    }
+
+    ret = pool->free_items;
+    pool->free_items = *((void**)ret);
+    pool->used++;
+    memset(ret, 0, pool->item_size);
+
+    return ret;
+}
+
+
+void MemPool_Free(mem_pool_p pool, void *item)
+{
+    if(item)
+    {
+        *((void**)item) = pool->free_items;
+        pool->free_items = item;
+        pool->used--;
+    }
+}
+
+
+void MemPool_Destroy(mem_pool_p pool)
+{
+    for(mem_pool_chunk_p chunk = pool->chunks; chunk;)
+    {
+        mem_pool_chunk_p next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    pool->chunks = NULL;
+    pool->free_items = NULL;
+    pool->used = 0;
+    pool->capacity = 0;
+}
+
+
+/*
+ * STACK ARENA
+ */
+void MemStack_Init(mem_stack_p stack, size_t size)
+{
+    size = MEM_ALIGN_SIZE(size, MEM_ARENA_ALIGN);
+    stack->buffer = (uint8_t*)malloc(size);
+    stack->size = (stack->buffer) ? (size) : (0);
+    stack->used = 0;
+    stack->overflow_used = 0;
+    stack->overflow_count = 0;
+    stack->overflow = NULL;
+    stack->high_water = 0;
+    stack->overflows = 0;
+}
+
+
+void *MemStack_Alloc(mem_stack_p stack, size_t size)
+{
+    void *ret = NULL;
+
+    size = MEM_ALIGN_SIZE(size, MEM_ARENA_ALIGN);
+    if(stack->used + size <= stack->size)
+    {
+        ret = stack->buffer + stack->used;
+        stack->used += size;
+    }
+    else
+    {
+        size_t header_size = MEM_ALIGN_SIZE(sizeof(mem_stack_overflow_t), MEM_ARENA_ALIGN);
+        mem_stack_overflow_p block = (mem_stack_overflow_p)malloc(header_size + size);
+        if(block)
+        {
+            block->prev = stack->overflow;
+            block->size = size;
+            stack->overflow = block;
+            stack->overflow_count++;
+            stack->overflow_used += size;
+            stack->overflows++;
+            ret = (uint8_t*)block + header_size;
+        }
+    }
+
+    if(stack->used + stack->overflow_used > stack->high_water)
+    {
+        stack->high_water = stack->used + stack->overflow_used;
+    }
+
+    return ret;
+}
+
+
+mem_stack_marker_t MemStack_GetMarker(mem_stack_p stack)
+{
+    mem_stack_marker_t ret;
+    ret.used = stack->used;
+    ret.overflow_count = stack->overflow_count;
+    return ret;
+}
+
+
+void MemStack_Rollback(mem_stack_p stack, mem_stack_marker_t marker)
+{
+    while(stack->overflow && (stack->overflow_count > marker.overflow_count))
+    {
+        mem_stack_overflow_p prev = stack->overflow->prev;
+        stack->overflow_used -= stack->overflow->size;
+        stack->overflow_count--;
+        free(stack->overflow);
+        stack->overflow = prev;
+    }
+
+    if(marker.used <= stack->used)
+    {
+        stack->used = marker.used;
+    }
+}
+
+
+void MemStack_Reset(mem_stack_p stack)
+{
+    mem_stack_marker_t marker = {0, 0};
+    MemStack_Rollback(stack, marker);
+
+    if(stack->high_water > stack->size)
+    {
+        size_t size = MEM_ALIGN_SIZE(stack->high_water, MEM_ARENA_ALIGN);
+        uint8_t *buffer = (uint8_t*)malloc(size);
+        if(buffer)
+        {
+            free(stack->buffer);
+            stack->buffer = buffer;
+            stack->size = size;
+        }
+    }
+}
+
+
+void MemStack_Destroy(mem_stack_p stack)
+{
+    mem_stack_marker_t marker = {0, 0};
+    MemStack_Rollback(stack, marker);
+    free(stack->buffer);
+    stack->buffer = NULL;
+    stack->size = 0;
+    stack->used = 0;
+}
@@ -0,0 +1,108 @@
+
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MEM_ARENA_ALIGN             (16)
+
+/*
+ * Linear arena: data is allocated by bumping pointer in big blocks and is
+ * released all together by reset; single objects can not be freed.
+ */
+typedef struct mem_arena_block_s
+{
+    struct mem_arena_block_s   *next;
+    size_t                      size;
+    size_t                      used;
+}mem_arena_block_t, *mem_arena_block_p;
+
+typedef struct mem_arena_s
+{
+    mem_arena_block_p           blocks;                                         // first block is kept on reset
+    mem_arena_block_p           current;
+    size_t                      block_size;
+    size_t                      used;
+    size_t                      allocated;
+    uint32_t                    blocks_count;
+    uint32_t                    allocs;
+}mem_arena_t, *mem_arena_p;
+
+/*
+ * Pool of fixed size items, grows by chunks; freed items are reused first.
+ */
+typedef struct mem_pool_chunk_s
+{
+    struct mem_pool_chunk_s    *next;
+}mem_pool_chunk_t, *mem_pool_chunk_p;
+
+typedef struct mem_pool_s
+{
+    size_t                      item_size;
+    uint32_t                    chunk_items;
+    uint32_t                    used;
+    uint32_t                    capacity;
+    mem_pool_chunk_p            chunks;
+    void                       *free_items;
+}mem_pool_t, *mem_pool_p;
+
+#define MEM_POOL_INIT(type, chunk_items) {sizeof(type), (chunk_items), 0, 0, NULL, NULL}
+
+/*
+ * Stack arena for short living data: allocations are released by rollback to
+ * a marker taken before them. When main buffer is exhausted, allocations go to
+ * heap overflow blocks (released by rollback too) and main buffer is grown to
+ * the high water mark on the next reset.
+ */
+typedef struct mem_stack_overflow_s
+{
+    struct mem_stack_overflow_s *prev;
+    size_t                      size;
+}mem_stack_overflow_t, *mem_stack_overflow_p;
+
+typedef struct mem_stack_marker_s
+{
+    size_t                      used;
+    uint32_t                    overflow_count;
+}mem_stack_marker_t, *mem_stack_marker_p;
+
+typedef struct mem_stack_s
+{
+    uint8_t                    *buffer;
+    size_t                      size;
+    size_t                      used;
+    size_t                      overflow_used;
+    uint32_t                    overflow_count;
+    mem_stack_overflow_p        overflow;                                       // last overflow block
+    size_t                      high_water;                                     // max used + overflow_used since init
+    uint32_t                    overflows;                                      // overflow blocks allocated since init
+}mem_stack_t, *mem_stack_p;
+
+void  MemArena_Init(mem_arena_p arena, size_t block_size);
+void *MemArena_Alloc(mem_arena_p arena, size_t size);
+void *MemArena_Calloc(mem_arena_p arena, size_t count, size_t size);
+void  MemArena_Reset(mem_arena_p arena);
+void  MemArena_Destroy(mem_arena_p arena);
+
+void  MemPool_Init(mem_pool_p pool, size_t item_size, uint32_t chunk_items);
+void *MemPool_Alloc(mem_pool_p pool);                                           // returns zeroed item
+void  MemPool_Free(mem_pool_p pool, void *item);
+void  MemPool_Destroy(mem_pool_p pool);
+
+void  MemStack_Init(mem_stack_p stack, size_t size);
+void *MemStack_Alloc(mem_stack_p stack, size_t size);
+mem_stack_marker_t MemStack_GetMarker(mem_stack_p stack);
+void  MemStack_Rollback(mem_stack_p stack, mem_stack_marker_t marker);
+void  MemStack_Reset(mem_stack_p stack);
+void  MemStack_Destroy(mem_stack_p stack);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif
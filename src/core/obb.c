@@ -10,6 +10,7 @@
 obb_p OBB_Create()
 {
     obb_p ret;
+    float zero[3];
 
     ret = (obb_p)malloc(sizeof(obb_t));
     for(int i = 0; i < 6; i++)
@@ -24,6 +25,8 @@ obb_p OBB_Create()
         Polygon_Resize(ret->polygons + i, 4);
     }
     ret->transform = NULL;
+    vec3_set_zero(zero);
+    OBB_Rebuild(ret, zero, zero);                                               // keep base data consistent for OBB_IsSame checks
 
     return ret;
 }
@@ -182,6 +185,20 @@ void OBB_Rebuild(obb_p obb, float bb_min[3], float bb_max[3])
 }
 
 
+int OBB_IsSame(obb_p obb, float bb_min[3], float bb_max[3])
+{
+    float centre[3], extent[3];
+
+    vec3_add(centre, bb_min, bb_max);
+    vec3_mul_scalar(centre, centre, 0.5);
+    vec3_sub(extent, bb_max, bb_min);
+    vec3_mul_scalar(extent, extent, 0.5);
+
+    return (centre[0] == obb->base_centre[0]) && (centre[1] == obb->base_centre[1]) && (centre[2] == obb->base_centre[2]) &&
+           (extent[0] == obb->extent[0]) && (extent[1] == obb->extent[1]) && (extent[2] == obb->extent[2]);
+}
+
+
 void OBB_Transform(obb_p obb)
 {
     if(obb->transform != NULL)
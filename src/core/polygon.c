@@ -220,6 +220,7 @@ int Polygon_IntersectPolygon(polygon_p p1, polygon_p p2)
 {
     float dist[3], dir[3], t, *result_buf, *result_v;
     vertex_p prev_v, curr_v;
+    mem_stack_marker_t temp_marker;
     size_t buf_size;
     char cnt = 0;
 
@@ -229,6 +230,7 @@ int Polygon_IntersectPolygon(polygon_p p1, polygon_p p2)
     }
 
     buf_size = (p1->vertex_count + p2->vertex_count) * 3 * sizeof(float);
+    temp_marker = Sys_GetTempMemMarker();
     result_buf = (float*)Sys_GetTempMem(buf_size);
     result_v = result_buf;
 
@@ -358,7 +360,7 @@ int Polygon_IntersectPolygon(polygon_p p1, polygon_p p2)
             break;
     };
 
-    Sys_ReturnTempMem(buf_size);
+    Sys_RollbackTempMem(temp_marker);
 
     if(dist[0] > 0)
     {
@@ -29,6 +29,7 @@ typedef struct vertex_s
     GLfloat         normal[4];
     GLfloat         color[4];
     GLfloat         tex_coord[2];
+    GLfloat         tex_page;                                                   // texture array layer, follows tex_coord
 } vertex_t, *vertex_p;
 
 
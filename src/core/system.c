@@ -23,9 +23,7 @@ screen_info_t           screen_info;
 
 extern lua_State       *engine_lua;
 
-static uint8_t         *engine_mem_buffer             = NULL;
-static size_t           engine_mem_buffer_size        = 0;
-static size_t           engine_mem_buffer_size_left   = 0;
+static mem_stack_t      engine_temp_mem;
 
 // =======================================================================
 // General routines
@@ -33,9 +31,7 @@ static size_t           engine_mem_buffer_size_left   = 0;
 
 void Sys_Init()
 {
-    engine_mem_buffer               = (uint8_t*)malloc(INIT_TEMP_MEM_SIZE);
-    engine_mem_buffer_size          = INIT_TEMP_MEM_SIZE;
-    engine_mem_buffer_size_left     = INIT_TEMP_MEM_SIZE;
+    MemStack_Init(&engine_temp_mem, INIT_TEMP_MEM_SIZE);
 }
 
 
@@ -56,47 +52,40 @@ void Sys_InitGlobals()
 
 void Sys_Destroy()
 {
-    if(engine_mem_buffer)
-    {
-        free(engine_mem_buffer);
-    }
-    engine_mem_buffer               = NULL;
-    engine_mem_buffer_size          = 0;
-    engine_mem_buffer_size_left     = 0;
+    MemStack_Destroy(&engine_temp_mem);
 }
 
 
 void *Sys_GetTempMem(size_t size)
 {
-    void *ret = NULL;
+    return MemStack_Alloc(&engine_temp_mem, size);
+}
 
-    if(engine_mem_buffer_size_left >= size)
-    {
-        ret = engine_mem_buffer + engine_mem_buffer_size - engine_mem_buffer_size_left;
-        engine_mem_buffer_size_left -= size;
-    }
-    else
-    {
-        engine_mem_buffer_size_left = engine_mem_buffer_size;                   // glitch generator, but not crash
-        ret = engine_mem_buffer;
-    }
 
-    return ret;
+mem_stack_marker_t Sys_GetTempMemMarker()
+{
+    return MemStack_GetMarker(&engine_temp_mem);
 }
 
 
-void Sys_ReturnTempMem(size_t size)
+void Sys_RollbackTempMem(mem_stack_marker_t marker)
 {
-    if(engine_mem_buffer_size_left + size <= engine_mem_buffer_size)
-    {
-        engine_mem_buffer_size_left += size;
-    }
+    MemStack_Rollback(&engine_temp_mem, marker);
 }
 
 
 void Sys_ResetTempMem()
 {
-    engine_mem_buffer_size_left = engine_mem_buffer_size;
+    MemStack_Reset(&engine_temp_mem);
+}
+
+
+void Sys_GetTempMemStats(size_t *used, size_t *size, size_t *high_water, uint32_t *overflows)
+{
+    *used = engine_temp_mem.used + engine_temp_mem.overflow_used;
+    *size = engine_temp_mem.size;
+    *high_water = engine_temp_mem.high_water;
+    *overflows = engine_temp_mem.overflows;
 }
 
 
@@ -10,6 +10,8 @@ extern "C" {
 #include <SDL2/SDL_platform.h>
 #include <SDL2/SDL_opengl.h>
 
+#include "mem_arena.h"
+
 #define SYS_LOG_FILENAME            "d_log.txt"
 
     
@@ -34,9 +36,16 @@ void Sys_Init();
 void Sys_InitGlobals();
 void Sys_Destroy();
 
+/*
+ * Main thread frame temporary memory; it is reset at the frame beginning,
+ * so data must not be kept across frames. Take marker before allocations and
+ * roll back to it when done. Worker jobs must use their own mem_stack_t.
+ */
 void *Sys_GetTempMem(size_t size);
-void Sys_ReturnTempMem(size_t size);
+mem_stack_marker_t Sys_GetTempMemMarker();
+void Sys_RollbackTempMem(mem_stack_marker_t marker);
 void Sys_ResetTempMem();
+void Sys_GetTempMemStats(size_t *used, size_t *size, size_t *high_water, uint32_t *overflows);
 
 float Sys_FloatTime(void);
 void Sys_Strtime(char *buf, size_t buf_size);
@@ -25,6 +25,9 @@ extern "C" {
 #include "core/gl_text.h"
 #include "render/camera.h"
 #include "render/render.h"
+#include "render/render_device.h"
+#include "render/render_queue.h"
+#include "render/frustum.h"
 #include "script/script.h"
 #include "physics/physics.h"
 #include "gui/gui.h"
@@ -42,6 +45,7 @@ extern "C" {
 #include "controls.h"
 #include "trigger.h"
 #include "character_controller.h"
+#include "spatial_hash.h"
 #include "render/bsp_tree.h"
 #include "render/shader_manager.h"
 #include "image.h"
@@ -93,6 +97,9 @@ engine_container_p Container_Create()
     ret = (engine_container_p)malloc(sizeof(engine_container_t));
     ret->collision_group = COLLISION_GROUP_KINEMATIC;
     ret->collision_mask = COLLISION_MASK_ALL;
+    ret->room = NULL;
+    ret->list_room = NULL;
+    ret->prev = NULL;
     ret->next = NULL;
     ret->object = NULL;
     ret->object_type = 0;
@@ -227,6 +234,7 @@ void Engine_Shutdown(int val)
     Gui_Destroy();
     Con_Destroy();
     GLText_Destroy();
+    SSPalette_Destroy();
     Sys_Destroy();
 
     /* no more renderings */
@@ -301,6 +309,7 @@ void Engine_Init_Pre()
      * Rendering activation may be done later. */
 
     Sys_Init();
+    SSPalette_Init(SS_PALETTE_SIZE);
     GLText_Init();
     Con_Init();
     Gameflow_Init();
@@ -886,6 +895,7 @@ void Engine_MainLoop()
         fps->style_id   = FONTSTYLE_MENU_TITLE;
 
         Sys_ResetTempMem();
+        SSPalette_BeginFrame();
         Engine_PollSDLEvents();
         if(screen_info.debug_view_state != debug_view_state_e::model_view)
         {
@@ -1151,6 +1161,12 @@ void ShowDebugInfo()
                     GLText_OutTextXY(30.0f, y += dy, "anim_next_anim = %03d, anim_next_frame = %03d", anim->next_anim->id, anim->next_frame);
                     GLText_OutTextXY(30.0f, y += dy, "posX = %f, posY = %f, posZ = %f", ent->transform[12], ent->transform[13], ent->transform[14]);
                 }
+                uint32_t bv_exact, bv_skipped, bv_rebuilds, bv_cached;
+                Entity_GetBVStats(&bv_exact, &bv_skipped, &bv_rebuilds, &bv_cached);
+                GLText_OutTextXY(30.0f, y += dy, "BV exact rebuilds = %d, skipped = %d, cached rebuilds = %d, cached hits = %d", bv_exact, bv_skipped, bv_rebuilds, bv_cached);
+                game_ai_stats_t ai_stats;
+                Game_GetAIStats(&ai_stats);
+                GLText_OutTextXY(30.0f, y += dy, "AI jobs = %d, thinks = %d, deferred = %d, paths = %d", ai_stats.jobs, ai_stats.thinks, ai_stats.deferred, ai_stats.path_requests);
             }
             break;
 
@@ -1208,6 +1224,9 @@ void ShowDebugInfo()
                         }
                     }
                 }
+                uint32_t trig_evaluated, trig_watched, trig_skipped;
+                Trigger_GetStats(&trig_evaluated, &trig_watched, &trig_skipped);
+                GLText_OutTextXY(30.0f, y += dy, "triggers: evaluated = %d, watched = %d, skipped = %d", trig_evaluated, trig_watched, trig_skipped);
             }
             break;
 
@@ -1215,6 +1234,12 @@ void ShowDebugInfo()
             {
                 entity_p ent = World_GetPlayer();
                 GLText_OutTextXY(30.0f, y += dy, "VIEW: Room objects");
+                game_room_pos_stats_t room_pos_stats;
+                Game_GetRoomPosStats(&room_pos_stats);
+                GLText_OutTextXY(30.0f, y += dy, "room pos: resolved = %d, room changes = %d, sector changes = %d", room_pos_stats.resolved, room_pos_stats.room_changes, room_pos_stats.sector_changes);
+                spatial_stats_t spatial_stats;
+                Spatial_GetStats(&spatial_stats);
+                GLText_OutTextXY(30.0f, y += dy, "spatial: relinks = %d, queries = %d, candidates = %d", spatial_stats.relinks, spatial_stats.queries, spatial_stats.candidates);
                 if(ent && ent->self->room)
                 {
                     room_p r = ent->self->room;
@@ -1251,10 +1276,59 @@ void ShowDebugInfo()
                 GLText_OutTextXY(30.0f, y += dy, "input polygons = %07d", renderer.dynamicBSP->GetInputPolygonsCount());
                 GLText_OutTextXY(30.0f, y += dy, "added polygons = %07d", renderer.dynamicBSP->GetAddedPolygonsCount());
             }
+            {
+                const render_device_stats_t *rs = renderer.GetDevice()->GetLastFrameStats();
+                GLText_OutTextXY(30.0f, y += dy, "draw calls = %d, elements = %d, client indices = %d bytes, states = %d", rs->draw_calls, rs->elements, rs->client_index_bytes, rs->state_changes);
+                GLText_OutTextXY(30.0f, y += dy, "programs = %d, textures = %d, buffers = %d, uniforms = %d, uploaded = %d", rs->program_changes, rs->texture_changes, rs->buffer_binds, rs->uniforms, rs->bytes_uploaded);
+                const render_queue_stats_t *qs = renderer.GetQueueStats();
+                GLText_OutTextXY(30.0f, y += dy, "queue: commands = %d, objects = %d, lights = %d, texture array = %s", qs->commands, qs->objects, qs->lights,
+                                 (renderer.settings.use_texture_array) ? ("on") : ("off"));
+                GLText_OutTextXY(30.0f, y += dy, "queue skin: jobs = %d, vertices = %d", qs->skin_jobs, qs->skin_vertices);
+                GLText_OutTextXY(30.0f, y += dy, "queue saved: programs = %d, textures = %d, uniforms = %d, buffers = %d",
+                                 (int)qs->unsorted_program_changes - (int)qs->program_changes, (int)qs->unsorted_texture_changes - (int)qs->texture_changes,
+                                 (int)qs->unsorted_uniform_sets - (int)qs->uniform_sets, (int)qs->unsorted_buffer_binds - (int)qs->buffer_binds);
+                render_visibility_stats_t vs;
+                renderer.GetVisibilityStats(&vs);
+                GLText_OutTextXY(30.0f, y += dy, "rooms = %d, visited = %d, portals queued = %d", vs.rooms_in_list, vs.rooms_visited, vs.portals_queued);
+                GLText_OutTextXY(30.0f, y += dy, "frustums = %d, merged = %d, dropped = %d", vs.frustums_generated, vs.frustums_merged, vs.frustums_dropped);
+                GLText_OutTextXY(30.0f, y += dy, "frustum buffer = %d / %d, high water = %d", vs.frustum_buffer_used, vs.frustum_buffer_size, vs.frustum_buffer_high_water);
+                GLText_OutTextXY(30.0f, y += dy, "obb tests = %d, rejected by planes = %d", vs.obb_tests, vs.obb_planes_rejected);
+                if(vs.obb_bench)
+                {
+                    GLText_OutTextXY(30.0f, y += dy, "obb planes bench: scalar = %d us, simd = %d us, mismatches = %d",
+                                     vs.obb_bench_scalar_us, vs.obb_bench_simd_us, vs.obb_bench_mismatches);
+                }
+                GLText_OutTextXY(30.0f, y += dy, "occlusion: triangles = %d, tests = %d, culled = %d, raster = %d us",
+                                 vs.occluder_triangles, vs.occlusion_tests, vs.occlusion_culled, vs.occlusion_time_us);
+                render_transparency_stats_t ts;
+                renderer.GetTransparencyStats(&ts);
+                GLText_OutTextXY(30.0f, y += dy, "transparency %s: polygons = %d, splits = %d, batches = %d, build = %d us",
+                                 (renderer.settings.transparency_mode == RENDER_TRANSPARENCY_BATCHES) ? ("batches") : ("dynamic BSP"), ts.polygons, ts.splits, ts.batches, ts.build_time_us);
+                GLText_OutTextXY(30.0f, y += dy, "prebuilt rooms BSP: polygons = %d, splits = %d", ts.prebuilt_polygons, ts.prebuilt_splits);
+                render_lighting_stats_t ls;
+                renderer.GetLightingStats(&ls);
+                GLText_OutTextXY(30.0f, y += dy, "lights: entities = %d, candidates = %d, bins cells = %d", ls.entities, ls.candidates, ls.bins_cells);
+            }
             break;
 
         case debug_view_state_e::model_view:
-            GLText_OutTextXY(30.0f, y += dy, "VIEW: MODELS ANIM (use o, p, [, ], w, s, space, v and arrows)");
+            {
+                uint32_t used, size, overflows;
+                GLText_OutTextXY(30.0f, y += dy, "VIEW: MODELS ANIM (use o, p, [, ], w, s, space, v and arrows)");
+                SSPalette_GetStats(&used, &size, &overflows);
+                GLText_OutTextXY(30.0f, y += dy, "bones palette = %d / %d, overflows = %d", used, size, overflows);
+                uint32_t anims_used, heap_allocs;
+                SSPool_GetStats(&used, &size, &anims_used, &heap_allocs);
+                GLText_OutTextXY(30.0f, y += dy, "bones pool = %d / %d, anims = %d, heap allocs = %d", used, size, anims_used, heap_allocs);
+                Entity_GetPoolStats(&used, &size);
+                GLText_OutTextXY(30.0f, y += dy, "entities pool = %d / %d", used, size);
+                size_t arena_used, arena_allocated;
+                World_GetArenaStats(&arena_used, &arena_allocated, &size, &heap_allocs);
+                GLText_OutTextXY(30.0f, y += dy, "level arena = %d / %d KB, blocks = %d, allocs = %d", (int)(arena_used / 1024), (int)(arena_allocated / 1024), size, heap_allocs);
+                size_t temp_high_water;
+                Sys_GetTempMemStats(&arena_used, &arena_allocated, &temp_high_water, &overflows);
+                GLText_OutTextXY(30.0f, y += dy, "temp mem = %d / %d KB, high water = %d KB, overflows = %d", (int)(arena_used / 1024), (int)(arena_allocated / 1024), (int)(temp_high_water / 1024), overflows);
+            }
             break;
     };
 }
@@ -1362,19 +1436,25 @@ bool Engine_LoadPCLevel(const char *name)
     int trv = VT_Level::get_PC_level_version(name);
     if(trv != TR_UNKNOWN)
     {
+        float load_time = Sys_FloatTime();
         VT_Level *tr_level = new VT_Level();
         tr_level->read_level(name, trv);
         tr_level->prepare_level();
         //tr_level->dump_textures();
 
         World_Open(tr_level);
+        load_time = Sys_FloatTime() - load_time;
 
         char buf[LEVEL_NAME_MAX_LEN] = {0x00};
         Engine_GetLevelName(buf, name);
 
+        size_t arena_used, arena_allocated;
+        uint32_t arena_blocks, arena_allocs;
+        World_GetArenaStats(&arena_used, &arena_allocated, &arena_blocks, &arena_allocs);
         Con_Notify("loaded PC level");
         Con_Notify("version = %d, map = \"%s\"", trv, buf);
         Con_Notify("rooms count = %d", tr_level->rooms_count);
+        Con_Notify("load time = %.3f s, level arena = %d KB in %d allocs", load_time, (int)(arena_used / 1024), arena_allocs);
 
         delete tr_level;
         return true;
@@ -1388,6 +1468,7 @@ int Engine_LoadMap(const char *name)
     size_t map_len = strlen(name);
     size_t base_len = strlen(base_path);
     size_t buf_len = map_len + base_len + 1;
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
     char *map_name_buf = (char*)Sys_GetTempMem(buf_len);
 
     strncpy(map_name_buf, base_path, buf_len);
@@ -1396,12 +1477,14 @@ int Engine_LoadMap(const char *name)
     if(!Sys_FileFound(map_name_buf, 0))
     {
         Con_Warning("file not found: \"%s\"", map_name_buf);
+        Sys_RollbackTempMem(temp_marker);
         return 0;
     }
 
     Game_StopFlyBy();
     engine_camera.current_room = NULL;
     renderer.ResetWorld(NULL, 0, NULL, 0);
+    SSBoneFrame_Clear(&test_model);                                             // level bone frames pool will be destroyed
     Gui_DrawLoadScreen(0);
 
     // it is needed for "not in the game" levels or correct saves loading.
@@ -1430,9 +1513,10 @@ int Engine_LoadMap(const char *name)
             break;*/
 
         default:
+            Sys_RollbackTempMem(temp_marker);
             return 0;
     }
-    Sys_ReturnTempMem(buf_len);
+    Sys_RollbackTempMem(temp_marker);
 
     if(is_success_load)
     {
@@ -1479,7 +1563,7 @@ int Engine_ExecCmd(char *ch)
             Con_AddLine("free_look - switch camera mode\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("r_crosshair - switch crosshair visibility\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("cam_distance - camera distance to actor\0", FONTSTYLE_CONSOLE_NOTIFY);
-            Con_AddLine("r_wireframe, r_portals, r_frustums, r_room_boxes, r_boxes, r_normals, r_skip_room, r_flyby, r_triggers - render modes\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("r_wireframe, r_portals, r_frustums, r_room_boxes, r_boxes, r_normals, r_skip_room, r_flyby, r_triggers, r_null_device, r_obb_bench - render modes\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("playsound(id) - play specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("stopsound(id) - stop specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("Watch out for case sensitive commands!\0", FONTSTYLE_CONSOLE_WARNING);
@@ -1575,6 +1659,20 @@ int Engine_ExecCmd(char *ch)
             renderer.r_flags ^= R_DRAW_FRUSTUMS;
             return 1;
         }
+        else if(!strcmp(token, "r_null_device"))
+        {
+            renderer.SetNullDevice(!renderer.IsNullDevice());
+            Con_Notify("null render device = %d", renderer.IsNullDevice());
+            return 1;
+        }
+        else if(!strcmp(token, "r_obb_bench"))
+        {
+            render_visibility_stats_t vs;
+            renderer.GetVisibilityStats(&vs);
+            Frustum_SetOBBBench(!vs.obb_bench);
+            Con_Notify("obb planes kernels bench = %d", !vs.obb_bench);
+            return 1;
+        }
         else if(!strcmp(token, "r_room_boxes"))
         {
             renderer.r_flags ^= R_DRAW_ROOMBOXES;
@@ -51,6 +51,8 @@ typedef struct engine_container_s
     int16_t                      collision_mask;
     void                        *object;
     struct room_s               *room;
+    struct room_s               *list_room;             // room which containers list holds that container, NULL if not listed
+    struct engine_container_s   *prev;
     struct engine_container_s   *next;
 }engine_container_t, *engine_container_p;
 
@@ -7,9 +7,11 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+#include "core/system.h"
 #include "core/console.h"
 #include "core/vmath.h"
 #include "core/obb.h"
+#include "core/mem_arena.h"
 #include "render/camera.h"
 #include "render/render.h"
 #include "script/script.h"
@@ -27,12 +29,29 @@ extern "C" {
 #include "gameflow.h"
 #include "inventory.h"
 #include "engine_string.h"
+#include "spatial_hash.h"
 
 
+static uint32_t entity_bv_exact_rebuilds = 0;
+static uint32_t entity_bv_exact_skipped = 0;                                    // dirty exact boxes, that nobody asked for
+static uint32_t entity_bv_cached_rebuilds = 0;
+static uint32_t entity_bv_cached_hits = 0;
+
+/*
+ * Entities are spawned and deleted at runtime, so their fixed size parts are taken from pools.
+ */
+static mem_pool_t entity_pool = MEM_POOL_INIT(entity_t, ENTITY_POOL_CHUNK_ITEMS);
+static mem_pool_t entity_container_pool = MEM_POOL_INIT(engine_container_t, ENTITY_POOL_CHUNK_ITEMS);
+static mem_pool_t entity_bone_frame_pool = MEM_POOL_INIT(ss_bone_frame_t, ENTITY_POOL_CHUNK_ITEMS);
+static mem_pool_t entity_activation_point_pool = MEM_POOL_INIT(activation_point_t, ENTITY_POOL_CHUNK_ITEMS);
+static float      entity_activation_extent = 0.0f;                             // max distance from entity to its activation area border
+
 entity_p Entity_Create()
 {
-    entity_p ret = (entity_p)calloc(1, sizeof(entity_t));
+    entity_p ret = (entity_p)MemPool_Alloc(&entity_pool);
 
+    ret->active_index = -1;
+    ret->spatial_bucket = SPATIAL_NO_BUCKET;
     ret->move_type = MOVE_ON_FLOOR;
     Mat4_E(ret->transform);
     ret->state_flags = ENTITY_STATE_ENABLED | ENTITY_STATE_ACTIVE | ENTITY_STATE_VISIBLE | ENTITY_STATE_COLLIDABLE;
@@ -43,7 +62,9 @@ entity_p Entity_Create()
     ret->trigger_layout = 0x00U;
     ret->timer = 0.0;
 
-    ret->self = (engine_container_p)malloc(sizeof(engine_container_t));
+    ret->self = (engine_container_p)MemPool_Alloc(&entity_container_pool);
+    ret->self->list_room = NULL;
+    ret->self->prev = NULL;
     ret->self->next = NULL;
     ret->self->object = ret;
     ret->self->object_type = OBJECT_ENTITY;
@@ -53,6 +74,9 @@ entity_p Entity_Create()
     ret->self->collision_mask = COLLISION_MASK_ALL;
     ret->obb = OBB_Create();
     ret->obb->transform = ret->transform;
+    ret->obb_dirty = 0x01;
+    ret->bv_obb = OBB_Create();
+    ret->bv_obb->transform = ret->transform;
 
     ret->no_fix_all = 0x00;
     ret->no_move = 0x00;
@@ -65,7 +89,7 @@ entity_p Entity_Create()
     ret->character = NULL;
     ret->current_sector = NULL;
 
-    ret->bf = (ss_bone_frame_p)malloc(sizeof(ss_bone_frame_t));
+    ret->bf = (ss_bone_frame_p)MemPool_Alloc(&entity_bone_frame_pool);
     SSBoneFrame_CreateFromModel(ret->bf, NULL);
     vec3_set_zero(ret->angles);
     vec3_set_zero(ret->speed);
@@ -82,7 +106,7 @@ void Entity_InitActivationPoint(entity_p entity)
 {
     if(!entity->activation_point)
     {
-        entity->activation_point = (activation_point_p)malloc(sizeof(activation_point_t));
+        entity->activation_point = (activation_point_p)MemPool_Alloc(&entity_activation_point_pool);
     }
 
     entity->activation_point->offset[0] = 0.0f;
@@ -94,6 +118,7 @@ void Entity_InitActivationPoint(entity_p entity)
     entity->activation_point->direction[1] = 1.0f;
     entity->activation_point->direction[2] = 0.0f;
     entity->activation_point->direction[3] = 0.70f;
+    Entity_UpdateActivationExtent(entity);
 }
 
 
@@ -101,6 +126,7 @@ void Entity_Delete(entity_p entity)
 {
     if(entity)
     {
+        Spatial_RemoveEntity(entity);
         if(entity->self->room && (entity != World_GetPlayer()))
         {
             Room_RemoveObject(entity->self->room, entity->self);
@@ -113,9 +139,16 @@ void Entity_Delete(entity_p entity)
             entity->obb = NULL;
         }
 
+        if(entity->bv_obb)
+        {
+            OBB_Clear(entity->bv_obb);
+            free(entity->bv_obb);
+            entity->bv_obb = NULL;
+        }
+
         if(entity->activation_point)
         {
-            free(entity->activation_point);
+            MemPool_Free(&entity_activation_point_pool, entity->activation_point);
         }
 
         Inventory_RemoveAllItems(&entity->inventory);
@@ -129,18 +162,18 @@ void Entity_Delete(entity_p entity)
 
         if(entity->self)
         {
-            free(entity->self);
+            MemPool_Free(&entity_container_pool, entity->self);
             entity->self = NULL;
         }
 
         if(entity->bf)
         {
             SSBoneFrame_Clear(entity->bf);
-            free(entity->bf);
+            MemPool_Free(&entity_bone_frame_pool, entity->bf);
             entity->bf = NULL;
         }
 
-        free(entity);
+        MemPool_Free(&entity_pool, entity);
     }
 }
 
@@ -151,6 +184,7 @@ void Entity_Enable(entity_p ent)
     {
         Entity_EnableCollision(ent);
         ent->state_flags |= ENTITY_STATE_ENABLED | ENTITY_STATE_ACTIVE | ENTITY_STATE_VISIBLE;
+        World_UpdateEntityActivity(ent);
     }
 }
 
@@ -161,6 +195,7 @@ void Entity_Disable(entity_p ent)
     {
         Entity_DisableCollision(ent);
         ent->state_flags = 0x0000;
+        World_UpdateEntityActivity(ent);
     }
 }
 
@@ -190,7 +225,11 @@ void Entity_DisableCollision(entity_p ent)
 }
 
 
-void Entity_UpdateRoomPos(entity_p ent)
+/*
+ * Read-only part of room position update: finds new room and sector for entity,
+ * but does not touch rooms containers, so it may be done for many entities at once.
+ */
+int Entity_ResolveRoomPos(entity_p ent, struct room_s **room, struct room_sector_s **sector)
 {
     float pos[3];
     room_p new_room;
@@ -204,31 +243,45 @@ void Entity_UpdateRoomPos(entity_p ent)
     }
     else
     {
-        float v[3];
-        vec3_add(v, ent->bf->bb_min, ent->bf->bb_max);
-        v[0] /= 2.0;
-        v[1] /= 2.0;
-        v[2] /= 2.0;
-        Mat4_vec3_mul_macro(pos, ent->transform, v);
+        // cached bounds centre: stable during animation, so room and trigger sector don't flicker
+        Mat4_vec3_mul_macro(pos, ent->transform, ent->bv_obb->base_centre);
     }
 
     new_room = World_FindRoomByPosCogerrence(pos, ent->self->room);
-    if(new_room)
+    new_sector = (new_room) ? (Room_GetSectorXYZ(new_room, pos)) : (NULL);
+    if(new_sector)
     {
-        new_sector = Room_GetSectorXYZ(new_room, pos);
-        if(new_room != new_sector->owner_room)
-        {
-            new_room = new_sector->owner_room;
-        }
+        *room = new_sector->owner_room;
+        *sector = new_sector;
+        return 1;
+    }
 
-        Entity_MoveToRoom(ent, new_room);
-        ent->last_sector = ent->current_sector;
+    return 0;
+}
 
-        if(ent->current_sector != new_sector)
-        {
-            ent->trigger_layout &= (uint8_t)(~ENTITY_TLAYOUT_SSTATUS);          // Reset sector status.
-            ent->current_sector = new_sector;
-        }
+
+void Entity_CommitRoomPos(entity_p ent, struct room_s *new_room, struct room_sector_s *new_sector)
+{
+    Entity_MoveToRoom(ent, new_room);
+    Spatial_UpdateEntity(ent);
+    ent->last_sector = ent->current_sector;
+
+    if(ent->current_sector != new_sector)
+    {
+        ent->trigger_layout &= (uint8_t)(~ENTITY_TLAYOUT_SSTATUS);              // Reset sector status.
+        ent->current_sector = new_sector;
+    }
+}
+
+
+void Entity_UpdateRoomPos(entity_p ent)
+{
+    room_p new_room;
+    room_sector_p new_sector;
+
+    if(Entity_ResolveRoomPos(ent, &new_room, &new_sector))
+    {
+        Entity_CommitRoomPos(ent, new_room, new_sector);
     }
 }
 
@@ -270,6 +323,11 @@ void Entity_UpdateTransform(entity_p entity)
 
 void Entity_UpdateRigidBody(struct entity_s *ent, int force)
 {
+    if(ent->spatial_bucket != SPATIAL_NO_BUCKET)
+    {
+        Spatial_UpdateEntity(ent);                                              // position may be set directly by scripts
+    }
+
     if(ent->type_flags & ENTITY_TYPE_DYNAMIC)
     {
         float tr[16];
@@ -1002,21 +1060,18 @@ void Entity_ProcessSector(entity_p ent)
 
         if(ent->character)
         {
+            uint32_t flags = (ent->current_sector->lowest_sector) ? (ent->current_sector->derived_flags) :
+                             (lowest_sector->flags | (highest_sector->flags & SECTOR_FLAG_CLIMB_CEILING));
             ent->character->height_info.walls_climb_dir  = 0;
-            ent->character->height_info.walls_climb_dir |= lowest_sector->flags & (SECTOR_FLAG_CLIMB_WEST  |
-                                                                                   SECTOR_FLAG_CLIMB_EAST  |
-                                                                                   SECTOR_FLAG_CLIMB_NORTH |
-                                                                                   SECTOR_FLAG_CLIMB_SOUTH );
+            ent->character->height_info.walls_climb_dir |= flags & (SECTOR_FLAG_CLIMB_WEST  |
+                                                                   SECTOR_FLAG_CLIMB_EAST  |
+                                                                   SECTOR_FLAG_CLIMB_NORTH |
+                                                                   SECTOR_FLAG_CLIMB_SOUTH );
 
             ent->character->height_info.walls_climb     = (ent->character->height_info.walls_climb_dir > 0);
-            ent->character->height_info.ceiling_climb   = 0x00;
-
-            if((highest_sector->flags & SECTOR_FLAG_CLIMB_CEILING) || (lowest_sector->flags & SECTOR_FLAG_CLIMB_CEILING))
-            {
-                ent->character->height_info.ceiling_climb = 0x01;
-            }
+            ent->character->height_info.ceiling_climb   = (flags & SECTOR_FLAG_CLIMB_CEILING) ? (0x01) : (0x00);
 
-            if(lowest_sector->flags & SECTOR_FLAG_DEATH)
+            if(flags & SECTOR_FLAG_DEATH)
             {
                 switch(ent->move_type)
                 {
@@ -1045,7 +1100,7 @@ void Entity_ProcessSector(entity_p ent)
         if(ent->type_flags & (ENTITY_TYPE_TRIGGER_ACTIVATOR | ENTITY_TYPE_HEAVYTRIGGER_ACTIVATOR))
         {
             // Look up trigger function table and run trigger if it exists.
-            Trigger_DoCommands(lowest_sector->trigger, ent);
+            Trigger_ProcessActivator(lowest_sector->trigger, ent);
         }
     }
 }
@@ -1213,10 +1268,75 @@ void Entity_RebuildBV(entity_p ent)
 {
     if(ent)
     {
-        //get current BB from animation
-        OBB_Rebuild(ent->obb, ent->bf->bb_min, ent->bf->bb_max);
+        skeletal_model_p model = ent->bf->animations.model;
+        float bb_min[3], bb_max[3];
+
+        // exact box from current animation BB is needed by few users (targeting, camera, traverse, debug), so it is lazy
+        if(ent->obb_dirty)
+        {
+            entity_bv_exact_skipped++;
+        }
+        ent->obb_dirty = 0x01;
+
+        /*
+         * broad phase box from cached conservative bounds: whole animation for
+         * simple objects, frames interval for characters; base shape changes
+         * only on switch. Ragdolls have no cached bounds - exact ones are used.
+         */
+        if((ent->type_flags & ENTITY_TYPE_DYNAMIC) || !model || !model->animations)
+        {
+            vec3_copy(bb_min, ent->bf->bb_min);
+            vec3_copy(bb_max, ent->bf->bb_max);
+        }
+        else if(ent->character || !SSBoneFrame_GetAnimBB(ent->bf, bb_min, bb_max))
+        {
+            SSBoneFrame_GetIntervalBB(ent->bf, bb_min, bb_max);
+        }
+
+        if(OBB_IsSame(ent->bv_obb, bb_min, bb_max))
+        {
+            entity_bv_cached_hits++;
+        }
+        else
+        {
+            OBB_Rebuild(ent->bv_obb, bb_min, bb_max);
+            entity_bv_cached_rebuilds++;
+        }
+        OBB_Transform(ent->bv_obb);
+    }
+}
+
+
+struct obb_s *Entity_GetOBB(entity_p ent)
+{
+    if(ent->obb_dirty)
+    {
+        if(!OBB_IsSame(ent->obb, ent->bf->bb_min, ent->bf->bb_max))
+        {
+            OBB_Rebuild(ent->obb, ent->bf->bb_min, ent->bf->bb_max);
+        }
         OBB_Transform(ent->obb);
+        ent->obb_dirty = 0x00;
+        entity_bv_exact_rebuilds++;
     }
+
+    return ent->obb;
+}
+
+
+void Entity_GetBVStats(uint32_t *exact_rebuilds, uint32_t *exact_skipped, uint32_t *cached_rebuilds, uint32_t *cached_hits)
+{
+    *exact_rebuilds = entity_bv_exact_rebuilds;
+    *exact_skipped = entity_bv_exact_skipped;
+    *cached_rebuilds = entity_bv_cached_rebuilds;
+    *cached_hits = entity_bv_cached_hits;
+}
+
+
+void Entity_GetPoolStats(uint32_t *used, uint32_t *capacity)
+{
+    *used = entity_pool.used;
+    *capacity = entity_pool.capacity;
 }
 
 
@@ -1301,45 +1421,72 @@ void Entity_RotateToTrigger(entity_p activator, entity_p trigger)
 }
 
 
+void Entity_UpdateActivationExtent(entity_p entity)
+{
+    if(entity->activation_point)
+    {
+        float extent = vec3_abs(entity->activation_point->offset) + fabsf(entity->activation_point->offset[3]);
+        entity_activation_extent = (extent > entity_activation_extent) ? (extent) : (entity_activation_extent);
+    }
+}
+
+
 void Entity_CheckActivators(struct entity_s *ent)
 {
     if(ent && ent->self->room)
     {
-        for(int room_index = -1; room_index < ent->self->room->near_room_list_size; ++room_index)
+        entity_p stack_candidates[ENTITY_ACTIVATORS_MAX_CANDIDATES];
+        entity_p *candidates = stack_candidates;
+        mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+        // interactive: activator inside trigger's activation sphere; pickable: point before activator in radius, with height limits
+        float dxy = entity_activation_extent + fabsf(ent->bf->bb_max[1]);
+        float dz = fabsf(ent->bf->bb_min[2]) + 72.0f;
+        float radius;
+        dz = (dz > fabsf(ent->bf->bb_max[2]) + 32.0f) ? (dz) : (fabsf(ent->bf->bb_max[2]) + 32.0f);
+        dz = (dz > entity_activation_extent) ? (dz) : (entity_activation_extent);
+        radius = sqrtf(dxy * dxy + dz * dz);
+
+        uint32_t count = Spatial_QueryRadius(ent->transform + 12, radius,
+                                             ENTITY_TYPE_INTERACTIVE | ENTITY_TYPE_PICKABLE, ENTITY_STATE_ENABLED,
+                                             candidates, ENTITY_ACTIVATORS_MAX_CANDIDATES);
+        if(count > ENTITY_ACTIVATORS_MAX_CANDIDATES)
+        {
+            candidates = (entity_p*)Sys_GetTempMem(count * sizeof(entity_p));
+            count = Spatial_QueryRadius(ent->transform + 12, radius,
+                                        ENTITY_TYPE_INTERACTIVE | ENTITY_TYPE_PICKABLE, ENTITY_STATE_ENABLED,
+                                        candidates, count);
+        }
+        for(uint32_t i = 0; i < count; ++i)
         {
-            room_p room = (room_index >= 0) ? (ent->self->room->near_room_list[room_index]) : (ent->self->room);
-            engine_container_p cont = room->content->containers;
-            for(; cont; cont = cont->next)
+            entity_p trigger = candidates[i];
+            if((trigger != ent) && trigger->activation_point && Room_IsInNearRoomsList(ent->self->room, trigger->self->room))
             {
-                if((cont->object_type == OBJECT_ENTITY) && cont->object && (cont->object != ent) && ((entity_p)cont->object)->activation_point)
+                if(trigger->type_flags & ENTITY_TYPE_INTERACTIVE)
                 {
-                    entity_p trigger = (entity_p)cont->object;
-                    if((trigger->type_flags & ENTITY_TYPE_INTERACTIVE) && (trigger->state_flags & ENTITY_STATE_ENABLED))
+                    if(Entity_CanTrigger(ent, trigger))
                     {
-                        if(Entity_CanTrigger(ent, trigger))
-                        {
-                            Script_ExecEntity(engine_lua, ENTITY_CALLBACK_ACTIVATE, trigger->id, ent->id);
-                        }
+                        Script_ExecEntity(engine_lua, ENTITY_CALLBACK_ACTIVATE, trigger->id, ent->id);
                     }
-                    else if((trigger->type_flags & ENTITY_TYPE_PICKABLE) && (trigger->state_flags & ENTITY_STATE_ENABLED) && (trigger->state_flags & ENTITY_STATE_VISIBLE))
+                }
+                else if(trigger->state_flags & ENTITY_STATE_VISIBLE)
+                {
+                    float ppos[3];
+                    float *v = trigger->transform + 12;
+                    float r = trigger->activation_point->offset[3];
+
+                    ppos[0] = ent->transform[12 + 0] + ent->transform[4 + 0] * ent->bf->bb_max[1];
+                    ppos[1] = ent->transform[12 + 1] + ent->transform[4 + 1] * ent->bf->bb_max[1];
+                    ppos[2] = ent->transform[12 + 2] + ent->transform[4 + 2] * ent->bf->bb_max[1];
+                    r *= r;
+                    if(((v[0] - ppos[0]) * (v[0] - ppos[0]) + (v[1] - ppos[1]) * (v[1] - ppos[1]) < r) &&
+                        (v[2] + 72.0 > ent->transform[12 + 2] + ent->bf->bb_min[2]) && (v[2] - 32.0 < ent->transform[12 + 2] + ent->bf->bb_max[2]))
                     {
-                        float ppos[3];
-                        float *v = trigger->transform + 12;
-                        float r = trigger->activation_point->offset[3];
-
-                        ppos[0] = ent->transform[12 + 0] + ent->transform[4 + 0] * ent->bf->bb_max[1];
-                        ppos[1] = ent->transform[12 + 1] + ent->transform[4 + 1] * ent->bf->bb_max[1];
-                        ppos[2] = ent->transform[12 + 2] + ent->transform[4 + 2] * ent->bf->bb_max[1];
-                        r *= r;
-                        if(((v[0] - ppos[0]) * (v[0] - ppos[0]) + (v[1] - ppos[1]) * (v[1] - ppos[1]) < r) &&
-                            (v[2] + 72.0 > ent->transform[12 + 2] + ent->bf->bb_min[2]) && (v[2] - 32.0 < ent->transform[12 + 2] + ent->bf->bb_max[2]))
-                        {
-                            Script_ExecEntity(engine_lua, ENTITY_CALLBACK_ACTIVATE, trigger->id, ent->id);
-                        }
+                        Script_ExecEntity(engine_lua, ENTITY_CALLBACK_ACTIVATE, trigger->id, ent->id);
                     }
                 }
             }
         }
+        Sys_RollbackTempMem(temp_marker);
     }
 }
 
@@ -1406,6 +1553,7 @@ int  Entity_Activate(struct entity_s *entity_object, struct entity_s *entity_act
         }
     }
 
+    World_UpdateEntityActivity(entity_object);                                  // script callbacks may enable or disable entity
     return activation_state;
 }
 
@@ -1435,6 +1583,7 @@ int  Entity_Deactivate(struct entity_s *entity_object, struct entity_s *entity_a
         }
     }
 
+    World_UpdateEntityActivity(entity_object);
     return activation_state;
 }
 
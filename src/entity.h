@@ -117,6 +117,9 @@ struct inventory_node_s;
 #define ENTITY_TLAYOUT_LOCK     0x40    // Activity lock
 #define ENTITY_TLAYOUT_SSTATUS  0x80    // Sector status
 
+#define ENTITY_ACTIVATORS_MAX_CANDIDATES        (64)        // on stack, more goes to temp memory
+#define ENTITY_POOL_CHUNK_ITEMS                 (64)
+
 #define WEAPON_STATE_HIDE                       (0x00)
 #define WEAPON_STATE_HIDE_TO_READY              (0x01)
 #define WEAPON_STATE_IDLE                       (0x02)
@@ -137,6 +140,7 @@ typedef struct activation_point_s
 typedef struct entity_s
 {
     uint32_t                            id;                     // Unique entity ID
+    int32_t                             active_index;           // index in world active entities list, -1 if not listed
     int32_t                             OCB;                    // Object code bit (since TR4)
     
     uint32_t                            trigger_layout : 8;     // Mask + once + event + sector status flags
@@ -145,6 +149,8 @@ typedef struct entity_s
     uint32_t                            no_fix_all : 1;         // only setPos and anim command can ignore that
     uint32_t                            no_move : 1;
     uint32_t                            no_anim_pos_autocorrection : 1;
+    uint32_t                            trigger_last_valid : 1; // trigger_last / trigger_key are set
+    uint32_t                            obb_dirty : 1;          // exact obb is rebuilt on demand by Entity_GetOBB
     
     float                               timer;              // Set by "timer" trigger field
     uint32_t                            callback_flags;     // information about scripts callbacks
@@ -162,12 +168,19 @@ typedef struct entity_s
     float                               angles[3];
     float                               transform[16] __attribute__((packed, aligned(16))); // GL transformation matrix
 
-    struct obb_s                       *obb;                // oriented bounding box
+    struct obb_s                       *obb;                // oriented bounding box, exact; read it through Entity_GetOBB
+    struct obb_s                       *bv_obb;             // cached conservative animation bounds: frustum and room broad phase only
 
     struct room_sector_s               *current_sector;
     struct room_sector_s               *last_sector;
+    struct trigger_header_s            *trigger_last;       // last evaluated trigger and activator state key after it
+    uint32_t                            trigger_key;
 
     struct engine_container_s          *self;
+    struct entity_s                    *spatial_next;       // spatial hash bucket links
+    struct entity_s                    *spatial_prev;
+    int32_t                             spatial_bucket;     // -1 if not in spatial hash
+    int32_t                             spatial_cell[2];
 
     struct activation_point_s          *activation_point;
     struct inventory_node_s            *inventory;
@@ -177,17 +190,23 @@ typedef struct entity_s
 
 entity_p Entity_Create();
 void Entity_InitActivationPoint(entity_p entity);
+void Entity_UpdateActivationExtent(entity_p entity);                            // call after activation point offset change
 void Entity_Delete(entity_p entity);
 void Entity_Enable(entity_p ent);
 void Entity_Disable(entity_p ent);
 void Entity_EnableCollision(entity_p ent);
 void Entity_DisableCollision(entity_p ent);
 void Entity_UpdateRoomPos(entity_p ent);
+int  Entity_ResolveRoomPos(entity_p ent, struct room_s **room, struct room_sector_s **sector);
+void Entity_CommitRoomPos(entity_p ent, struct room_s *new_room, struct room_sector_s *new_sector);
 void Entity_MoveToRoom(entity_p entity, struct room_s *new_room);
 
 void Entity_Frame(entity_p entity, float time);  // process frame + trying to change state
 
 void Entity_RebuildBV(entity_p ent);
+struct obb_s *Entity_GetOBB(entity_p ent);                                      // exact box, rebuilt only if dirty
+void Entity_GetBVStats(uint32_t *exact_rebuilds, uint32_t *exact_skipped, uint32_t *cached_rebuilds, uint32_t *cached_hits);
+void Entity_GetPoolStats(uint32_t *used, uint32_t *capacity);
 void Entity_UpdateTransform(entity_p entity);
 int  Entity_CanTrigger(entity_p activator, entity_p trigger);
 void Entity_RotateToTriggerZ(entity_p activator, entity_p trigger);
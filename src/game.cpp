@@ -31,9 +31,46 @@ extern "C" {
 #include "character_controller.h"
 #include "gameflow.h"
 #include "inventory.h"
+#include "navigation.h"
 
 extern lua_State *engine_lua;
 
+typedef struct game_ai_job_s
+{
+    struct entity_s    *ent;
+    float               priority;
+}game_ai_job_t, *game_ai_job_p;
+
+typedef struct game_room_pos_job_s
+{
+    struct entity_s        *ent;
+    uint32_t                ent_id;
+    struct room_s          *room;
+    struct room_sector_s   *sector;
+    int                     resolved;
+}game_room_pos_job_t, *game_room_pos_job_p;
+
+/*
+ * Entities room / sector resolution is done after all entities update:
+ * lookups are read-only, so they may be done in parallel; rooms containers
+ * changes are committed serially afterwards.
+ */
+static struct
+{
+    uint32_t                count;
+    uint32_t                size;
+    game_room_pos_job_p     jobs;
+    game_room_pos_stats_t   stats;
+} game_room_pos;
+
+static struct
+{
+    float               time_budget;
+    uint32_t            jobs_count;
+    game_ai_job_t       jobs[GAME_AI_MAX_JOBS];
+    game_ai_stats_t     stats;
+} game_ai;
+
 int Save_Entity(entity_p ent, void *data);
 
 int lua_mlook(lua_State * lua)
@@ -80,6 +117,18 @@ int lua_cam_distance(lua_State * lua)
 }
 
 
+int lua_ai_budget(lua_State * lua)
+{
+    if(lua_gettop(lua) > 0)
+    {
+        game_ai.time_budget = 0.001f * lua_tonumber(lua, 1);
+    }
+
+    Con_Printf("ai_budget = %.2f ms", 1000.0f * game_ai.time_budget);
+    return 0;
+}
+
+
 int lua_noclip(lua_State * lua)
 {
     if(lua_gettop(lua) == 0)
@@ -103,6 +152,7 @@ void Game_InitGlobals()
     control_states.free_look = 0;
     control_states.noclip = 0;
     control_states.cam_distance = 800.0;
+    game_ai.time_budget = GAME_AI_TIME_BUDGET;
 }
 
 
@@ -114,6 +164,7 @@ void Game_RegisterLuaFunctions(lua_State *lua)
         lua_register(lua, "freelook", lua_freelook);
         lua_register(lua, "cam_distance", lua_cam_distance);
         lua_register(lua, "noclip", lua_noclip);
+        lua_register(lua, "ai_budget", lua_ai_budget);
     }
 }
 
@@ -559,23 +610,235 @@ int Game_UpdateEntity(entity_p ent, void *data)
         }
         Entity_Frame(ent, engine_frame_time);
         Entity_UpdateRigidBody(ent, ent->character != NULL);
-        Entity_UpdateRoomPos(ent);
+        if(game_room_pos.count < game_room_pos.size)
+        {
+            game_room_pos.jobs[game_room_pos.count].ent = ent;
+            game_room_pos.jobs[game_room_pos.count].ent_id = ent->id;
+            game_room_pos.count++;
+        }
+        else
+        {
+            Entity_UpdateRoomPos(ent);
+        }
     }
 
     return 0;
 }
 
 
+static void Game_UpdateRoomPositions()
+{
+    game_room_pos_job_p job;
+
+    // resolve phase: no world changes here; skip entities deleted by scripts during update
+    job = game_room_pos.jobs;
+    for(uint32_t i = 0; i < game_room_pos.count; ++i, ++job)
+    {
+        job->resolved = (World_GetEntityByID(job->ent_id) == job->ent) &&
+                        Entity_ResolveRoomPos(job->ent, &job->room, &job->sector);
+    }
+
+    // commit phase: rooms containers and sector status changes
+    game_room_pos.stats.resolved = game_room_pos.count;
+    game_room_pos.stats.room_changes = 0;
+    game_room_pos.stats.sector_changes = 0;
+    job = game_room_pos.jobs;
+    for(uint32_t i = 0; i < game_room_pos.count; ++i, ++job)
+    {
+        if(job->resolved)
+        {
+            game_room_pos.stats.room_changes += (job->ent->self->room != job->room) ? (1) : (0);
+            game_room_pos.stats.sector_changes += (job->ent->current_sector != job->sector) ? (1) : (0);
+            Entity_CommitRoomPos(job->ent, job->room, job->sector);
+        }
+    }
+    game_room_pos.count = 0;
+}
+
+
+void Game_GetRoomPosStats(struct game_room_pos_stats_s *stats)
+{
+    *stats = game_room_pos.stats;
+}
+
+
+/*
+ * Cheap per frame part of AI: turns and moves creature to it's think
+ * results; visible target is followed by it's current position.
+ */
+static void Game_AISteer(entity_p ent, entity_p player)
+{
+    character_p ch = ent->character;
+    character_command_p cmd = &ch->cmd;
+    const float *goal = NULL;
+
+    cmd->rot[0] = 0;
+    cmd->move[0] = 0;
+    cmd->action = 0x00;
+    if(ch->ai_target_visible && player && (ch->target_id == player->id))
+    {
+        goal = player->transform + 12;
+    }
+    else if(ch->ai_has_goal)
+    {
+        goal = ch->ai_goal;
+    }
+
+    if(goal)
+    {
+        float dir[3], dist;
+        vec3_sub(dir, goal, ent->transform + 12);
+        dir[2] = 0.0f;
+        dist = vec3_abs(dir);
+        if(dist > GAME_AI_GOAL_RADIUS)
+        {
+            float side = vec3_dot(ent->transform + 0, dir);
+            cmd->rot[0] = (side > GAME_AI_TURN_TOLERANCE * dist) ? (-1) : ((side < -GAME_AI_TURN_TOLERANCE * dist) ? (1) : (0));
+            cmd->move[0] = (vec3_dot(ent->transform + 4, dir) > 0.0f) ? (1) : (0);
+        }
+        cmd->action = (ch->ai_target_visible && (dist < GAME_AI_ATTACK_DISTANCE)) ? (0x01) : (0x00);
+    }
+}
+
+
+static int Game_AIAddJob(entity_p ent, void *data)
+{
+    entity_p player = (entity_p)data;
+    if((ent != player) && ent->character && ent->self->room && (ent->self->room == ent->self->room->real_room) &&
+       (ent->state_flags & ENTITY_STATE_ACTIVE) && (ent->character->parameters.param[PARAM_HEALTH] > 0.0f))
+    {
+        character_p ch = ent->character;
+        float period = GAME_AI_THINK_PERIOD;
+
+        Game_AISteer(ent, player);
+
+        game_ai.stats.jobs++;
+        ch->ai_think_time += engine_frame_time;
+        if(player)
+        {
+            period *= 1.0f + vec3_dist(ent->transform + 12, player->transform + 12) / GAME_AI_FAR_DISTANCE;
+        }
+        if(!ent->self->room->is_in_r_list)
+        {
+            period *= GAME_AI_HIDDEN_PERIOD_MULT;
+        }
+
+        // priority >= 1.0 means job is due; starved jobs rise above the fresh ones
+        if((ch->ai_think_time >= period) && (game_ai.jobs_count < GAME_AI_MAX_JOBS))
+        {
+            game_ai.jobs[game_ai.jobs_count].ent = ent;
+            game_ai.jobs[game_ai.jobs_count].priority = ch->ai_think_time / period;
+            game_ai.jobs_count++;
+        }
+    }
+
+    return 0;
+}
+
+
+static int Game_AIJobsCompare(const void *a, const void *b)
+{
+    float pa = ((const game_ai_job_t*)a)->priority;
+    float pb = ((const game_ai_job_t*)b)->priority;
+    return (pa < pb) ? (1) : ((pa > pb) ? (-1) : (0));
+}
+
+
+/*
+ * Creatures are hostile to the player only: player is acquired when seen and
+ * kept while it is visible or reachable through creature's zone; out of
+ * sight creature follows the path boxes.
+ */
+static void Game_AIThink(entity_p ent, entity_p player)
+{
+    character_p ch = ent->character;
+    uint16_t zone_type = ((ent->move_type == MOVE_UNDERWATER) || (ent->move_type == MOVE_FLY)) ? (NAV_ZONE_FLY) : (NAV_ZONE_GROUND_1);
+    uint16_t from_box = Nav_GetBoxByPos(ent->transform + 12);
+    uint16_t to_box = NAV_NO_BOX;
+    entity_p target = NULL;
+
+    ch->ai_think_time = 0.0f;
+    ch->ai_target_visible = 0x00;
+    ch->ai_has_goal = 0x00;
+    if(player && player->character && (player->character->parameters.param[PARAM_HEALTH] > 0.0f) &&
+       (player->state_flags & ENTITY_STATE_ACTIVE))
+    {
+        to_box = Nav_GetBoxByPos(player->transform + 12);
+        if(ch->target_id == player->id)
+        {
+            ch->ai_target_visible = Character_IsTargetAccessible(ent, player);
+            target = (ch->ai_target_visible || Nav_IsReachable(from_box, to_box, zone_type)) ? (player) : (NULL);
+        }
+        else if(Room_IsInNearRoomsList(ent->self->room, player->self->room) && Character_IsTargetAccessible(ent, player))
+        {
+            ch->ai_target_visible = 0x01;
+            target = player;
+        }
+    }
+
+    if(!target)
+    {
+        ch->ai_target_visible = 0x00;
+        ch->target_id = ENTITY_ID_NONE;
+        Nav_CancelRequest(&ch->path);
+        ch->path.state = NAV_PATH_NONE;
+        return;
+    }
+
+    ch->target_id = target->id;
+    if(ch->ai_target_visible || (ch->path.state == NAV_PATH_PENDING))
+    {
+        return;                                                                 // steered to target directly or path is on the way
+    }
+
+    ch->ai_has_goal = Nav_GetPathWaypoint(&ch->path, from_box, ch->ai_goal);
+    if((from_box != NAV_NO_BOX) && (to_box != NAV_NO_BOX) &&
+       ((ch->path.state == NAV_PATH_NONE) || (ch->path.to_box != to_box) ||
+        ((ch->path.state == NAV_PATH_READY) && !ch->ai_has_goal) ||
+        ((ch->path.state == NAV_PATH_FAILED) && (ch->path.from_box != from_box))))
+    {
+        Nav_RequestPath(&ch->path, from_box, to_box, zone_type);
+        game_ai.stats.path_requests++;
+    }
+}
+
+
 void Game_UpdateAI()
 {
-    entity_p ent = NULL;
-    //for(ALL CHARACTERS, EXCEPT PLAYER)
+    entity_p player = World_GetPlayer();
+    float time_start = Sys_FloatTime();
+
+    game_ai.jobs_count = 0;
+    game_ai.stats.jobs = 0;
+    game_ai.stats.thinks = 0;
+    game_ai.stats.deferred = 0;
+    game_ai.stats.path_requests = 0;
+    World_IterateActiveEntities(Game_AIAddJob, player);
+
+    if(game_ai.jobs_count > 1)
     {
-        if(ent)
+        qsort(game_ai.jobs, game_ai.jobs_count, sizeof(game_ai_job_t), Game_AIJobsCompare);
+    }
+
+    for(uint32_t i = 0; i < game_ai.jobs_count; ++i)
+    {
+        // at least one job per frame, so nobody starves with a tiny budget
+        if((i > 0) && (Sys_FloatTime() - time_start > game_ai.time_budget))
         {
-            // UPDATE AI commands
+            game_ai.stats.deferred = game_ai.jobs_count - i;
+            break;
         }
+        Game_AIThink(game_ai.jobs[i].ent, player);
+        game_ai.stats.thinks++;
     }
+
+    Nav_ProcessRequests(GAME_AI_PATHING_TIME_LIMIT);
+}
+
+
+void Game_GetAIStats(struct game_ai_stats_s *stats)
+{
+    *stats = game_ai.stats;
 }
 
 
@@ -605,6 +868,7 @@ void Game_Frame(float time)
     }
 
     // In game mode
+    Trigger_ResetStats();
     Script_DoTasks(engine_lua, time);
     Game_UpdateAI();
 
@@ -655,7 +919,7 @@ void Game_Frame(float time)
                 entity_p target = World_GetEntityByID(engine_camera_state.target_id);
                 if(target)
                 {
-                    Character_LookAt(player, target->obb->centre);
+                    Character_LookAt(player, Entity_GetOBB(target)->centre);
                 }
             }
             else
@@ -665,7 +929,15 @@ void Game_Frame(float time)
         }
     }
 
-    World_IterateAllEntities(Game_UpdateEntity, NULL);
+    uint32_t active_count = World_GetActiveEntitiesCount();
+    if(active_count > game_room_pos.size)
+    {
+        game_room_pos.size = active_count + 64;
+        game_room_pos.jobs = (game_room_pos_job_p)realloc(game_room_pos.jobs, game_room_pos.size * sizeof(game_room_pos_job_t));
+    }
+    game_room_pos.count = 0;
+    World_IterateActiveEntities(Game_UpdateEntity, NULL);
+    Game_UpdateRoomPositions();
 
     Physics_StepSimulation(time);
 
@@ -10,6 +10,38 @@
 
 #define GAME_LOGIC_REFRESH_INTERVAL (1.0 / 60.0)
 
+// Time limit for queued AI path requests per frame; the rest wait for the next one.
+#define GAME_AI_PATHING_TIME_LIMIT  (0.002)
+
+// AI scheduler: expensive thinking (target search, line of sight, path requests)
+// runs for the most urgent characters until the frame budget is spent.
+// Think period grows with distance to the player and for not rendered rooms.
+#define GAME_AI_TIME_BUDGET         (0.003)
+#define GAME_AI_THINK_PERIOD        (0.1)
+#define GAME_AI_FAR_DISTANCE        (8192.0)
+#define GAME_AI_HIDDEN_PERIOD_MULT  (4.0)
+#define GAME_AI_MAX_JOBS            (256)
+// Steering between thinks: creature walks to it's goal (visible player or the
+// next path box centre) and attacks the player when it is closer than that.
+#define GAME_AI_GOAL_RADIUS         (256.0)
+#define GAME_AI_ATTACK_DISTANCE     (512.0)
+#define GAME_AI_TURN_TOLERANCE      (0.1)                   // sin of heading error that needs no turn
+
+typedef struct game_ai_stats_s
+{
+    uint32_t    jobs;                       // active AI characters in this frame
+    uint32_t    thinks;                     // jobs processed in this frame
+    uint32_t    deferred;                   // due jobs moved to the next frames by budget
+    uint32_t    path_requests;
+}game_ai_stats_t, *game_ai_stats_p;
+
+typedef struct game_room_pos_stats_s
+{
+    uint32_t    resolved;                   // entities resolved in last frame
+    uint32_t    room_changes;
+    uint32_t    sector_changes;
+}game_room_pos_stats_t, *game_room_pos_stats_p;
+
 struct lua_State;
 struct camera_s;
 struct entity_s;
@@ -27,6 +59,8 @@ void Game_LevelTransition(uint16_t level_index);
 void Game_ApplyControls(struct entity_s *ent);
 
 void Game_UpdateAI();
+void Game_GetAIStats(struct game_ai_stats_s *stats);
+void Game_GetRoomPosStats(struct game_room_pos_stats_s *stats);
 
 void Game_PlayFlyBy(uint32_t sequence_id, int once);
 void Game_SetCameraTarget(uint32_t entity_id, float timer);
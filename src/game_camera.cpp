@@ -173,7 +173,7 @@ void Cam_FollowEntity(struct camera_s *cam, struct camera_state_s *cam_state, st
 
     if((ent->character != NULL) && (ent->character->cam_follow_center > 0))
     {
-        vec3_copy(cam_pos, ent->obb->centre);
+        vec3_copy(cam_pos, Entity_GetOBB(ent)->centre);
         ent->character->cam_follow_center--;
     }
     else
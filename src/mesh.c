@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "core/gl_util.h"
 #include "core/vmath.h"
@@ -8,9 +9,18 @@
 
 
 void BaseMesh_GenVBO(struct base_mesh_s *mesh);
+GLuint BaseMesh_GenFacesEBO(mesh_face_p faces, uint32_t faces_count, uint32_t vertex_count, GLenum *elements_type);
 void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p);
 void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index, struct polygon_s *p);
 
+/*
+ * Faces generation texture array: polygons with one of the page textures
+ * are moved to the array texture, page index goes to the vertices.
+ */
+static GLuint           mesh_array_texture = 0;
+static const GLuint    *mesh_array_pages = NULL;
+static uint32_t         mesh_array_pages_count = 0;
+
 void BaseMesh_Clear(base_mesh_p mesh)
 {
     if(qglIsBufferARB(mesh->vbo_vertex_array))
@@ -31,6 +41,18 @@ void BaseMesh_Clear(base_mesh_p mesh)
         mesh->vbo_animated_texcoord_array = 0;
     }
 
+    if(qglIsBufferARB(mesh->vbo_index_array))
+    {
+        qglDeleteBuffersARB(1, &mesh->vbo_index_array);
+        mesh->vbo_index_array = 0;
+    }
+
+    if(qglIsBufferARB(mesh->vbo_animated_index_array))
+    {
+        qglDeleteBuffersARB(1, &mesh->vbo_animated_index_array);
+        mesh->vbo_animated_index_array = 0;
+    }
+
     mesh->transparency_polygons = NULL;
     mesh->animated_polygons = NULL;
     
@@ -144,11 +166,69 @@ void BaseMesh_FindBB(base_mesh_p mesh)
 }
 
 
+/**
+ * Packs all faces elements into one element buffer: every face becomes one
+ * range with byte offset, 16 bit indices are used when vertices count allows.
+ * Client side elements are freed.
+ */
+GLuint BaseMesh_GenFacesEBO(mesh_face_p faces, uint32_t faces_count, uint32_t vertex_count, GLenum *elements_type)
+{
+    GLuint ret = 0;
+    uint32_t elements_count = 0;
+    size_t element_size;
+    uint8_t *buf, *dst;
+
+    *elements_type = (vertex_count <= 0xFFFF) ? (GL_UNSIGNED_SHORT) : (GL_UNSIGNED_INT);
+    element_size = (*elements_type == GL_UNSIGNED_SHORT) ? (sizeof(GLushort)) : (sizeof(GLuint));
+    for(uint32_t i = 0; i < faces_count; i++)
+    {
+        elements_count += faces[i].elements_count;
+    }
+
+    if(elements_count == 0)
+    {
+        return 0;
+    }
+
+    buf = (uint8_t*)malloc(elements_count * element_size);
+    dst = buf;
+    for(uint32_t i = 0; i < faces_count; i++)
+    {
+        mesh_face_p face = faces + i;
+        face->elements_offset = dst - buf;
+        if(*elements_type == GL_UNSIGNED_SHORT)
+        {
+            GLushort *d = (GLushort*)dst;
+            for(uint32_t j = 0; j < face->elements_count; j++)
+            {
+                d[j] = face->elements[j];
+            }
+        }
+        else
+        {
+            memcpy(dst, face->elements, face->elements_count * sizeof(GLuint));
+        }
+        dst += face->elements_count * element_size;
+        free(face->elements);
+        face->elements = NULL;
+    }
+
+    qglGenBuffersARB(1, &ret);
+    qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, ret);
+    qglBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, elements_count * element_size, buf, GL_STATIC_DRAW_ARB);
+    free(buf);
+
+    return ret;
+}
+
+
 void BaseMesh_GenVBO(struct base_mesh_s *mesh)
 {
     mesh->vbo_vertex_array = 0;
     mesh->vbo_animated_vertex_array = 0;
     mesh->vbo_animated_texcoord_array = 0;
+    mesh->vbo_index_array = 0;
+    mesh->vbo_animated_index_array = 0;
     
     /// now, begin VBO filling!
     qglGenBuffersARB(1, &mesh->vbo_vertex_array);
@@ -159,6 +239,7 @@ void BaseMesh_GenVBO(struct base_mesh_s *mesh)
 
     qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
     qglBufferDataARB(GL_ARRAY_BUFFER_ARB, mesh->vertex_count * sizeof(vertex_t), mesh->vertices, GL_STATIC_DRAW_ARB);
+    mesh->vbo_index_array = BaseMesh_GenFacesEBO(mesh->faces, mesh->faces_count, mesh->vertex_count, &mesh->elements_type);
 
     // Now for animated polygons, if any
     if(mesh->animated_polygons)
@@ -173,6 +254,7 @@ void BaseMesh_GenVBO(struct base_mesh_s *mesh)
         qglGenBuffersARB(1, &mesh->vbo_animated_texcoord_array);
         qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
         qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
+        mesh->vbo_animated_index_array = BaseMesh_GenFacesEBO(mesh->animated_faces, mesh->animated_faces_count, mesh->animated_vertex_count, &mesh->animated_elements_type);
     }
     qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
     qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
@@ -190,7 +272,7 @@ uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex)
     for(vertex_index = 0; vertex_index < mesh->vertex_count; vertex_index++, v++)
     {
         if(v->position[0] == vertex->position[0] && v->position[1] == vertex->position[1] && v->position[2] == vertex->position[2] &&
-           v->tex_coord[0] == vertex->tex_coord[0] && v->tex_coord[1] == vertex->tex_coord[1])
+           v->tex_coord[0] == vertex->tex_coord[0] && v->tex_coord[1] == vertex->tex_coord[1] && v->tex_page == vertex->tex_page)
             ///@QUESTION: color check?
         {
             return vertex_index;
@@ -207,6 +289,7 @@ uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex)
     vec4_copy(v->color, vertex->color);
     v->tex_coord[0] = vertex->tex_coord[0];
     v->tex_coord[1] = vertex->tex_coord[1];
+    v->tex_page = vertex->tex_page;
 
     return vertex_index;
 }
@@ -232,15 +315,34 @@ void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p)
     mesh_face_p current_face = NULL;
     uint32_t add_elements_count = (p->vertex_count - 2) * 3;
     GLuint *current_index;
+    GLuint texture = p->texture_index;
+    GLenum target = GL_TEXTURE_2D;
+    GLfloat page = 0.0f;
     
     if (p->double_side)
     {
         add_elements_count *= 2;
     }
+
+    for(uint32_t i = 0; i < mesh_array_pages_count; i++)
+    {
+        if(mesh_array_pages[i] == p->texture_index)
+        {
+            texture = mesh_array_texture;
+            target = GL_TEXTURE_2D_ARRAY;
+            page = (GLfloat)i;
+            break;
+        }
+    }
+
+    for(uint16_t j = 0; j < p->vertex_count; j++)
+    {
+        p->vertices[j].tex_page = page;
+    }
     
     for(uint32_t i = 0; i < mesh->faces_count; i++)
     {
-        if(mesh->faces[i].texture_index == p->texture_index)
+        if(mesh->faces[i].texture_index == texture)
         {
             current_face = mesh->faces + i;
             break;
@@ -254,7 +356,9 @@ void BaseMesh_AddPolygonToFaces(base_mesh_p mesh, struct polygon_s *p)
         mesh->faces_count++;
         current_face->elements = NULL;
         current_face->elements_count = 0;
-        current_face->texture_index = p->texture_index;
+        current_face->elements_offset = 0;
+        current_face->texture_index = texture;
+        current_face->texture_target = target;
     }
     
     current_face->elements = (GLuint *)realloc(current_face->elements, (current_face->elements_count + add_elements_count) * sizeof(GLuint));
@@ -312,7 +416,9 @@ void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index
         mesh->animated_faces_count++;
         current_face->elements = NULL;
         current_face->elements_count = 0;
+        current_face->elements_offset = 0;
         current_face->texture_index = p->texture_index;
+        current_face->texture_target = GL_TEXTURE_2D;
     }
     
     current_face->elements = (GLuint *)realloc(current_face->elements, (current_face->elements_count + add_elements_count) * sizeof(GLuint));
@@ -350,6 +456,18 @@ void BaseMesh_AddAnimatedPolygonToFaces(base_mesh_p mesh, uint32_t *vertex_index
 }
 
 
+/**
+ * While array texture is set, generated faces with page textures refer to it
+ * instead: all mesh's pages are drawn by one face. Set (0, NULL, 0) to reset.
+ */
+void BaseMesh_SetTextureArray(GLuint array_texture, const GLuint *page_textures, uint32_t pages_count)
+{
+    mesh_array_texture = array_texture;
+    mesh_array_pages = (array_texture) ? (page_textures) : (NULL);
+    mesh_array_pages_count = (array_texture) ? (pages_count) : (0);
+}
+
+
 void BaseMesh_GenFaces(base_mesh_p mesh)
 {
     polygon_p p = mesh->polygons;
@@ -19,8 +19,10 @@ struct vertex_s;
 typedef struct mesh_face_s
 {
     GLuint                  texture_index;
+    GLenum                  texture_target;                                     // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
     GLuint                  elements_count;
-    GLuint                 *elements;    
+    GLuint                 *elements;                                           // freed after mesh's element buffer filling
+    size_t                  elements_offset;                                    // offset in mesh's element buffer, bytes
 }mesh_face_t, *mesh_face_p;
 
 /*
@@ -54,6 +56,10 @@ typedef struct base_mesh_s
     GLuint                  vbo_vertex_array;
     GLuint                  vbo_animated_vertex_array;
     GLuint                  vbo_animated_texcoord_array;
+    GLuint                  vbo_index_array;                                    // faces elements, one range per face
+    GLuint                  vbo_animated_index_array;
+    GLenum                  elements_type;                                      // GL_UNSIGNED_SHORT if vertices count allows
+    GLenum                  animated_elements_type;
 }base_mesh_t, *base_mesh_p;
 
 
@@ -111,6 +117,7 @@ void BaseMesh_FindBB(base_mesh_p mesh);
 uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex);
 uint32_t BaseMesh_FindVertexIndex(base_mesh_p mesh, float v[3]);
 void     BaseMesh_GenFaces(base_mesh_p mesh);
+void     BaseMesh_SetTextureArray(GLuint array_texture, const GLuint *page_textures, uint32_t pages_count);
 
 
 #ifdef	__cplusplus
@@ -0,0 +1,541 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/system.h"
+#include "core/vmath.h"
+#include "room.h"
+#include "world.h"
+#include "navigation.h"
+
+
+#define NAV_OVERLAP_INDEX_MASK      (0x3FFF)
+#define NAV_BOX_BLOCKED             (0x4000)                                    // box overlap_index flags
+#define NAV_BOX_BLOCKABLE           (0x8000)
+#define NAV_OVERLAP_BOX_MASK        (0x7FFF)
+#define NAV_OVERLAP_END             (0x8000)
+
+static const float nav_step_height[NAV_ZONE_TYPES] = {256.0f, 512.0f, 768.0f, 1024.0f, -1.0f};
+
+typedef struct nav_cache_entry_s
+{
+    uint32_t                generation;
+    uint16_t                from_box;
+    uint16_t                to_box;
+    uint16_t                zone_type;
+    uint16_t                length;                                             // 0 - no path
+    uint16_t                boxes[NAV_MAX_PATH_LENGTH];
+}nav_cache_entry_t, *nav_cache_entry_p;
+
+typedef struct nav_heap_node_s
+{
+    float                   cost;
+    uint16_t                box;
+}nav_heap_node_t, *nav_heap_node_p;
+
+static struct
+{
+    struct room_box_s      *boxes;
+    uint32_t                boxes_count;
+    float                  *centres;                                            // x, y, floor per box
+    uint8_t                *blocked;
+    uint8_t                *blockable;                                          // only these boxes may be blocked by doors
+
+    uint32_t               *links_start;                                        // boxes_count + 1
+    uint16_t               *links;
+    uint32_t                links_count;
+
+    int16_t                *zones;                                              // [2][NAV_ZONE_TYPES][boxes_count]
+    int                     flip;
+
+    /* A* working set; stamps avoid clearing per search */
+    float                  *g_cost;
+    uint16_t               *parent;
+    uint32_t               *visit_stamp;
+    uint32_t               *closed_stamp;
+    uint32_t                search_stamp;
+    nav_heap_node_p         heap;
+    uint32_t                heap_size;
+
+    nav_cache_entry_t       cache[NAV_PATH_CACHE_SIZE];
+    uint32_t                generation;
+
+    nav_path_p              requests_first;
+    nav_path_p              requests_last;
+
+    nav_stats_t             stats;
+} nav;
+
+
+static int Nav_Search(uint16_t from_box, uint16_t to_box, uint16_t zone_type, uint16_t *path, uint16_t *length);
+
+
+static inline int16_t Nav_GetZone(uint16_t box, uint16_t zone_type)
+{
+    return nav.zones[(nav.flip * NAV_ZONE_TYPES + zone_type) * nav.boxes_count + box];
+}
+
+
+void Nav_Init(struct room_box_s *boxes, uint32_t boxes_count, const uint16_t *overlaps, uint32_t overlaps_count, const int16_t *zones, uint32_t zones_count)
+{
+    Nav_Destroy();
+    if(!boxes || !boxes_count)
+    {
+        return;
+    }
+
+    nav.boxes = boxes;
+    nav.boxes_count = boxes_count;
+    nav.centres = (float*)malloc(3 * boxes_count * sizeof(float));
+    nav.blocked = (uint8_t*)calloc(boxes_count, sizeof(uint8_t));
+    nav.blockable = (uint8_t*)calloc(boxes_count, sizeof(uint8_t));
+    for(uint32_t i = 0; i < boxes_count; i++)
+    {
+        nav.blocked[i] = (boxes[i].overlap_index & NAV_BOX_BLOCKED) ? (1) : (0);
+        nav.blockable[i] = (boxes[i].overlap_index & NAV_BOX_BLOCKABLE) ? (1) : (0);
+        nav.centres[3 * i + 0] = 0.5f * (float)(boxes[i].x_min + boxes[i].x_max);
+        nav.centres[3 * i + 1] = 0.5f * (float)(boxes[i].y_min + boxes[i].y_max);
+        nav.centres[3 * i + 2] = (float)boxes[i].true_floor;
+    }
+
+    /*
+     * overlaps -> packed links list
+     */
+    nav.links_start = (uint32_t*)malloc((boxes_count + 1) * sizeof(uint32_t));
+    nav.links = (uint16_t*)malloc(((overlaps_count > 0) ? (overlaps_count) : (1)) * sizeof(uint16_t));
+    nav.links_count = 0;
+    for(uint32_t i = 0; i < boxes_count; i++)
+    {
+        uint32_t ind = boxes[i].overlap_index & NAV_OVERLAP_INDEX_MASK;
+        nav.links_start[i] = nav.links_count;
+        for(; ind < overlaps_count; ind++)
+        {
+            uint16_t box = overlaps[ind] & NAV_OVERLAP_BOX_MASK;
+            if((box < boxes_count) && (box != i) && (nav.links_count < overlaps_count))
+            {
+                nav.links[nav.links_count++] = box;
+            }
+            if(overlaps[ind] & NAV_OVERLAP_END)
+            {
+                break;
+            }
+        }
+    }
+    nav.links_start[boxes_count] = nav.links_count;
+
+    /*
+     * zones: TR1 has 3 arrays per set (ground 1, ground 2, fly), TR2+ has 5.
+     */
+    nav.zones = (int16_t*)calloc(2 * NAV_ZONE_TYPES * boxes_count, sizeof(int16_t));
+    if(zones && (zones_count >= 2 * 3 * boxes_count))
+    {
+        uint32_t arrays = zones_count / (2 * boxes_count);
+        static const int tr1_map[NAV_ZONE_TYPES] = {0, 1, 0, 1, 2};
+        for(int f = 0; f < 2; f++)
+        {
+            for(int z = 0; z < NAV_ZONE_TYPES; z++)
+            {
+                uint32_t src = (arrays >= NAV_ZONE_TYPES) ? (z) : (tr1_map[z]);
+                memcpy(nav.zones + (f * NAV_ZONE_TYPES + z) * boxes_count, zones + (f * arrays + src) * boxes_count, boxes_count * sizeof(int16_t));
+            }
+        }
+    }
+
+    nav.g_cost = (float*)malloc(boxes_count * sizeof(float));
+    nav.parent = (uint16_t*)malloc(boxes_count * sizeof(uint16_t));
+    nav.visit_stamp = (uint32_t*)calloc(boxes_count, sizeof(uint32_t));
+    nav.closed_stamp = (uint32_t*)calloc(boxes_count, sizeof(uint32_t));
+    nav.heap = (nav_heap_node_p)malloc((nav.links_count + boxes_count + 1) * sizeof(nav_heap_node_t));
+    nav.search_stamp = 0;
+    nav.flip = 0;
+    nav.generation = 1;
+    memset(nav.cache, 0x00, sizeof(nav.cache));
+    memset(&nav.stats, 0x00, sizeof(nav.stats));
+}
+
+
+void Nav_Destroy()
+{
+    /* requests owners may be already deleted here; just drop the queue */
+    nav.requests_first = NULL;
+    nav.requests_last = NULL;
+    nav.stats.pending = 0;
+
+    free(nav.centres);
+    free(nav.blocked);
+    free(nav.blockable);
+    free(nav.links_start);
+    free(nav.links);
+    free(nav.zones);
+    free(nav.g_cost);
+    free(nav.parent);
+    free(nav.visit_stamp);
+    free(nav.closed_stamp);
+    free(nav.heap);
+
+    nav.centres = NULL;
+    nav.blocked = NULL;
+    nav.blockable = NULL;
+    nav.links_start = NULL;
+    nav.links = NULL;
+    nav.links_count = 0;
+    nav.zones = NULL;
+    nav.g_cost = NULL;
+    nav.parent = NULL;
+    nav.visit_stamp = NULL;
+    nav.closed_stamp = NULL;
+    nav.heap = NULL;
+    nav.boxes = NULL;
+    nav.boxes_count = 0;
+}
+
+
+void Nav_Invalidate()
+{
+    nav.generation++;
+    if(nav.generation == 0)
+    {
+        memset(nav.cache, 0x00, sizeof(nav.cache));
+        nav.generation = 1;
+    }
+}
+
+
+void Nav_SetFlipState(int is_flipped)
+{
+    is_flipped = (is_flipped) ? (1) : (0);
+    if(nav.flip != is_flipped)
+    {
+        nav.flip = is_flipped;
+        Nav_Invalidate();
+    }
+}
+
+
+void Nav_SetBoxBlocked(uint16_t box, int is_blocked)
+{
+    if((box < nav.boxes_count) && nav.blockable[box] && (nav.blocked[box] != (is_blocked != 0)))
+    {
+        nav.blocked[box] = (is_blocked != 0);
+        Nav_Invalidate();
+    }
+}
+
+
+uint16_t Nav_GetBoxByPos(float pos[3])
+{
+    room_p room = World_FindRoomByPos(pos);
+    if(room)
+    {
+        room_sector_p sector = Room_GetSectorRaw(room, pos);
+        if(sector && (sector->box_index >= 0) && ((uint32_t)sector->box_index < nav.boxes_count))
+        {
+            return sector->box_index;
+        }
+    }
+    return NAV_NO_BOX;
+}
+
+
+int Nav_IsReachable(uint16_t from_box, uint16_t to_box, uint16_t zone_type)
+{
+    return (from_box < nav.boxes_count) && (to_box < nav.boxes_count) && (zone_type < NAV_ZONE_TYPES) &&
+           (Nav_GetZone(from_box, zone_type) == Nav_GetZone(to_box, zone_type));
+}
+
+
+/*
+ * Next path box centre after the box creature stands in; creature that left
+ * the path (or reached it's end) gets no waypoint and asks for a new path.
+ */
+int Nav_GetPathWaypoint(nav_path_p path, uint16_t current_box, float pos[3])
+{
+    if((path->state == NAV_PATH_READY) && (current_box < nav.boxes_count))
+    {
+        for(uint16_t i = 0; i + 1 < path->length; i++)
+        {
+            if(path->boxes[i] == current_box)
+            {
+                vec3_copy(pos, nav.centres + 3 * path->boxes[i + 1]);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+
+int Nav_FindPath(nav_path_p path, uint16_t from_box, uint16_t to_box, uint16_t zone_type)
+{
+    nav_cache_entry_p entry;
+    uint32_t hash;
+
+    path->from_box = from_box;
+    path->to_box = to_box;
+    path->zone_type = zone_type;
+    path->length = 0;
+    path->state = NAV_PATH_FAILED;
+
+    if(!Nav_IsReachable(from_box, to_box, zone_type))
+    {
+        nav.stats.zone_rejects++;
+        return 0;
+    }
+
+    hash = ((uint32_t)from_box * 73856093u) ^ ((uint32_t)to_box * 19349663u) ^ ((uint32_t)zone_type * 83492791u);
+    entry = nav.cache + hash % NAV_PATH_CACHE_SIZE;
+    if((entry->generation != nav.generation) || (entry->from_box != from_box) ||
+       (entry->to_box != to_box) || (entry->zone_type != zone_type))
+    {
+        entry->generation = nav.generation;
+        entry->from_box = from_box;
+        entry->to_box = to_box;
+        entry->zone_type = zone_type;
+        entry->length = 0;
+        Nav_Search(from_box, to_box, zone_type, entry->boxes, &entry->length);
+        nav.stats.searches++;
+    }
+    else
+    {
+        nav.stats.cache_hits++;
+    }
+
+    if(entry->length > 0)
+    {
+        memcpy(path->boxes, entry->boxes, entry->length * sizeof(uint16_t));
+        path->length = entry->length;
+        path->state = NAV_PATH_READY;
+        return 1;
+    }
+
+    return 0;
+}
+
+
+void Nav_RequestPath(nav_path_p path, uint16_t from_box, uint16_t to_box, uint16_t zone_type)
+{
+    if(path->state == NAV_PATH_PENDING)
+    {
+        Nav_CancelRequest(path);
+    }
+
+    path->from_box = from_box;
+    path->to_box = to_box;
+    path->zone_type = zone_type;
+    path->length = 0;
+    path->state = NAV_PATH_PENDING;
+    path->next_request = NULL;
+    if(nav.requests_last)
+    {
+        nav.requests_last->next_request = path;
+    }
+    else
+    {
+        nav.requests_first = path;
+    }
+    nav.requests_last = path;
+    nav.stats.pending++;
+}
+
+
+void Nav_CancelRequest(nav_path_p path)
+{
+    nav_path_p prev = NULL;
+    for(nav_path_p p = nav.requests_first; p; prev = p, p = p->next_request)
+    {
+        if(p == path)
+        {
+            if(prev)
+            {
+                prev->next_request = p->next_request;
+            }
+            else
+            {
+                nav.requests_first = p->next_request;
+            }
+            if(nav.requests_last == p)
+            {
+                nav.requests_last = prev;
+            }
+            p->next_request = NULL;
+            p->state = NAV_PATH_NONE;
+            nav.stats.pending--;
+            return;
+        }
+    }
+}
+
+/*
+ * Serves queued requests in order until time limit is exceeded;
+ * at least one request is served per call, so queue always moves.
+ */
+uint32_t Nav_ProcessRequests(float time_limit)
+{
+    uint32_t ret = 0;
+    float start_time = Sys_FloatTime();
+
+    while(nav.requests_first)
+    {
+        nav_path_p path = nav.requests_first;
+        nav.requests_first = path->next_request;
+        if(!nav.requests_first)
+        {
+            nav.requests_last = NULL;
+        }
+        path->next_request = NULL;
+        nav.stats.pending--;
+
+        Nav_FindPath(path, path->from_box, path->to_box, path->zone_type);
+        ret++;
+
+        if(Sys_FloatTime() - start_time > time_limit)
+        {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+
+void Nav_GetStats(nav_stats_p stats)
+{
+    *stats = nav.stats;
+}
+
+
+static void Nav_HeapPush(float cost, uint16_t box)
+{
+    uint32_t i = nav.heap_size++;
+    while(i > 0)
+    {
+        uint32_t p = (i - 1) / 2;
+        if(nav.heap[p].cost <= cost)
+        {
+            break;
+        }
+        nav.heap[i] = nav.heap[p];
+        i = p;
+    }
+    nav.heap[i].cost = cost;
+    nav.heap[i].box = box;
+}
+
+
+static uint16_t Nav_HeapPop()
+{
+    uint16_t ret = nav.heap[0].box;
+    nav_heap_node_t last = nav.heap[--nav.heap_size];
+    uint32_t i = 0;
+
+    for(;;)
+    {
+        uint32_t c = 2 * i + 1;
+        if(c >= nav.heap_size)
+        {
+            break;
+        }
+        if((c + 1 < nav.heap_size) && (nav.heap[c + 1].cost < nav.heap[c].cost))
+        {
+            c++;
+        }
+        if(last.cost <= nav.heap[c].cost)
+        {
+            break;
+        }
+        nav.heap[i] = nav.heap[c];
+        i = c;
+    }
+    nav.heap[i] = last;
+
+    return ret;
+}
+
+
+static float Nav_Distance(uint16_t box1, uint16_t box2)
+{
+    float *c1 = nav.centres + 3 * box1;
+    float *c2 = nav.centres + 3 * box2;
+    float d[3];
+    vec3_sub(d, c1, c2);
+    return vec3_abs(d);
+}
+
+/*
+ * A* over boxes graph; zone equality and step height limit the links.
+ */
+static int Nav_Search(uint16_t from_box, uint16_t to_box, uint16_t zone_type, uint16_t *path, uint16_t *length)
+{
+    int16_t zone = Nav_GetZone(from_box, zone_type);
+    float step = nav_step_height[zone_type];
+    uint16_t reversed[NAV_MAX_PATH_LENGTH];
+    uint32_t n;
+
+    nav.search_stamp++;
+    if(nav.search_stamp == 0)
+    {
+        memset(nav.visit_stamp, 0x00, nav.boxes_count * sizeof(uint32_t));
+        memset(nav.closed_stamp, 0x00, nav.boxes_count * sizeof(uint32_t));
+        nav.search_stamp = 1;
+    }
+
+    nav.heap_size = 0;
+    nav.g_cost[from_box] = 0.0f;
+    nav.parent[from_box] = NAV_NO_BOX;
+    nav.visit_stamp[from_box] = nav.search_stamp;
+    Nav_HeapPush(Nav_Distance(from_box, to_box), from_box);
+
+    while(nav.heap_size > 0)
+    {
+        uint16_t box = Nav_HeapPop();
+        if(nav.closed_stamp[box] == nav.search_stamp)
+        {
+            continue;                                                           // outdated heap node
+        }
+        nav.closed_stamp[box] = nav.search_stamp;
+
+        if(box == to_box)
+        {
+            /* path is restored backward; the tail is cut for long ones */
+            n = 0;
+            for(uint16_t b = box; b != NAV_NO_BOX; b = nav.parent[b])
+            {
+                reversed[n % NAV_MAX_PATH_LENGTH] = b;
+                n++;
+            }
+            *length = (n < NAV_MAX_PATH_LENGTH) ? (n) : (NAV_MAX_PATH_LENGTH);
+            for(uint16_t i = 0; i < *length; i++)
+            {
+                path[i] = reversed[(n - 1 - i) % NAV_MAX_PATH_LENGTH];
+            }
+            return 1;
+        }
+
+        for(uint32_t l = nav.links_start[box]; l < nav.links_start[box + 1]; l++)
+        {
+            uint16_t next = nav.links[l];
+            float cost;
+            if((nav.closed_stamp[next] == nav.search_stamp) || nav.blocked[next] || (Nav_GetZone(next, zone_type) != zone))
+            {
+                continue;
+            }
+            if((step > 0.0f) && (fabs(nav.centres[3 * next + 2] - nav.centres[3 * box + 2]) > step))
+            {
+                continue;
+            }
+
+            cost = nav.g_cost[box] + Nav_Distance(box, next);
+            if((nav.visit_stamp[next] != nav.search_stamp) || (cost < nav.g_cost[next]))
+            {
+                nav.visit_stamp[next] = nav.search_stamp;
+                nav.g_cost[next] = cost;
+                nav.parent[next] = box;
+                Nav_HeapPush(cost + Nav_Distance(next, to_box), next);
+            }
+        }
+    }
+
+    *length = 0;
+    return 0;
+}
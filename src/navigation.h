@@ -0,0 +1,63 @@
+
+#ifndef NAVIGATION_H
+#define NAVIGATION_H
+
+#include <stdint.h>
+
+/*
+ * Creatures zone types; water creatures use fly zones like in original engines.
+ */
+#define NAV_ZONE_GROUND_1           (0)     // step 256
+#define NAV_ZONE_GROUND_2           (1)     // step 512
+#define NAV_ZONE_GROUND_3           (2)     // step 768, TR2+ only (ground 1 in TR1)
+#define NAV_ZONE_GROUND_4           (3)     // step 1024, TR2+ only (ground 2 in TR1)
+#define NAV_ZONE_FLY                (4)
+#define NAV_ZONE_WATER              NAV_ZONE_FLY
+#define NAV_ZONE_TYPES              (5)
+
+#define NAV_PATH_NONE               (0)
+#define NAV_PATH_PENDING            (1)
+#define NAV_PATH_READY              (2)
+#define NAV_PATH_FAILED             (3)
+
+#define NAV_MAX_PATH_LENGTH         (32)    // longer paths are truncated, creature asks again on the way
+#define NAV_PATH_CACHE_SIZE         (256)
+#define NAV_NO_BOX                  (0xFFFF)
+
+struct room_box_s;
+
+typedef struct nav_path_s
+{
+    uint16_t                state;
+    uint16_t                zone_type;
+    uint16_t                from_box;
+    uint16_t                to_box;
+    uint16_t                length;
+    uint16_t                boxes[NAV_MAX_PATH_LENGTH];                         // from_box ... to_box
+    struct nav_path_s      *next_request;
+}nav_path_t, *nav_path_p;
+
+typedef struct nav_stats_s
+{
+    uint32_t                searches;
+    uint32_t                cache_hits;
+    uint32_t                zone_rejects;                                       // requests rejected by zones without search
+    uint32_t                pending;
+}nav_stats_t, *nav_stats_p;
+
+void Nav_Init(struct room_box_s *boxes, uint32_t boxes_count, const uint16_t *overlaps, uint32_t overlaps_count, const int16_t *zones, uint32_t zones_count);
+void Nav_Destroy();
+void Nav_Invalidate();
+void Nav_SetFlipState(int is_flipped);
+void Nav_SetBoxBlocked(uint16_t box, int is_blocked);                          // blockable boxes only, e.g. under doors
+
+uint16_t Nav_GetBoxByPos(float pos[3]);
+int  Nav_IsReachable(uint16_t from_box, uint16_t to_box, uint16_t zone_type);
+int  Nav_FindPath(nav_path_p path, uint16_t from_box, uint16_t to_box, uint16_t zone_type);
+int  Nav_GetPathWaypoint(nav_path_p path, uint16_t current_box, float pos[3]);
+void Nav_RequestPath(nav_path_p path, uint16_t from_box, uint16_t to_box, uint16_t zone_type);
+void Nav_CancelRequest(nav_path_p path);
+uint32_t Nav_ProcessRequests(float time_limit);
+void Nav_GetStats(nav_stats_p stats);
+
+#endif
@@ -846,17 +846,17 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
     uint32_t cnt = 0;
     float *v0, *v1, *v2, *v3;
 
-    v0 = sector->floor_corners[0];
-    v1 = sector->floor_corners[1];
-    v2 = sector->floor_corners[2];
-    v3 = sector->floor_corners[3];
-    if( (sector->floor_penetration_config != TR_PENETRATION_CONFIG_GHOST) &&
-        (sector->floor_penetration_config != TR_PENETRATION_CONFIG_WALL )  )
-    {
-        if( (sector->floor_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NONE) ||
-            (sector->floor_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NW  )  )
+    v0 = sector->geometry->floor_corners[0];
+    v1 = sector->geometry->floor_corners[1];
+    v2 = sector->geometry->floor_corners[2];
+    v3 = sector->geometry->floor_corners[3];
+    if( (sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_GHOST) &&
+        (sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL )  )
+    {
+        if( (sector->geometry->floor_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NONE) ||
+            (sector->geometry->floor_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NW  )  )
         {
-            if(sector->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
+            if(sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
             {
                 trimesh->addTriangle(btVector3(v3[0], v3[1], v3[2]),
                                      btVector3(v2[0], v2[1], v2[2]),
@@ -865,7 +865,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
                 cnt++;
             }
 
-            if(sector->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
+            if(sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
             {
                 trimesh->addTriangle(btVector3(v2[0], v2[1], v2[2]),
                                      btVector3(v1[0], v1[1], v1[2]),
@@ -876,7 +876,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
         }
         else
         {
-            if(sector->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
+            if(sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
             {
                 trimesh->addTriangle(btVector3(v3[0], v3[1], v3[2]),
                                      btVector3(v2[0], v2[1], v2[2]),
@@ -885,7 +885,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
                 cnt++;
             }
 
-            if(sector->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
+            if(sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
             {
                 trimesh->addTriangle(btVector3(v3[0], v3[1], v3[2]),
                                      btVector3(v1[0], v1[1], v1[2]),
@@ -896,17 +896,17 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
         }
     }
 
-    v0 = sector->ceiling_corners[0];
-    v1 = sector->ceiling_corners[1];
-    v2 = sector->ceiling_corners[2];
-    v3 = sector->ceiling_corners[3];
-    if( (sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_GHOST) &&
-        (sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_WALL )  )
+    v0 = sector->geometry->ceiling_corners[0];
+    v1 = sector->geometry->ceiling_corners[1];
+    v2 = sector->geometry->ceiling_corners[2];
+    v3 = sector->geometry->ceiling_corners[3];
+    if( (sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_GHOST) &&
+        (sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_WALL )  )
     {
-        if( (sector->ceiling_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NONE) ||
-            (sector->ceiling_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NW  )  )
+        if( (sector->geometry->ceiling_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NONE) ||
+            (sector->geometry->ceiling_diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NW  )  )
         {
-            if(sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
+            if(sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
             {
                 trimesh->addTriangle(btVector3(v0[0], v0[1], v0[2]),
                                      btVector3(v2[0], v2[1], v2[2]),
@@ -915,7 +915,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
                 cnt++;
             }
 
-            if(sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
+            if(sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
             {
                 trimesh->addTriangle(btVector3(v0[0], v0[1], v0[2]),
                                      btVector3(v1[0], v1[1], v1[2]),
@@ -926,7 +926,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
         }
         else
         {
-            if(sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
+            if(sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A)
             {
                 trimesh->addTriangle(btVector3(v0[0], v0[1], v0[2]),
                                      btVector3(v1[0], v1[1], v1[2]),
@@ -935,7 +935,7 @@ uint32_t BT_AddFloorAndCeilingToTrimesh(btTriangleMesh *trimesh, struct room_sec
                 cnt++;
             }
 
-            if(sector->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
+            if(sector->geometry->ceiling_penetration_config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B)
             {
                 trimesh->addTriangle(btVector3(v1[0], v1[1], v1[2]),
                                      btVector3(v2[0], v2[1], v2[2]),
@@ -493,146 +493,151 @@ unsigned long bordered_texture_atlas::getNumAtlasPages() const
     return number_result_pages;
 }
 
-void bordered_texture_atlas::createTextures(GLuint *textureNames)
+void bordered_texture_atlas::fillPage(unsigned long page, GLubyte *data) const
 {
-    GLubyte *data = (GLubyte *) malloc(4 * result_page_width * result_page_width);
-
-    qglGenTextures((GLsizei) number_result_pages, textureNames);
-
-    textures_indexes = textureNames;
-
-    for (unsigned long page = 0; page < number_result_pages; page++)
+    for (unsigned long texture = 0; texture < number_canonical_object_textures; texture++)
     {
-        for (unsigned long texture = 0; texture < number_canonical_object_textures; texture++)
-        {
-            const canonical_object_texture &canonical = canonical_object_textures[texture];
-            if (canonical.new_page != page)
-                continue;
+        const canonical_object_texture &canonical = canonical_object_textures[texture];
+        if (canonical.new_page != page)
+            continue;
 
-            if(canonical.original_page == WHITE_TEXTURE_INDEX)
+        if(canonical.original_page == WHITE_TEXTURE_INDEX)
+        {
+            uint32_t white_pixels[1] = {0xFFFFFFFFU};
+            // Add top border
+            for (int border = 0; border < border_width; border++)
             {
-                uint32_t white_pixels[1] = {0xFFFFFFFFU};
-                // Add top border
-                for (int border = 0; border < border_width; border++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + border;
-
-                    // expand top-left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           white_pixels, 4 * border_width);
-                    // copy top line
-                    memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
-                           white_pixels, canonical.width * 4);
-                    // expand top-right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           white_pixels, 4 * border_width);
-                }
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + border;
+
+                // expand top-left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       white_pixels, 4 * border_width);
+                // copy top line
+                memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
+                       white_pixels, canonical.width * 4);
+                // expand top-right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       white_pixels, 4 * border_width);
+            }
 
-                // Copy main content
-                for (int line = 0; line < canonical.height; line++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + border_width + line;
-
-                    // expand left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           white_pixels, 4 * border_width);
-                    // copy line
-                    memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
-                           white_pixels, canonical.width * 4);
-                    // expand right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           white_pixels, 4 * border_width);
-                }
+            // Copy main content
+            for (int line = 0; line < canonical.height; line++)
+            {
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + border_width + line;
+
+                // expand left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       white_pixels, 4 * border_width);
+                // copy line
+                memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
+                       white_pixels, canonical.width * 4);
+                // expand right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       white_pixels, 4 * border_width);
+            }
 
-                // Add bottom border
-                for (int border = 0; border < border_width; border++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + canonical.height + border_width + border;
-
-                    // expand bottom-left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           white_pixels, 4 * border_width);
-                    // copy bottom line
-                    memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
-                           white_pixels, canonical.width * 4);
-                    // expand bottom-right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           white_pixels, 4 * border_width);
-                }
+            // Add bottom border
+            for (int border = 0; border < border_width; border++)
+            {
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + canonical.height + border_width + border;
+
+                // expand bottom-left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       white_pixels, 4 * border_width);
+                // copy bottom line
+                memset_pattern4(&data[(y*result_page_width + x + border_width) * 4],
+                       white_pixels, canonical.width * 4);
+                // expand bottom-right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       white_pixels, 4 * border_width);
             }
-            else
+        }
+        else
+        {
+            const char *original = (char *) original_pages[canonical.original_page].pixels;
+            // Add top border
+            for (int border = 0; border < border_width; border++)
             {
-                const char *original = (char *) original_pages[canonical.original_page].pixels;
-                // Add top border
-                for (int border = 0; border < border_width; border++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + border;
-                    unsigned old_x = canonical.original_x;
-                    unsigned old_y = canonical.original_y;
-
-                    // expand top-left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           &(original[(old_y * 256 + old_x) * 4]),
-                           4 * border_width);
-                    // copy top line
-                    memcpy(&data[(y*result_page_width + x + border_width) * 4],
-                           &original[(old_y * 256 + old_x) * 4],
-                           canonical.width * 4);
-                    // expand top-right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           &(original[(old_y * 256 + old_x + canonical.width) * 4]),
-                           4 * border_width);
-                }
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + border;
+                unsigned old_x = canonical.original_x;
+                unsigned old_y = canonical.original_y;
+
+                // expand top-left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       &(original[(old_y * 256 + old_x) * 4]),
+                       4 * border_width);
+                // copy top line
+                memcpy(&data[(y*result_page_width + x + border_width) * 4],
+                       &original[(old_y * 256 + old_x) * 4],
+                       canonical.width * 4);
+                // expand top-right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       &(original[(old_y * 256 + old_x + canonical.width) * 4]),
+                       4 * border_width);
+            }
 
-                // Copy main content
-                for (int line = 0; line < canonical.height; line++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + border_width + line;
-                    unsigned old_x = canonical.original_x;
-                    unsigned old_y = canonical.original_y + line;
-
-                    // expand left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           &(original[(old_y * 256 + old_x) * 4]),
-                           4 * border_width);
-                    // copy line
-                    memcpy(&data[(y*result_page_width + x + border_width) * 4],
-                           &original[(old_y * 256 + old_x) * 4],
-                           canonical.width * 4);
-                    // expand right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           &(original[(old_y * 256 + old_x + canonical.width) * 4]),
-                           4 * border_width);
-                }
+            // Copy main content
+            for (int line = 0; line < canonical.height; line++)
+            {
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + border_width + line;
+                unsigned old_x = canonical.original_x;
+                unsigned old_y = canonical.original_y + line;
+
+                // expand left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       &(original[(old_y * 256 + old_x) * 4]),
+                       4 * border_width);
+                // copy line
+                memcpy(&data[(y*result_page_width + x + border_width) * 4],
+                       &original[(old_y * 256 + old_x) * 4],
+                       canonical.width * 4);
+                // expand right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       &(original[(old_y * 256 + old_x + canonical.width) * 4]),
+                       4 * border_width);
+            }
 
-                // Add bottom border
-                for (int border = 0; border < border_width; border++)
-                {
-                    unsigned x = canonical.new_x_with_border;
-                    unsigned y = canonical.new_y_with_border + canonical.height + border_width + border;
-                    unsigned old_x = canonical.original_x;
-                    unsigned old_y = canonical.original_y + canonical.height;
-
-                    // expand bottom-left pixel
-                    memset_pattern4(&data[(y*result_page_width + x) * 4],
-                           &(original[(old_y * 256 + old_x) * 4]),
-                           4 * border_width);
-                    // copy bottom line
-                    memcpy(&data[(y*result_page_width + x + border_width) * 4],
-                           &original[(old_y * 256 + old_x) * 4],
-                           canonical.width * 4);
-                    // expand bottom-right pixel
-                    memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
-                           &(original[(old_y * 256 + old_x + canonical.width) * 4]),
-                           4 * border_width);
-                }
+            // Add bottom border
+            for (int border = 0; border < border_width; border++)
+            {
+                unsigned x = canonical.new_x_with_border;
+                unsigned y = canonical.new_y_with_border + canonical.height + border_width + border;
+                unsigned old_x = canonical.original_x;
+                unsigned old_y = canonical.original_y + canonical.height;
+
+                // expand bottom-left pixel
+                memset_pattern4(&data[(y*result_page_width + x) * 4],
+                       &(original[(old_y * 256 + old_x) * 4]),
+                       4 * border_width);
+                // copy bottom line
+                memcpy(&data[(y*result_page_width + x + border_width) * 4],
+                       &original[(old_y * 256 + old_x) * 4],
+                       canonical.width * 4);
+                // expand bottom-right pixel
+                memset_pattern4(&data[(y*result_page_width + x + border_width + canonical.width) * 4],
+                       &(original[(old_y * 256 + old_x + canonical.width) * 4]),
+                       4 * border_width);
             }
         }
+    }
+}
+
+void bordered_texture_atlas::createTextures(GLuint *textureNames)
+{
+    GLubyte *data = (GLubyte *) malloc(4 * result_page_width * result_page_width);
+
+    qglGenTextures((GLsizei) number_result_pages, textureNames);
+
+    textures_indexes = textureNames;
+
+    for (unsigned long page = 0; page < number_result_pages; page++)
+    {
+        fillPage(page, data);
 
         qglBindTexture(GL_TEXTURE_2D, textureNames[page]);
         qglTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, (GLsizei)result_page_width, (GLsizei) result_page_height[page], 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
@@ -692,3 +697,51 @@ void bordered_texture_atlas::createTextures(GLuint *textureNames)
 
     free(data);
 }
+
+void bordered_texture_atlas::setUniformPagesHeight()
+{
+    unsigned max_height = 0;
+
+    for (unsigned long page = 0; page < number_result_pages; page++)
+    {
+        max_height = (result_page_height[page] > max_height) ? (result_page_height[page]) : (max_height);
+    }
+
+    for (unsigned long page = 0; page < number_result_pages; page++)
+    {
+        result_page_height[page] = max_height;
+    }
+}
+
+bool bordered_texture_atlas::createTextureArray(GLuint *textureName)
+{
+    if ((qglTexImage3D == NULL) || (qglTexSubImage3D == NULL) || (qglGenerateMipmap == NULL) || (number_result_pages == 0))
+    {
+        return false;
+    }
+
+    for (unsigned long page = 1; page < number_result_pages; page++)
+    {
+        if (result_page_height[page] != result_page_height[0])
+        {
+            return false;                                                       // setUniformPagesHeight was not called before coordinates generation
+        }
+    }
+
+    GLubyte *data = (GLubyte *) malloc(4 * result_page_width * result_page_width);
+
+    qglGenTextures(1, textureName);
+    qglBindTexture(GL_TEXTURE_2D_ARRAY, *textureName);
+    qglTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, (GLsizei)result_page_width, (GLsizei)result_page_height[0], (GLsizei)number_result_pages, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    for (unsigned long page = 0; page < number_result_pages; page++)
+    {
+        fillPage(page, data);
+        qglTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)page, (GLsizei)result_page_width, (GLsizei)result_page_height[0], 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+    qglGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    qglTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    qglTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    free(data);
+    return true;
+}
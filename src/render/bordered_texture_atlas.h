@@ -114,6 +114,9 @@ class bordered_texture_atlas
     
     /*! Adds a sprite texture to the list. */
     void addSpriteTexture(const tr_sprite_texture_t &texture);
+
+    /*! Copies the tiles (with borders) of the result page to data, result_page_width wide. */
+    void fillPage(unsigned long page, GLubyte *data) const;
     
 public:
     /*!
@@ -182,6 +185,21 @@ public:
      */
     void createTextures(GLuint *textureNames);
 
+    /*!
+     * Makes all result pages as high as the highest one, so the pages can be
+     * layers of one texture array. Must be called before any coordinates are
+     * requested, because they are normalized by the page height.
+     */
+    void setUniformPagesHeight();
+
+    /*!
+     * Uploads all pages as layers of one GL_TEXTURE_2D_ARRAY; the layer is the
+     * page returned by getCoordinates. Returns false if texture arrays are not
+     * supported or pages heights differ; textureName is not created then.
+     * @param textureName The name of the array texture.
+     */
+    bool createTextureArray(GLuint *textureName);
+
 };
 
 #endif /* BORDERED_TEXTURE_ATLAS_H */
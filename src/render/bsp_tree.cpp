@@ -157,6 +157,7 @@ void CDynamicBSP::AddPolygon(struct bsp_node_s *root, struct polygon_s *p)
         back = this->CreatePolygon(p->vertex_count + 2);
         back->vertex_count = 0;
         Polygon_Split(p, root->plane, front, back);
+        m_split_polygons++;
 
         if(root->front == NULL)
         {
@@ -191,6 +192,7 @@ CDynamicBSP::CDynamicBSP(uint32_t size)
 
     m_input_polygons = 0;
     m_added_polygons = 0;
+    m_split_polygons = 0;
 
     m_vbo = 0;
     m_anim_seq = NULL;
@@ -234,10 +236,15 @@ CDynamicBSP::~CDynamicBSP()
 }
 
 
-void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f)
+void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f, uint16_t filter)
 {
     for( ; p && (!m_realloc_state); p = p->next)
     {
+        if(!(filter & ((p->anim_id > 0) ? (BSP_POLYGONS_ANIMATED) : (BSP_POLYGONS_STATIC))))
+        {
+            continue;
+        }
+
         m_temp_allocated = 0;
         polygon_p np = this->CreatePolygon(p->vertex_count);
         bool visible = (f == NULL);
@@ -361,5 +368,6 @@ void CDynamicBSP::Reset(struct anim_seq_s *seq)
     m_realloc_state = 0;
     m_input_polygons = 0;
     m_added_polygons = 0;
+    m_split_polygons = 0;
     m_root = this->CreateBSPNode();
 }
@@ -10,6 +10,10 @@ struct polygon_s;
 struct frustum_s;
 struct anim_seq_s;
 
+#define BSP_POLYGONS_STATIC     (0x01)                                          // polygons without animated texture
+#define BSP_POLYGONS_ANIMATED   (0x02)
+#define BSP_POLYGONS_ALL        (BSP_POLYGONS_STATIC | BSP_POLYGONS_ANIMATED)
+
 typedef struct bsp_polygon_s 
 {
     uint16_t                vertex_count;                                       // number of vertices
@@ -52,6 +56,7 @@ class CDynamicBSP
     
     uint32_t             m_input_polygons;
     uint32_t             m_added_polygons;
+    uint32_t             m_split_polygons;
     
     struct bsp_node_s     *CreateBSPNode();
     struct polygon_s      *CreatePolygon(uint16_t vertex_count);
@@ -65,7 +70,7 @@ public:
     CDynamicBSP(uint32_t size);
    ~CDynamicBSP();
    
-    void AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f);
+    void AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f, uint16_t filter = BSP_POLYGONS_ALL);
     void Reset(struct anim_seq_s *seq);
     
     struct vertex_s *GetVertexArray()
@@ -87,6 +92,16 @@ public:
     {
         return m_added_polygons;
     }
+
+    uint32_t GetSplitPolygonsCount()
+    {
+        return m_split_polygons;
+    }
+
+    bool IsComplete()                                                           // nothing was dropped by buffers overflow
+    {
+        return m_realloc_state == 0;
+    }
 };
 
 
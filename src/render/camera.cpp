@@ -41,9 +41,11 @@ void Cam_Init(camera_p cam)
     cam->frustum->vertex_count = 4;
     cam->frustum->next = NULL;
     cam->frustum->parent = NULL;
+    cam->frustum->portal = NULL;
     cam->frustum->parents_count = 0;
     cam->frustum->vertex = NULL;
     cam->frustum->planes = cam->clip_planes;
+    cam->frustum->planes_soa = cam->clip_planes_soa;
     cam->frustum->vertex = (float*)malloc(3 * 4 * sizeof(float));
 
     cam->prev_pos[0] = 0.0f;
@@ -362,6 +364,7 @@ void Cam_RecalcClipPlanes(camera_p cam)
     }
 
     vec3_add(cam->frustum->vertex, cam->gl_transform + 12, cam->gl_transform + 8);
+    Frustum_GenPlanesSoA(cam->frustum);
 }
 
 /*
@@ -69,6 +69,7 @@ typedef struct camera_s
     GLfloat                     gl_view_proj_mat[16] __attribute__((packed, aligned(16)));
 
     GLfloat                     clip_planes[16];        // frustum side clip planes
+    GLfloat                     clip_planes_soa[32];    // FRUSTUM_SOA_SIZE(4): side planes + main clip plane
     GLfloat                     prev_pos[3];            // previous camera position
     GLfloat                     ang[3];                 // camera orientation
     struct frustum_s           *frustum;                // camera frustum structure
@@ -1,7 +1,16 @@
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <SDL2/SDL_timer.h>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE     (1)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRUSTUM_NEON    (1)
+#endif
 
 #include "../core/system.h"
 #include "../core/vmath.h"
@@ -16,10 +25,20 @@
 #define SPLIT_EMPTY         (0x00)
 #define SPLIT_SUCCES        (0x01)
 
+static uint32_t obb_tests = 0;
+static uint32_t obb_planes_rejected = 0;
+static bool     obb_bench = false;                                              // time scalar and SIMD planes kernels
+static uint64_t obb_bench_scalar = 0;                                           // performance counter ticks this frame
+static uint64_t obb_bench_simd = 0;
+static uint32_t obb_bench_mismatches = 0;                                       // box / frustum pairs with different results
+static volatile uint32_t obb_bench_rejected = 0;                                // keeps timed loops results alive
+
 CFrustumManager::CFrustumManager(uint32_t buffer_size)
 {
     m_buffer_size = buffer_size;
     m_allocated = 0;
+    m_high_water = 0;
+    m_generated = 0;
     m_buffer = (uint8_t*)malloc(buffer_size * sizeof(uint8_t));
     memset(m_buffer, 0, (buffer_size * sizeof(uint8_t)));
     m_need_realloc = false;
@@ -36,7 +55,9 @@ CFrustumManager::~CFrustumManager()
 
 void CFrustumManager::Reset()
 {
+    m_high_water = (m_allocated > m_high_water) ? (m_allocated) : (m_high_water);
     m_allocated = 0;
+    m_generated = 0;
     if(m_need_realloc)
     {
         uint32_t new_buffer_size = m_buffer_size * 1.5;
@@ -61,7 +82,9 @@ frustum_p CFrustumManager::CreateFrustum()
         ret->parents_count = 0;
         ret->next = NULL;
         ret->parent = NULL;
+        ret->portal = NULL;
         ret->planes = NULL;
+        ret->planes_soa = NULL;
         ret->vertex = NULL;
         ret->cam_pos = NULL;
         vec4_set_zero(ret->norm);
@@ -194,7 +217,7 @@ int CFrustumManager::SplitByPlane(frustum_p p, float n[4], float *buf)
 
 void CFrustumManager::GenClipPlanes(frustum_p p, struct camera_s *cam)
 {
-    if(m_allocated + p->vertex_count * 4 * sizeof(float) >= m_buffer_size)
+    if(m_allocated + (p->vertex_count * 4 + FRUSTUM_SOA_SIZE(p->vertex_count)) * sizeof(float) >= m_buffer_size)
     {
         m_need_realloc = true;
     }
@@ -229,6 +252,8 @@ void CFrustumManager::GenClipPlanes(frustum_p p, struct camera_s *cam)
         }
 
         p->cam_pos = cam->gl_transform + 12;
+        p->planes_soa = this->Alloc(FRUSTUM_SOA_SIZE(p->vertex_count));
+        Frustum_GenPlanesSoA(p);
     }
 }
 
@@ -302,6 +327,7 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
         }
 
         int buf_size = (current_gen->vertex_count + emitter->vertex_count + 4) * 3 * sizeof(float);
+        mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
         float *tmp = (float*)Sys_GetTempMem(buf_size);
         if(this->SplitByPlane(current_gen, emitter->norm, tmp))                 // splitting by main frustum clip plane
         {
@@ -318,7 +344,7 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
                     {
                         dest_room->frustum = NULL;
                     }
-                    Sys_ReturnTempMem(buf_size);
+                    Sys_RollbackTempMem(temp_marker);
                     m_allocated = original_allocated;
                     return NULL;
                 }
@@ -335,14 +361,16 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
                 {
                     dest_room->frustum = NULL;
                 }
-                Sys_ReturnTempMem(buf_size);
+                Sys_RollbackTempMem(temp_marker);
                 m_allocated = original_allocated;
                 return NULL;
             }
 
             current_gen->parent = emitter;                                      // add parent pointer
+            current_gen->portal = portal;
             current_gen->parents_count = emitter->parents_count + 1;
-            Sys_ReturnTempMem(buf_size);
+            m_generated++;
+            Sys_RollbackTempMem(temp_marker);
             return current_gen;
         }
 
@@ -355,12 +383,20 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
             dest_room->frustum = NULL;
         }
         m_allocated = original_allocated;
-        Sys_ReturnTempMem(buf_size);
+        Sys_RollbackTempMem(temp_marker);
     }
 
     return NULL;
 }
 
+void CFrustumManager::GetStats(uint32_t *generated, uint32_t *allocated, uint32_t *high_water, uint32_t *buffer_size)
+{
+    *generated = m_generated;
+    *allocated = m_allocated;
+    *high_water = (m_allocated > m_high_water) ? (m_allocated) : (m_high_water);
+    *buffer_size = m_buffer_size;
+}
+
 /*
  ************************* END FRUSTUM MANAGER IMPLEMENTATION*******************
  */
@@ -675,10 +711,175 @@ bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
     return inside;
 }
 
-bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum)
+/**
+ * Box projection on planes: centre and extent scaled axes, for
+ * Frustum_IsBoxOutsidePlanes.
+ */
+static void Frustum_PrepareOBBBox(struct obb_s *obb, float box[12])
 {
+    vec3_copy(box, obb->centre);
+    if(obb->transform)
+    {
+        vec3_mul_scalar(box + 3, obb->transform + 0, obb->extent[0]);
+        vec3_mul_scalar(box + 6, obb->transform + 4, obb->extent[1]);
+        vec3_mul_scalar(box + 9, obb->transform + 8, obb->extent[2]);
+    }
+    else
+    {
+        box[3] = obb->extent[0];    box[4] = 0.0f;              box[5] = 0.0f;
+        box[6] = 0.0f;              box[7] = obb->extent[1];    box[8] = 0.0f;
+        box[9] = 0.0f;              box[10] = 0.0f;             box[11] = obb->extent[2];
+    }
+}
+
+/**
+ * Conservative test: true if the box is fully behind one of frustum planes,
+ * so it can't be visible; false means exact test is needed.
+ * Scalar version is always built, it is the reference for the kernels bench.
+ */
+static bool Frustum_IsBoxOutsidePlanesScalar(const struct frustum_s *frustum, const float box[12])
+{
+    const uint32_t stride = FRUSTUM_SOA_STRIDE(frustum->vertex_count);
+    const float *nx = frustum->planes_soa;
+    const float *ny = nx + stride;
+    const float *nz = ny + stride;
+    const float *nw = nz + stride;
+
+    for(uint32_t i = 0; i < stride; i++)
+    {
+        float dist = nx[i] * box[0] + ny[i] * box[1] + nz[i] * box[2] + nw[i];
+        float r = fabsf(nx[i] * box[3] + ny[i] * box[4] + nz[i] * box[5]) +
+                  fabsf(nx[i] * box[6] + ny[i] * box[7] + nz[i] * box[8]) +
+                  fabsf(nx[i] * box[9] + ny[i] * box[10] + nz[i] * box[11]);
+        if(dist + r < -SPLIT_EPSILON)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool Frustum_IsBoxOutsidePlanes(const struct frustum_s *frustum, const float box[12])
+{
+#if defined(FRUSTUM_SSE)
+    const uint32_t stride = FRUSTUM_SOA_STRIDE(frustum->vertex_count);
+    const float *nx = frustum->planes_soa;
+    const float *ny = nx + stride;
+    const float *nz = ny + stride;
+    const float *nw = nz + stride;
+
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 eps = _mm_set1_ps(-SPLIT_EPSILON);
+    for(uint32_t i = 0; i < stride; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(nx + i);
+        __m128 y = _mm_loadu_ps(ny + i);
+        __m128 z = _mm_loadu_ps(nz + i);
+        __m128 dist = _mm_add_ps(_mm_loadu_ps(nw + i), _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(box[0])),
+                                 _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(box[1])), _mm_mul_ps(z, _mm_set1_ps(box[2])))));
+        __m128 r0 = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(box[3])), _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(box[4])), _mm_mul_ps(z, _mm_set1_ps(box[5]))));
+        __m128 r1 = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(box[6])), _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(box[7])), _mm_mul_ps(z, _mm_set1_ps(box[8]))));
+        __m128 r2 = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(box[9])), _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(box[10])), _mm_mul_ps(z, _mm_set1_ps(box[11]))));
+        __m128 r = _mm_add_ps(_mm_andnot_ps(sign_mask, r0), _mm_add_ps(_mm_andnot_ps(sign_mask, r1), _mm_andnot_ps(sign_mask, r2)));
+        if(_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, r), eps)))
+        {
+            return true;
+        }
+    }
+#elif defined(FRUSTUM_NEON)
+    const uint32_t stride = FRUSTUM_SOA_STRIDE(frustum->vertex_count);
+    const float *nx = frustum->planes_soa;
+    const float *ny = nx + stride;
+    const float *nz = ny + stride;
+    const float *nw = nz + stride;
+    const float32x4_t eps = vdupq_n_f32(-SPLIT_EPSILON);
+    for(uint32_t i = 0; i < stride; i += 4)
+    {
+        float32x4_t x = vld1q_f32(nx + i);
+        float32x4_t y = vld1q_f32(ny + i);
+        float32x4_t z = vld1q_f32(nz + i);
+        float32x4_t dist = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vld1q_f32(nw + i), x, box[0]), y, box[1]), z, box[2]);
+        float32x4_t r0 = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, box[3]), y, box[4]), z, box[5]);
+        float32x4_t r1 = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, box[6]), y, box[7]), z, box[8]);
+        float32x4_t r2 = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, box[9]), y, box[10]), z, box[11]);
+        float32x4_t r = vaddq_f32(vabsq_f32(r0), vaddq_f32(vabsq_f32(r1), vabsq_f32(r2)));
+        uint32x4_t out = vcltq_f32(vaddq_f32(dist, r), eps);
+        uint32x2_t out2 = vorr_u32(vget_low_u32(out), vget_high_u32(out));
+        if(vget_lane_u32(vpmax_u32(out2, out2), 0))
+        {
+            return true;
+        }
+    }
+#else
+    return Frustum_IsBoxOutsidePlanesScalar(frustum, box);
+#endif
+
+    return false;
+}
+
+/**
+ * Micro-benchmark: both planes kernels run over the same prepared boxes and
+ * frustum list, ticks are summed per frame; then every box / frustum pair
+ * result is compared, any difference is a kernel error.
+ */
+static void Frustum_BenchPlanesKernels(const float *boxes, uint32_t count, const struct frustum_s *frustum)
+{
+    uint32_t scalar_rejected = 0;
+    uint32_t simd_rejected = 0;
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    for(const struct frustum_s *f = frustum; f; f = f->next)
+    {
+        if(f->planes_soa)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                scalar_rejected += Frustum_IsBoxOutsidePlanesScalar(f, boxes + 12 * i) ? (1) : (0);
+            }
+        }
+    }
+    uint64_t middle = SDL_GetPerformanceCounter();
+    for(const struct frustum_s *f = frustum; f; f = f->next)
+    {
+        if(f->planes_soa)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                simd_rejected += Frustum_IsBoxOutsidePlanes(f, boxes + 12 * i) ? (1) : (0);
+            }
+        }
+    }
+    obb_bench_simd += SDL_GetPerformanceCounter() - middle;
+    obb_bench_scalar += middle - start;
+
+    // timed loops results are summed only, so they can't be dropped by compiler; pairs are compared here
+    for(const struct frustum_s *f = frustum; f; f = f->next)
+    {
+        if(f->planes_soa)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                if(Frustum_IsBoxOutsidePlanesScalar(f, boxes + 12 * i) != Frustum_IsBoxOutsidePlanes(f, boxes + 12 * i))
+                {
+                    obb_bench_mismatches++;
+                }
+            }
+        }
+    }
+    obb_bench_rejected = scalar_rejected + simd_rejected;
+}
+
+static bool Frustum_IsOBBBoxVisibleInFrustumList(struct obb_s *obb, const float box[12], struct frustum_s *frustum)
+{
+    obb_tests++;
     for(; frustum; frustum = frustum->next)
     {
+        if(frustum->planes_soa && Frustum_IsBoxOutsidePlanes(frustum, box))
+        {
+            obb_planes_rejected++;
+            continue;
+        }
         if(Frustum_IsOBBVisible(obb, frustum))
         {
             return true;
@@ -688,6 +889,102 @@ bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frus
     return false;
 }
 
+bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum)
+{
+    float box[12];
+    Frustum_PrepareOBBBox(obb, box);
+    return Frustum_IsOBBBoxVisibleInFrustumList(obb, box, frustum);
+}
+
+/**
+ * Batched visibility: all boxes are prepared at once, then tested against the
+ * frustum list; visible[i] receives 1 / 0 for obbs[i].
+ */
+uint32_t Frustum_ClassifyOBBsInFrustumList(struct obb_s **obbs, uint32_t count, struct frustum_s *frustum, uint8_t *visible)
+{
+    uint32_t ret = 0;
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+    float *boxes = (float*)Sys_GetTempMem(12 * count * sizeof(float));
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        Frustum_PrepareOBBBox(obbs[i], boxes + 12 * i);
+    }
+
+    if(obb_bench)
+    {
+        Frustum_BenchPlanesKernels(boxes, count, frustum);
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        visible[i] = Frustum_IsOBBBoxVisibleInFrustumList(obbs[i], boxes + 12 * i, frustum) ? (1) : (0);
+        ret += visible[i];
+    }
+    Sys_RollbackTempMem(temp_marker);
+
+    return ret;
+}
+
+void Frustum_GenPlanesSoA(struct frustum_s *frustum)
+{
+    if(frustum->planes_soa && frustum->planes)
+    {
+        const uint32_t stride = FRUSTUM_SOA_STRIDE(frustum->vertex_count);
+        float *soa = frustum->planes_soa;
+        float *n = frustum->planes;
+        uint32_t i = 0;
+
+        for(; i < frustum->vertex_count; i++, n += 4)
+        {
+            soa[i] = n[0];
+            soa[stride + i] = n[1];
+            soa[2 * stride + i] = n[2];
+            soa[3 * stride + i] = n[3];
+        }
+        soa[i] = frustum->norm[0];
+        soa[stride + i] = frustum->norm[1];
+        soa[2 * stride + i] = frustum->norm[2];
+        soa[3 * stride + i] = frustum->norm[3];
+        for(i++; i < stride; i++)
+        {
+            soa[i] = 0.0f;
+            soa[stride + i] = 0.0f;
+            soa[2 * stride + i] = 0.0f;
+            soa[3 * stride + i] = 1.0f;                                         // never rejects
+        }
+    }
+}
+
+void Frustum_ResetOBBStats()
+{
+    obb_tests = 0;
+    obb_planes_rejected = 0;
+    obb_bench_scalar = 0;
+    obb_bench_simd = 0;
+    obb_bench_mismatches = 0;
+}
+
+void Frustum_GetOBBStats(uint32_t *tested, uint32_t *planes_rejected)
+{
+    *tested = obb_tests;
+    *planes_rejected = obb_planes_rejected;
+}
+
+void Frustum_SetOBBBench(bool enabled)
+{
+    obb_bench = enabled;
+}
+
+bool Frustum_GetOBBBench(uint32_t *scalar_us, uint32_t *simd_us, uint32_t *mismatches)
+{
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    *scalar_us = (uint32_t)(obb_bench_scalar * 1000000 / freq);
+    *simd_us = (uint32_t)(obb_bench_simd * 1000000 / freq);
+    *mismatches = obb_bench_mismatches;
+    return obb_bench;
+}
+
 /*
  * PORTALS
  */
@@ -9,6 +9,14 @@ struct room_s;
 struct camera_s;
 struct obb_s;
 
+/*
+ * SoA copy of frustum planes for box tests: x, y, z, w arrays of
+ * FRUSTUM_SOA_STRIDE floats each; side planes, then main clip plane (norm),
+ * padded by planes that never reject.
+ */
+#define FRUSTUM_SOA_STRIDE(planes_count)    ((((planes_count) + 1) + 3) & ~3)
+#define FRUSTUM_SOA_SIZE(planes_count)      (4 * FRUSTUM_SOA_STRIDE(planes_count))
+
 
 typedef struct portal_s
 {
@@ -26,11 +34,13 @@ typedef struct frustum_s
     uint16_t            parents_count;
     
     float              *planes;                                                 // clip planes
+    float              *planes_soa;                                             // FRUSTUM_SOA_SIZE(vertex_count) floats or NULL
     float              *vertex;                                                 // frustum vertices
     float              *cam_pos;                                                ///@TODO: delete it!
     float               norm[4];                                                // main frustum clip plane (inv. plane of parent portal)
 
     struct frustum_s   *parent;                                                 // by who frustum was generated; parent == NULL is equal generated by camera
+    struct portal_s    *portal;                                                 // through which portal frustum was generated
     struct frustum_s   *next;                                                   // next frustum in list
 }frustum_t, *frustum_p;
 
@@ -43,6 +53,7 @@ public:
     
     void Reset();
     frustum_p PortalFrustumIntersect(struct portal_s *portal, frustum_p emitter, struct camera_s *cam);
+    void GetStats(uint32_t *generated, uint32_t *allocated, uint32_t *high_water, uint32_t *buffer_size);
 
 private:
     float *Alloc(uint32_t size);
@@ -54,6 +65,8 @@ private:
     bool m_need_realloc;
     uint32_t m_buffer_size;
     uint32_t m_allocated;
+    uint32_t m_high_water;
+    uint32_t m_generated;
     uint8_t *m_buffer;
 };
 
@@ -62,6 +75,13 @@ bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool
 bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *frustum);
 bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum);
 bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum);
+uint32_t Frustum_ClassifyOBBsInFrustumList(struct obb_s **obbs, uint32_t count, struct frustum_s *frustum, uint8_t *visible);  // returns visible count
+
+void Frustum_GenPlanesSoA(struct frustum_s *frustum);
+void Frustum_ResetOBBStats();
+void Frustum_GetOBBStats(uint32_t *tested, uint32_t *planes_rejected);
+void Frustum_SetOBBBench(bool enabled);                                         // time scalar vs SIMD planes kernels on batched boxes
+bool Frustum_GetOBBBench(uint32_t *scalar_us, uint32_t *simd_us, uint32_t *mismatches);  // returns bench state
 
 
 portal_p Portal_Create(unsigned int vcount);
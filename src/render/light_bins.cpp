@@ -0,0 +1,188 @@
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../core/vmath.h"
+#include "../mesh.h"
+#include "light_bins.h"
+
+
+float Light_GetScore(const struct light_s *light, const float pos[3])
+{
+    float brightness;
+    float range, dist;
+
+    switch(light->light_type)
+    {
+        case LT_POINT:
+        case LT_SHADOW:
+            range = fabsf(light->outer) + LIGHT_BINS_RANGE_MARGIN;
+            dist = vec3_dist(light->pos, pos);
+            if(dist > range)
+            {
+                return -1.0f;
+            }
+            brightness = (light->colour[0] > light->colour[1]) ? (light->colour[0]) : (light->colour[1]);
+            brightness = (brightness > light->colour[2]) ? (brightness) : (light->colour[2]);
+            brightness = (brightness < 0.0f) ? (0.0f) : ((brightness > 1.0f) ? (1.0f) : (brightness));
+            return brightness * (1.0f - dist / range);
+
+        default:
+            return -1.0f;                                                       // suns are kept apart, spot lights are not used by entities shaders
+    };
+}
+
+static int LightBins_IsCellReached(const struct light_s *light, const float cell_min[3], const float cell_max[3])
+{
+    float range, d, dist_sq = 0.0f;
+
+    if((light->light_type != LT_POINT) && (light->light_type != LT_SHADOW))
+    {
+        return 0;
+    }
+
+    for(int i = 0; i < 3; i++)
+    {
+        d = (light->pos[i] < cell_min[i]) ? (cell_min[i] - light->pos[i]) : ((light->pos[i] > cell_max[i]) ? (light->pos[i] - cell_max[i]) : (0.0f));
+        dist_sq += d * d;
+    }
+    range = fabsf(light->outer) + LIGHT_BINS_RANGE_MARGIN;
+
+    return dist_sq <= range * range;
+}
+
+
+light_bins_p LightBins_Create(const float bb_min[3], const float bb_max[3], const struct light_s *lights, uint32_t lights_count, uint16_t cell_lights)
+{
+    light_bins_p bins;
+    uint32_t cells_count = 1;
+    float *scores;
+
+    if((lights_count == 0) || (cell_lights == 0))
+    {
+        return NULL;
+    }
+
+    bins = (light_bins_p)malloc(sizeof(light_bins_t));
+    vec3_copy(bins->min, bb_min);
+    for(int i = 0; i < 3; i++)
+    {
+        float size = ceilf((bb_max[i] - bb_min[i]) / LIGHT_BINS_CELL_SIZE);
+        bins->size[i] = (size < 1.0f) ? (1) : ((size > 256.0f) ? (256) : ((uint16_t)size));
+        cells_count *= bins->size[i];
+    }
+    bins->cell_lights = cell_lights;
+    bins->suns_count = 0;
+    bins->suns = NULL;
+    for(uint32_t i = 0; (i < lights_count) && (i < 0xFFFF); i++)
+    {
+        if(lights[i].light_type == LT_SUN)
+        {
+            bins->suns_count++;
+        }
+    }
+    if(bins->suns_count > 0)
+    {
+        bins->suns = (uint16_t*)malloc(bins->suns_count * sizeof(uint16_t));
+        bins->suns_count = 0;
+        for(uint32_t i = 0; (i < lights_count) && (i < 0xFFFF); i++)
+        {
+            if(lights[i].light_type == LT_SUN)
+            {
+                bins->suns[bins->suns_count++] = i;
+            }
+        }
+    }
+    bins->counts = (uint16_t*)calloc(cells_count, sizeof(uint16_t));
+    bins->lights = (uint16_t*)malloc(cells_count * cell_lights * sizeof(uint16_t));
+    scores = (float*)malloc(cell_lights * sizeof(float));
+
+    for(uint16_t z = 0; z < bins->size[2]; z++)
+    {
+        for(uint16_t y = 0; y < bins->size[1]; y++)
+        {
+            for(uint16_t x = 0; x < bins->size[0]; x++)
+            {
+                uint32_t cell = (z * bins->size[1] + y) * bins->size[0] + x;
+                uint16_t *cell_indexes = bins->lights + cell * cell_lights;
+                uint16_t *count = bins->counts + cell;
+                float cell_min[3], cell_max[3], centre[3];
+
+                cell_min[0] = bins->min[0] + x * LIGHT_BINS_CELL_SIZE;
+                cell_min[1] = bins->min[1] + y * LIGHT_BINS_CELL_SIZE;
+                cell_min[2] = bins->min[2] + z * LIGHT_BINS_CELL_SIZE;
+                vec3_copy(cell_max, cell_min);
+                cell_max[0] += LIGHT_BINS_CELL_SIZE;
+                cell_max[1] += LIGHT_BINS_CELL_SIZE;
+                cell_max[2] += LIGHT_BINS_CELL_SIZE;
+                vec3_add(centre, cell_min, cell_max);
+                vec3_mul_scalar(centre, centre, 0.5f);
+
+                for(uint32_t i = 0; (i < lights_count) && (i < 0xFFFF); i++)
+                {
+                    if(!LightBins_IsCellReached(lights + i, cell_min, cell_max))
+                    {
+                        continue;
+                    }
+
+                    // insertion into cell list, sorted by score in cell centre
+                    float score = Light_GetScore(lights + i, centre);
+                    uint16_t j = (*count < cell_lights) ? ((*count)++) : (cell_lights);
+                    for( ; (j > 0) && (scores[j - 1] < score); j--)
+                    {
+                        if(j < cell_lights)
+                        {
+                            scores[j] = scores[j - 1];
+                            cell_indexes[j] = cell_indexes[j - 1];
+                        }
+                    }
+                    if(j < cell_lights)
+                    {
+                        scores[j] = score;
+                        cell_indexes[j] = i;
+                    }
+                }
+            }
+        }
+    }
+
+    free(scores);
+    return bins;
+}
+
+void LightBins_Clear(light_bins_p bins)
+{
+    if(bins)
+    {
+        free(bins->counts);
+        bins->counts = NULL;
+        free(bins->lights);
+        bins->lights = NULL;
+        free(bins->suns);
+        bins->suns = NULL;
+        bins->suns_count = 0;
+        free(bins);
+    }
+}
+
+const uint16_t *LightBins_GetCell(const light_bins_t *bins, const float pos[3], uint16_t *count)
+{
+    uint32_t cell = 0;
+
+    if(bins == NULL)
+    {
+        *count = 0;
+        return NULL;
+    }
+
+    for(int i = 2; i >= 0; i--)
+    {
+        int32_t c = (int32_t)floorf((pos[i] - bins->min[i]) / LIGHT_BINS_CELL_SIZE);
+        c = (c < 0) ? (0) : ((c >= bins->size[i]) ? (bins->size[i] - 1) : (c));
+        cell = cell * bins->size[i] + c;
+    }
+
+    *count = bins->counts[cell];
+    return bins->lights + cell * bins->cell_lights;
+}
@@ -0,0 +1,35 @@
+
+#ifndef LIGHT_BINS_H
+#define LIGHT_BINS_H
+
+#include <stdint.h>
+
+struct light_s;
+
+#define LIGHT_BINS_CELL_SIZE            (1024.0f)                               // one room sector
+#define LIGHT_BINS_RANGE_MARGIN         (1024.0f)                               // lights reach outer radius + margin
+
+/*
+ * Room lights grid, built on level load: every cell of room bounding box keeps
+ * up to cell_lights room point lights, that reaches the cell, ordered by their
+ * contribution in the cell centre. Sun lights reach every cell, so they are
+ * not binned and kept in separate list.
+ */
+typedef struct light_bins_s
+{
+    float                   min[3];
+    uint16_t                size[3];                                            // cells count by axis
+    uint16_t                cell_lights;                                        // max lights per cell
+    uint16_t               *counts;                                             // lights in cell
+    uint16_t               *lights;                                             // cell_lights room lights indexes per cell
+    uint16_t                suns_count;
+    uint16_t               *suns;                                               // room sun lights indexes
+}light_bins_t, *light_bins_p;
+
+light_bins_p LightBins_Create(const float bb_min[3], const float bb_max[3], const struct light_s *lights, uint32_t lights_count, uint16_t cell_lights);
+void LightBins_Clear(light_bins_p bins);
+const uint16_t *LightBins_GetCell(const light_bins_t *bins, const float pos[3], uint16_t *count);    // pos is clamped to grid
+
+float Light_GetScore(const struct light_s *light, const float pos[3]);        // < 0 if light doesn't reach pos
+
+#endif
@@ -0,0 +1,327 @@
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE   (1)
+#endif
+
+#include "../core/vmath.h"
+#include "../core/polygon.h"
+#include "../core/obb.h"
+#include "occlusion_buffer.h"
+
+
+#define OCCLUSION_MIN_W     (1.0e-4f)
+
+static void Occlusion_ToClip(float out[4], const float m[16], const float v[3])
+{
+    out[0] = m[0] * v[0] + m[4] * v[1] + m[8]  * v[2] + m[12];
+    out[1] = m[1] * v[0] + m[5] * v[1] + m[9]  * v[2] + m[13];
+    out[2] = m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14];
+    out[3] = m[3] * v[0] + m[7] * v[1] + m[11] * v[2] + m[15];
+}
+
+
+COcclusionBuffer::COcclusionBuffer(uint16_t width, uint16_t height):
+m_width(width),
+m_height(height),
+m_tiles_x(width / OCCLUSION_TILE_SIZE),
+m_tiles_y(height / OCCLUSION_TILE_SIZE),
+m_triangles(0),
+m_tests(0),
+m_occluded(0)
+{
+    m_depth = (float*)malloc(m_width * m_height * sizeof(float));
+    m_tiles = (float*)malloc(m_tiles_x * m_tiles_y * sizeof(float));
+    Mat4_E_macro(m_view_proj);
+}
+
+COcclusionBuffer::~COcclusionBuffer()
+{
+    free(m_depth);
+    m_depth = NULL;
+    free(m_tiles);
+    m_tiles = NULL;
+    m_width = 0;
+    m_height = 0;
+}
+
+void COcclusionBuffer::Reset(const float view_proj[16])
+{
+    memcpy(m_view_proj, view_proj, sizeof(m_view_proj));
+    for(uint32_t i = 0; i < (uint32_t)m_width * m_height; i++)
+    {
+        m_depth[i] = 1.0f;
+    }
+    for(uint32_t i = 0; i < (uint32_t)m_tiles_x * m_tiles_y; i++)
+    {
+        m_tiles[i] = 1.0f;
+    }
+    m_triangles = 0;
+    m_tests = 0;
+    m_occluded = 0;
+}
+
+void COcclusionBuffer::ToScreen(float out[3], const float clip[4])
+{
+    float inv_w = 1.0f / clip[3];
+    out[0] = (clip[0] * inv_w * 0.5f + 0.5f) * m_width;
+    out[1] = (clip[1] * inv_w * 0.5f + 0.5f) * m_height;
+    out[2] = clip[2] * inv_w * 0.5f + 0.5f;
+}
+
+/**
+ * Triangle is clipped by near plane only (z > -w), other planes are handled
+ * by screen bounding rectangle clamping in rasterizer.
+ */
+void COcclusionBuffer::AddOccluder(const float v0[3], const float v1[3], const float v2[3])
+{
+    float clip[3][4], poly[4][4], screen[4][3];
+    float dist[3];
+    int inside = 0, count = 0;
+
+    Occlusion_ToClip(clip[0], m_view_proj, v0);
+    Occlusion_ToClip(clip[1], m_view_proj, v1);
+    Occlusion_ToClip(clip[2], m_view_proj, v2);
+    for(int i = 0; i < 3; i++)
+    {
+        dist[i] = clip[i][2] + clip[i][3];
+        inside += (dist[i] > 0.0f) && (clip[i][3] > OCCLUSION_MIN_W);
+    }
+
+    if(inside == 0)
+    {
+        return;
+    }
+
+    if(inside == 3)
+    {
+        memcpy(poly, clip, sizeof(clip));
+        count = 3;
+    }
+    else
+    {
+        for(int i = 0, j = 2; i < 3; j = i++)
+        {
+            if(dist[j] > 0.0f)
+            {
+                memcpy(poly[count++], clip[j], 4 * sizeof(float));
+            }
+            if((dist[j] > 0.0f) != (dist[i] > 0.0f))
+            {
+                float t = dist[j] / (dist[j] - dist[i]);
+                for(int k = 0; k < 4; k++)
+                {
+                    poly[count][k] = clip[j][k] + t * (clip[i][k] - clip[j][k]);
+                }
+                count++;
+            }
+        }
+    }
+
+    for(int i = 0; i < count; i++)
+    {
+        if(poly[i][3] <= OCCLUSION_MIN_W)
+        {
+            return;                                                             // degenerated by clipping
+        }
+        this->ToScreen(screen[i], poly[i]);
+    }
+
+    for(int i = 2; i < count; i++)
+    {
+        this->RasterizeTriangle(screen[0], screen[i - 1], screen[i]);
+    }
+    m_triangles++;
+}
+
+void COcclusionBuffer::RasterizeTriangle(const float v0[3], const float v1[3], const float v2[3])
+{
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+    const float *p[3] = {v0, v1, v2};
+    float A[3], B[3], C[3], z;
+    int min_x, max_x, min_y, max_y;
+
+    if(fabsf(area) < 1.0e-6f)
+    {
+        return;
+    }
+    if(area < 0.0f)
+    {
+        p[1] = v2;
+        p[2] = v1;
+    }
+
+    min_x = (int)floorf(fminf(p[0][0], fminf(p[1][0], p[2][0])));
+    max_x = (int)ceilf(fmaxf(p[0][0], fmaxf(p[1][0], p[2][0])));
+    min_y = (int)floorf(fminf(p[0][1], fminf(p[1][1], p[2][1])));
+    max_y = (int)ceilf(fmaxf(p[0][1], fmaxf(p[1][1], p[2][1])));
+    min_x = (min_x < 0) ? (0) : (min_x & ~3);
+    min_y = (min_y < 0) ? (0) : (min_y);
+    max_x = (max_x >= m_width) ? (m_width - 1) : (max_x);
+    max_y = (max_y >= m_height) ? (m_height - 1) : (max_y);
+    if((min_x > max_x) || (min_y > max_y))
+    {
+        return;
+    }
+
+    z = fmaxf(p[0][2], fmaxf(p[1][2], p[2][2]));                                // conservative: farthest depth
+    z = (z > 1.0f) ? (1.0f) : (z);
+
+    // edge a->b: (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x) >= 0 inside;
+    // edges are moved inward by half pixel, so only fully covered pixels are written
+    for(int i = 0; i < 3; i++)
+    {
+        const float *a = p[i];
+        const float *b = p[(i + 1) % 3];
+        A[i] = a[1] - b[1];
+        B[i] = b[0] - a[0];
+        C[i] = -A[i] * a[0] - B[i] * a[1] - 0.5f * (fabsf(A[i]) + fabsf(B[i]));
+    }
+
+    for(int y = min_y; y <= max_y; y++)
+    {
+        float py = (float)y + 0.5f;
+        float *row = m_depth + y * m_width;
+#if defined(OCCLUSION_SSE)
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 depth = _mm_set1_ps(z);
+        const __m128 step = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        __m128 a0 = _mm_set1_ps(A[0]), a1 = _mm_set1_ps(A[1]), a2 = _mm_set1_ps(A[2]);
+        __m128 r0 = _mm_set1_ps(B[0] * py + C[0]);
+        __m128 r1 = _mm_set1_ps(B[1] * py + C[1]);
+        __m128 r2 = _mm_set1_ps(B[2] * py + C[2]);
+        for(int x = min_x; x <= max_x; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), step);
+            __m128 mask = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), r0), zero),
+                          _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), r1), zero),
+                                     _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), r2), zero)));
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 upd = _mm_min_ps(old, depth);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, upd), _mm_andnot_ps(mask, old)));
+        }
+#else
+        for(int x = min_x; x <= max_x; x++)
+        {
+            float px = (float)x + 0.5f;
+            if((A[0] * px + B[0] * py + C[0] >= 0.0f) &&
+               (A[1] * px + B[1] * py + C[1] >= 0.0f) &&
+               (A[2] * px + B[2] * py + C[2] >= 0.0f) && (row[x] > z))
+            {
+                row[x] = z;
+            }
+        }
+#endif
+    }
+}
+
+void COcclusionBuffer::UpdateTiles()
+{
+    for(uint16_t ty = 0; ty < m_tiles_y; ty++)
+    {
+        for(uint16_t tx = 0; tx < m_tiles_x; tx++)
+        {
+            float max_depth = 0.0f;
+            for(int y = 0; y < OCCLUSION_TILE_SIZE; y++)
+            {
+                const float *row = m_depth + (ty * OCCLUSION_TILE_SIZE + y) * m_width + tx * OCCLUSION_TILE_SIZE;
+                for(int x = 0; x < OCCLUSION_TILE_SIZE; x++)
+                {
+                    max_depth = (row[x] > max_depth) ? (row[x]) : (max_depth);
+                }
+            }
+            m_tiles[ty * m_tiles_x + tx] = max_depth;
+        }
+    }
+}
+
+/**
+ * Box is occluded if its nearest depth is behind occluders depth in every
+ * pixel of its screen rectangle. Boxes crossing near plane are visible.
+ */
+bool COcclusionBuffer::IsOBBOccluded(struct obb_s *obb)
+{
+    float axes[3][3], corner[3], clip[4], screen[3];
+    float min_x = (float)m_width, max_x = 0.0f, min_y = (float)m_height, max_y = 0.0f, min_z = 1.0f;
+
+    m_tests++;
+    for(int i = 0; i < 3; i++)
+    {
+        if(obb->transform)
+        {
+            vec3_mul_scalar(axes[i], obb->transform + 4 * i, obb->extent[i]);
+        }
+        else
+        {
+            vec3_set_zero(axes[i]);
+            axes[i][i] = obb->extent[i];
+        }
+    }
+
+    for(int i = 0; i < 8; i++)
+    {
+        for(int k = 0; k < 3; k++)
+        {
+            corner[k] = obb->centre[k] + ((i & 1) ? (axes[0][k]) : (-axes[0][k]))
+                                       + ((i & 2) ? (axes[1][k]) : (-axes[1][k]))
+                                       + ((i & 4) ? (axes[2][k]) : (-axes[2][k]));
+        }
+        Occlusion_ToClip(clip, m_view_proj, corner);
+        if((clip[3] <= OCCLUSION_MIN_W) || (clip[2] + clip[3] <= 0.0f))
+        {
+            return false;
+        }
+        this->ToScreen(screen, clip);
+        min_x = fminf(min_x, screen[0]);
+        max_x = fmaxf(max_x, screen[0]);
+        min_y = fminf(min_y, screen[1]);
+        max_y = fmaxf(max_y, screen[1]);
+        min_z = fminf(min_z, screen[2]);
+    }
+
+    int x0 = (int)floorf(min_x), x1 = (int)floorf(max_x);
+    int y0 = (int)floorf(min_y), y1 = (int)floorf(max_y);
+    x0 = (x0 < 0) ? (0) : (x0);
+    y0 = (y0 < 0) ? (0) : (y0);
+    x1 = (x1 >= m_width) ? (m_width - 1) : (x1);
+    y1 = (y1 >= m_height) ? (m_height - 1) : (y1);
+    if((x0 > x1) || (y0 > y1))
+    {
+        return false;                                                           // off screen: frustum culling business
+    }
+
+    for(int ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / OCCLUSION_TILE_SIZE; ty++)
+    {
+        for(int tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / OCCLUSION_TILE_SIZE; tx++)
+        {
+            if(m_tiles[ty * m_tiles_x + tx] < min_z)
+            {
+                continue;                                                       // whole tile is in front of the box
+            }
+
+            int py0 = ty * OCCLUSION_TILE_SIZE, py1 = py0 + OCCLUSION_TILE_SIZE - 1;
+            int px0 = tx * OCCLUSION_TILE_SIZE, px1 = px0 + OCCLUSION_TILE_SIZE - 1;
+            py0 = (py0 < y0) ? (y0) : (py0);
+            py1 = (py1 > y1) ? (y1) : (py1);
+            px0 = (px0 < x0) ? (x0) : (px0);
+            px1 = (px1 > x1) ? (x1) : (px1);
+            for(int y = py0; y <= py1; y++)
+            {
+                const float *row = m_depth + y * m_width;
+                for(int x = px0; x <= px1; x++)
+                {
+                    if(row[x] >= min_z)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    m_occluded++;
+    return true;
+}
@@ -0,0 +1,53 @@
+
+#ifndef OCCLUSION_BUFFER_H
+#define OCCLUSION_BUFFER_H
+
+#include <stdint.h>
+
+struct obb_s;
+
+#define OCCLUSION_BUFFER_WIDTH          (256)                                   // multiple of OCCLUSION_TILE_SIZE
+#define OCCLUSION_BUFFER_HEIGHT         (128)
+#define OCCLUSION_TILE_SIZE             (8)
+#define OCCLUSION_MIN_AREA              (256.0f * 1024.0f)                      // smaller room polygons are not occluders
+
+/*
+ * Software occlusion: low resolution depth buffer, rasterized on CPU from
+ * room occluder triangles. Depth is conservative: every triangle writes its
+ * farthest vertex depth only to pixels it covers completely, and the tiles
+ * keep the farthest depth of their pixels, so most of occluded boxes are
+ * rejected by tiles only.
+ */
+class COcclusionBuffer
+{
+public:
+    COcclusionBuffer(uint16_t width, uint16_t height);
+   ~COcclusionBuffer();
+
+    void Reset(const float view_proj[16]);
+    void AddOccluder(const float v0[3], const float v1[3], const float v2[3]);  // world space triangle, no backface test
+    void UpdateTiles();                                                         // after all occluders, before tests
+    bool IsOBBOccluded(struct obb_s *obb);
+
+    uint32_t GetTrianglesCount() const {return m_triangles;}
+    uint32_t GetTestsCount() const {return m_tests;}
+    uint32_t GetOccludedCount() const {return m_occluded;}
+
+private:
+    void RasterizeTriangle(const float v0[3], const float v1[3], const float v2[3]);    // screen x, y, depth [0, 1]
+    void ToScreen(float out[3], const float clip[4]);
+
+    uint16_t    m_width;
+    uint16_t    m_height;
+    uint16_t    m_tiles_x;
+    uint16_t    m_tiles_y;
+    float      *m_depth;                                                        // nearest occluder depth per pixel, 1.0 is empty
+    float      *m_tiles;                                                        // farthest depth per tile
+    float       m_view_proj[16];
+
+    uint32_t    m_triangles;
+    uint32_t    m_tests;
+    uint32_t    m_occluded;
+};
+
+#endif
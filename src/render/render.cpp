@@ -3,6 +3,11 @@
 #include <stdlib.h>
 #include <SDL2/SDL_platform.h>
 #include <SDL2/SDL_opengl.h>
+#include <SDL2/SDL_timer.h>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RENDER_SSE      (1)
+#endif
 
 #include "../core/gl_util.h"
 #include "../core/gl_text.h"
@@ -16,7 +21,12 @@
 #include "../vt/tr_versions.h"
 #include "camera.h"
 #include "render.h"
+#include "render_device.h"
+#include "render_queue.h"
 #include "bsp_tree.h"
+#include "transparency_batches.h"
+#include "light_bins.h"
+#include "occlusion_buffer.h"
 #include "frustum.h"
 #include "shader_description.h"
 #include "shader_manager.h"
@@ -40,6 +50,9 @@ void CalculateWaterTint(GLfloat *tint, uint8_t fixed_colour);
 
 CRender::CRender():
 m_camera(NULL),
+m_device(NULL),
+m_gl_device(NULL),
+m_null_device(NULL),
 m_rooms(NULL),
 m_rooms_count(0),
 m_anim_sequences(NULL),
@@ -49,16 +62,42 @@ m_active_texture(0),
 r_list_size(0),
 r_list_active_count(0),
 r_list(NULL),
+m_portal_queue_size(R_PORTAL_QUEUE_DEFAULT_SIZE),
+m_portal_queue_count(0),
+m_portal_queue(NULL),
+m_rooms_visited(0),
+m_frustums_merged(0),
+m_frustums_dropped(0),
+m_skin_buffer(0),
+m_skin_buffer_size(0),
+m_transparency_batches(NULL),
+m_prebuilt_polygons(0),
+m_prebuilt_splits(0),
+m_transparency_time(0),
+m_light_setups(0),
+m_light_candidates(0),
+m_light_bins_cells(0),
+m_occlusion(NULL),
+m_occlusion_active(false),
+m_occlusion_time(0),
 frustumManager(NULL),
+renderQueue(NULL),
 shaderManager(NULL),
 debugDrawer(NULL),
 dynamicBSP(NULL),
 r_flags(0x00)
 {
     this->InitSettings();
+    m_gl_device    = new CGLRenderDevice();
+    m_null_device  = new CRenderDevice();
+    m_device       = m_gl_device;
     frustumManager = new CFrustumManager(32768);
+    renderQueue    = new CRenderQueue(8192);
+    m_portal_queue = (struct portal_queue_item_s*)malloc(m_portal_queue_size * sizeof(struct portal_queue_item_s));
     debugDrawer    = new CRenderDebugDrawer();
     dynamicBSP     = new CDynamicBSP(512 * 1024);
+    m_transparency_batches = new CTransparencyBatches(8192);
+    m_occlusion    = new COcclusionBuffer(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
 }
 
 CRender::~CRender()
@@ -79,6 +118,20 @@ CRender::~CRender()
         frustumManager = NULL;
     }
 
+    if(m_portal_queue)
+    {
+        free(m_portal_queue);
+        m_portal_queue = NULL;
+        m_portal_queue_size = 0;
+        m_portal_queue_count = 0;
+    }
+
+    if(renderQueue)
+    {
+        delete renderQueue;
+        renderQueue = NULL;
+    }
+
     if(debugDrawer)
     {
         delete debugDrawer;
@@ -91,11 +144,30 @@ CRender::~CRender()
         dynamicBSP = NULL;
     }
 
+    if(m_transparency_batches)
+    {
+        delete m_transparency_batches;
+        m_transparency_batches = NULL;
+    }
+
+
+    if(m_occlusion)
+    {
+        delete m_occlusion;
+        m_occlusion = NULL;
+    }
+
     if(shaderManager)
     {
         delete shaderManager;
         shaderManager = NULL;
     }
+
+    m_device = NULL;
+    delete m_gl_device;
+    m_gl_device = NULL;
+    delete m_null_device;
+    m_null_device = NULL;
 }
 
 void CRender::InitSettings()
@@ -109,6 +181,9 @@ void CRender::InitSettings()
     settings.texture_border = 8;
     settings.z_depth = 16;
     settings.fog_enabled = 1;
+    settings.use_texture_array = 0;
+    settings.transparency_mode = RENDER_TRANSPARENCY_DYNAMIC_BSP;
+    settings.occlusion_culling = 0;
     settings.fog_color[0] = 0.0f;
     settings.fog_color[1] = 0.0f;
     settings.fog_color[2] = 0.0f;
@@ -120,7 +195,13 @@ void CRender::DoShaders()
 {
     if(shaderManager == NULL)
     {
-        shaderManager = new shader_manager();
+        if(settings.use_texture_array &&
+           ((qglTexImage3D == NULL) || (qglTexSubImage3D == NULL) || (qglGenerateMipmap == NULL) || !IsGLExtensionSupported("GL_EXT_texture_array")))
+        {
+            Con_Warning("GL_EXT_texture_array is not supported, texture_array option is off");
+            settings.use_texture_array = 0;
+        }
+        shaderManager = new shader_manager(settings.use_texture_array != 0);
     }
 }
 
@@ -129,6 +210,16 @@ void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim
     this->CleanList();
     r_flags = 0x00;
 
+    if(m_skin_buffer)
+    {
+        m_gl_device->DeleteBuffer(m_skin_buffer);
+        m_skin_buffer = 0;
+        m_skin_buffer_size = 0;
+    }
+
+    this->ClearRoomsTransparency();
+    this->ClearRoomsLightBins();
+    this->ClearRoomsOccluders();
     m_rooms = rooms;
     m_rooms_count = rooms_count;
     m_anim_sequences = anim_sequences;
@@ -156,6 +247,16 @@ void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim
         {
             m_rooms[i].is_in_r_list = 0;
         }
+
+        if(settings.transparency_mode == RENDER_TRANSPARENCY_BATCHES)
+        {
+            this->BuildRoomsTransparency();
+        }
+        this->BuildRoomsLightBins();
+        if(settings.occlusion_culling)
+        {
+            this->BuildRoomsOccluders();
+        }
     }
 }
 
@@ -230,11 +331,19 @@ void CRender::UpdateAnimTextures()
  */
 void CRender::GenWorldList(struct camera_s *cam)
 {
+    m_device->BeginFrame();
     this->CleanList();
     this->dynamicBSP->Reset(m_anim_sequences);
+    m_light_setups = 0;
+    m_light_candidates = 0;
+    Frustum_ResetOBBStats();
     this->frustumManager->Reset();
     cam->frustum->next = NULL;
     m_camera = cam;
+    m_portal_queue_count = 0;
+    m_rooms_visited = 0;
+    m_frustums_merged = 0;
+    m_frustums_dropped = 0;
 
     if(m_rooms == NULL)
     {
@@ -258,7 +367,7 @@ void CRender::GenWorldList(struct camera_s *cam)
             {
                 this->AddRoom(dest_room);                                       // portal destination room
                 last_frus->parents_count = 1;                                   // created by camera
-                this->ProcessRoom(p, last_frus);                                // next start reccursion algorithm
+                this->PushPortal(p, last_frus);                                 // will be processed breadth first
             }
             else if((cam_pos[0] <= dest_room->bb_max[0] + eps) && (cam_pos[0] >= dest_room->bb_min[0] - eps) &&
                     (cam_pos[1] <= dest_room->bb_max[1] + eps) && (cam_pos[1] >= dest_room->bb_min[1] - eps) &&
@@ -277,12 +386,13 @@ void CRender::GenWorldList(struct camera_s *cam)
                         {
                             this->AddRoom(ndest_room);                          // portal destination room
                             last_frus->parents_count = 1;                       // created by camera
-                            this->ProcessRoom(np, last_frus);                   // next start reccursion algorithm
+                            this->PushPortal(np, last_frus);
                         }
                     }
                 }
             }
         }
+        this->ProcessPortalQueue();
     }
     else                                                                        // camera is out of all rooms
     {
@@ -306,111 +416,55 @@ void CRender::DrawList()
     {
         if(r_flags & R_DRAW_WIRE)
         {
-            qglPolygonMode(GL_FRONT, GL_LINE);
+            m_device->PolygonMode(GL_FRONT, GL_LINE);
         }
         else if(r_flags & R_DRAW_POINTS)
         {
-            qglEnable(GL_POINT_SMOOTH);
-            qglPointSize(4);
-            qglPolygonMode(GL_FRONT, GL_POINT);
+            m_device->Enable(GL_POINT_SMOOTH);
+            m_device->PointSize(4);
+            m_device->PolygonMode(GL_FRONT, GL_POINT);
         }
         else
         {
-            qglPolygonMode(GL_FRONT, GL_FILL);
+            m_device->PolygonMode(GL_FRONT, GL_FILL);
         }
 
-        qglEnable(GL_CULL_FACE);
-        qglDisable(GL_BLEND);
-        qglEnable(GL_ALPHA_TEST);
+        m_device->Enable(GL_CULL_FACE);
+        m_device->Disable(GL_BLEND);
+        m_device->Enable(GL_ALPHA_TEST);
 
         m_active_texture = 0;
         this->DrawSkyBox(m_camera->gl_view_proj_mat);
 
         /*
-         * room rendering
+         * room rendering: commands generation, then sorted submission
          */
+        this->RasterizeOccluders();
+        renderQueue->Reset();
         for(uint32_t i = 0; i < r_list_active_count; i++)
         {
-            this->DrawRoom(r_list[i].room, m_camera->gl_view_mat, m_camera->gl_view_proj_mat);
+            this->QueueRoom(r_list[i].room, m_camera->gl_view_mat, m_camera->gl_view_proj_mat, r_list[i].dist);
         }
+        this->SubmitQueue();
+        m_occlusion_active = false;
 
-        qglDisable(GL_CULL_FACE);
-        for(uint32_t i = 0; i < r_list_active_count; i++)
-        {
-            this->DrawRoomSprites(r_list[i].room);
-        }
+        m_device->Disable(GL_CULL_FACE);
+        this->DrawSprites();
 
         /*
          * NOW render transparency polygons
          */
-        /*First generate BSP from base room mesh - it has good for start splitter polygons*/
-        for(uint32_t i = 0; i < r_list_active_count; i++)
+        if(settings.transparency_mode == RENDER_TRANSPARENCY_BATCHES)
         {
-            room_p r = r_list[i].room;
-            if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
-            {
-                dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum);
-            }
+            this->DrawTransparencyBatches();
         }
-
-        for(uint32_t i = 0; i < r_list_active_count; i++)
+        else
         {
-            room_p r = r_list[i].room;
-            // Add transparency polygons from static meshes (if they exists)
-            for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
-            {
-                if((r->content->static_mesh[j].mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(r->content->static_mesh[j].obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
-                {
-                    dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum);
-                }
-            }
-
-            // Add transparency polygons from all entities (if they exists) // yes, entities may be animated and intersects with each others;
-            for(engine_container_p cont = r->content->containers; cont; cont = cont->next)
-            {
-                if(cont->object_type == OBJECT_ENTITY)
-                {
-                    entity_p ent = (entity_p)cont->object;
-                    if((ent->bf->animations.model->transparency_flags == MESH_HAS_TRANSPARENCY) && (ent->state_flags & ENTITY_STATE_VISIBLE) && Frustum_IsOBBVisibleInFrustumList(ent->obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
-                    {
-                        float tr[16];
-                        for(uint16_t j = 0; j < ent->bf->bone_tag_count; j++)
-                        {
-                            if(ent->bf->bone_tags[j].mesh_base->transparency_polygons != NULL)
-                            {
-                                Mat4_Mat4_mul(tr, ent->transform, ent->bf->bone_tags[j].full_transform);
-                                dynamicBSP->AddNewPolygonList(ent->bf->bone_tags[j].mesh_base->transparency_polygons, tr, m_camera->frustum);
-                            }
-                        }
-                    }
-                }
-            }
+            this->DrawTransparencyDynamicBSP();
         }
 
-        if(dynamicBSP->m_root->polygons_front && (dynamicBSP->m_vbo != 0))
-        {
-            const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
-            qglUseProgramObjectARB(shader->program);
-            qglUniform1iARB(shader->sampler, 0);
-            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
-            qglDepthMask(GL_FALSE);
-            qglDisable(GL_ALPHA_TEST);
-            qglEnable(GL_BLEND);
-            m_active_transparency = 0;
-            qglBindBufferARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->m_vbo);
-            qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            qglBufferDataARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->GetActiveVertexCount() * sizeof(vertex_t), dynamicBSP->GetVertexArray(), GL_DYNAMIC_DRAW);
-            qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-            qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-            qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
-            qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
-            this->DrawBSPBackToFront(dynamicBSP->m_root);
-            qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-            qglDepthMask(GL_TRUE);
-            qglDisable(GL_BLEND);
-        }
         //Reset polygon draw mode
-        qglPolygonMode(GL_FRONT, GL_FILL);
+        m_device->PolygonMode(GL_FRONT, GL_FILL);
         m_active_texture = 0;
     }
 }
@@ -483,14 +537,14 @@ void CRender::DrawListDebugLines()
     {
         const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
         qglDisableClientState(GL_TEXTURE_COORD_ARRAY);
-        qglUseProgramObjectARB(shader->program);
-        qglUniform1iARB(shader->sampler, 0);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+        m_device->UseProgram(shader->program);
+        m_device->Uniform1i(shader->sampler, 0);
+        m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
         m_active_texture = 0;
-        BindWhiteTexture();
-        qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-        qglPointSize( 6.0f );
+        m_device->BindWhiteTexture();
+        m_device->BindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+        m_device->PointSize( 6.0f );
         qglLineWidth( 3.0f );
         debugDrawer->Render();
     }
@@ -522,35 +576,35 @@ void CRender::CleanList()
 /*
  * Draw objects functions
  */
-void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
+void CRender::SetTransparencyState(uint16_t transparency, GLuint texture)
 {
     // Blending mode switcher.
     // Note that modes above 2 aren't explicitly used in TR textures, only for
     // internal particle processing. Theoretically it's still possible to use
     // them if you will force type via TRTextur utility.
-    if(m_active_transparency != p->transparency)
+    if(m_active_transparency != transparency)
     {
-        m_active_transparency = p->transparency;
+        m_active_transparency = transparency;
         switch(m_active_transparency)
         {
             case BM_MULTIPLY:                                    // Classic PC alpha
-                qglBlendFunc(GL_ONE, GL_ONE);
+                m_device->BlendFunc(GL_ONE, GL_ONE);
                 break;
 
             case BM_INVERT_SRC:                                  // Inversion by src (PS darkness) - SAME AS IN TR3-TR5
-                qglBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+                m_device->BlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
                 break;
 
             case BM_INVERT_DEST:                                 // Inversion by dest
-                qglBlendFunc(GL_ONE_MINUS_SRC_COLOR, GL_ONE_MINUS_SRC_COLOR);
+                m_device->BlendFunc(GL_ONE_MINUS_SRC_COLOR, GL_ONE_MINUS_SRC_COLOR);
                 break;
 
             case BM_SCREEN:                                      // Screen (smoke, etc.)
-                qglBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+                m_device->BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
                 break;
 
             case BM_ANIMATED_TEX:
-                qglBlendFunc(GL_ONE, GL_ZERO);
+                m_device->BlendFunc(GL_ONE, GL_ZERO);
                 break;
 
             default:                                             // opaque animated textures case
@@ -558,12 +612,17 @@ void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
         };
     }
 
-    if(m_active_texture != p->texture_index)
+    if(m_active_texture != texture)
     {
-        m_active_texture = p->texture_index;
-        qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+        m_active_texture = texture;
+        m_device->BindTexture(m_active_texture);
     }
-    qglDrawElements(GL_TRIANGLE_FAN, p->vertex_count, GL_UNSIGNED_INT, p->indexes);
+}
+
+void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
+{
+    this->SetTransparencyState(p->transparency, p->texture_index);
+    m_device->DrawElements(GL_TRIANGLE_FAN, p->vertex_count, GL_UNSIGNED_INT, p->indexes);
 }
 
 void CRender::DrawBSPFrontToBack(struct bsp_node_s *root)
@@ -662,61 +721,353 @@ void CRender::DrawBSPBackToFront(struct bsp_node_s *root)
     }
 }
 
-void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals)
+/*
+ * Transparency
+ */
+
+/**
+ * Rooms static transparency never changes, so in batches mode it is split and
+ * sorted once at level load: one BSP per room content (flipped rooms swap
+ * contents) with own static vertex buffer. Polygons with animated textures
+ * are left for per frame batches.
+ */
+void CRender::BuildRoomsTransparency()
 {
-    if(mesh->animated_vertex_count)
+    m_prebuilt_polygons = 0;
+    m_prebuilt_splits = 0;
+    for(uint32_t i = 0; i < m_rooms_count; i++)
     {
-        // Respecify the tex coord buffer
-        qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
-        // Tell OpenGL to discard the old values
-        qglBufferDataARB(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
-        // Get writable data (to avoid copy)
-        GLfloat *data = (GLfloat *) qglMapBufferARB(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+        room_p r = m_rooms + i;
+        uint32_t vertex_count = 0;
+        if((r->content->transparency_bsp != NULL) || (r->content->mesh == NULL))
+        {
+            continue;
+        }
+
+        for(polygon_p p = r->content->mesh->transparency_polygons; p; p = p->next)
+        {
+            vertex_count += (p->anim_id == 0) ? (p->vertex_count) : (0);
+        }
+        if(vertex_count == 0)
+        {
+            continue;
+        }
 
-        for(polygon_p p = mesh->animated_polygons; p; p = p->next)
+        CDynamicBSP *bsp = new CDynamicBSP(256 * vertex_count);
+        for(int attempt = 0; attempt < 16; attempt++)                          // each overflow grows one buffer
         {
-            anim_seq_p seq = m_anim_sequences + p->anim_id - 1;
-            uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
-            tex_frame_p tf = seq->frames + frame;
-            for(uint16_t i = 0; i < p->vertex_count; i++, data += 2)
+            bsp->Reset(m_anim_sequences);
+            bsp->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, NULL, BSP_POLYGONS_STATIC);
+            if(bsp->IsComplete())
             {
-                ApplyAnimTextureTransformation(data, p->vertices[i].tex_coord, tf);
+                break;
             }
         }
-        qglUnmapBufferARB(GL_ARRAY_BUFFER);
 
-        // Setup altered buffer
-        qglTexCoordPointer(2, GL_FLOAT, sizeof(GLfloat [2]), 0);
-        // Setup static data
-        qglBindBufferARB(GL_ARRAY_BUFFER, mesh->vbo_animated_vertex_array);
-        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+        if(!bsp->IsComplete() || (bsp->m_vbo == 0))
+        {
+            Con_Warning("room %d transparency BSP is not built, it will be sorted per frame", r->id);
+            delete bsp;
+            continue;
+        }
+
+        m_gl_device->BindBuffer(GL_ARRAY_BUFFER_ARB, bsp->m_vbo);
+        m_gl_device->BufferData(GL_ARRAY_BUFFER_ARB, bsp->GetActiveVertexCount() * sizeof(vertex_t), bsp->GetVertexArray(), GL_STATIC_DRAW);
+        m_gl_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+        m_prebuilt_polygons += bsp->GetAddedPolygonsCount();
+        m_prebuilt_splits += bsp->GetSplitPolygonsCount();
+        r->content->transparency_bsp = bsp;
+    }
+}
 
-        mesh_face_p face = mesh->animated_faces;
-        for(uint32_t face_index = 0; face_index < mesh->animated_faces_count; face_index++, face++)
+void CRender::ClearRoomsTransparency()
+{
+    if(m_rooms)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
         {
-            if(m_active_texture != face->texture_index)
+            if(m_rooms[i].content && m_rooms[i].content->transparency_bsp)
             {
-                m_active_texture = face->texture_index;
-                qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+                delete m_rooms[i].content->transparency_bsp;
+                m_rooms[i].content->transparency_bsp = NULL;
             }
-            qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
         }
     }
+    m_prebuilt_polygons = 0;
+    m_prebuilt_splits = 0;
+}
 
-    if(mesh->vertex_count == 0)
+void CRender::BeginTransparency()
+{
+    const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
+    m_device->UseProgram(shader->program);
+    m_device->Uniform1i(shader->sampler, 0);
+    m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
+    m_device->DepthMask(GL_FALSE);
+    m_device->Disable(GL_ALPHA_TEST);
+    m_device->Enable(GL_BLEND);
+    m_active_transparency = 0;
+    m_device->BindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+}
+
+void CRender::BindTransparencyVertices(GLuint vbo)
+{
+    m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, vbo);
+    m_device->VertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+    m_device->ColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+    m_device->NormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+    m_device->TexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+}
+
+void CRender::EndTransparency()
+{
+    m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+    m_device->DepthMask(GL_TRUE);
+    m_device->Disable(GL_BLEND);
+}
+
+/**
+ * All visible transparent polygons (rooms, static meshes, entities) are split
+ * into one BSP every frame and uploaded as one dynamic buffer.
+ */
+void CRender::DrawTransparencyDynamicBSP()
+{
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    /*First generate BSP from base room mesh - it has good for start splitter polygons*/
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
+        {
+            dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum);
+        }
+    }
+
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        // Add transparency polygons from static meshes (if they exists)
+        for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
+        {
+            if((r->content->static_mesh[j].mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(r->content->static_mesh[j].obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
+            {
+                dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum);
+            }
+        }
+
+        // Add transparency polygons from all entities (if they exists) // yes, entities may be animated and intersects with each others;
+        for(engine_container_p cont = r->content->containers; cont; cont = cont->next)
+        {
+            if(cont->object_type == OBJECT_ENTITY)
+            {
+                entity_p ent = (entity_p)cont->object;
+                if((ent->bf->animations.model->transparency_flags == MESH_HAS_TRANSPARENCY) && (ent->state_flags & ENTITY_STATE_VISIBLE) && Frustum_IsOBBVisibleInFrustumList(ent->bv_obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
+                {
+                    float tr[16];
+                    for(uint16_t j = 0; j < ent->bf->bone_tag_count; j++)
+                    {
+                        if(ent->bf->bone_tags[j].mesh_base->transparency_polygons != NULL)
+                        {
+                            Mat4_Mat4_mul(tr, ent->transform, ent->bf->bone_tags[j].full_transform);
+                            dynamicBSP->AddNewPolygonList(ent->bf->bone_tags[j].mesh_base->transparency_polygons, tr, m_camera->frustum);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    m_transparency_time = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+
+    if(dynamicBSP->m_root->polygons_front && (dynamicBSP->m_vbo != 0))
+    {
+        this->BeginTransparency();
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, dynamicBSP->m_vbo);
+        m_device->BufferData(GL_ARRAY_BUFFER_ARB, dynamicBSP->GetActiveVertexCount() * sizeof(vertex_t), dynamicBSP->GetVertexArray(), GL_DYNAMIC_DRAW);
+        this->BindTransparencyVertices(dynamicBSP->m_vbo);
+        this->DrawBSPBackToFront(dynamicBSP->m_root);
+        this->EndTransparency();
+    }
+}
+
+/**
+ * Rooms static transparency is drawn from prebuilt rooms BSPs; static meshes,
+ * entities and rooms animated textures polygons are added per frame as one
+ * batch per object, without splitting. Batches are drawn back to front by
+ * objects distances, so intersecting objects may be sorted wrong.
+ */
+void CRender::DrawTransparencyBatches()
+{
+    uint64_t start = SDL_GetPerformanceCounter();
+    CTransparencyBatches *batches = m_transparency_batches;
+
+    batches->Reset(m_anim_sequences, m_camera->gl_transform + 12);
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        frustum_p frustum = (r->frustum) ? (r->frustum) : (m_camera->frustum);
+        if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
+        {
+            float centre[3];
+            vec3_add(centre, r->bb_min, r->bb_max);
+            vec3_mul_scalar(centre, centre, 0.5f);
+            if(r->content->transparency_bsp)
+            {
+                batches->AddBSP(r->content->transparency_bsp, centre);
+            }
+            batches->BeginBatch(centre);
+            batches->AddPolygonList(r->content->mesh->transparency_polygons, r->transform,
+                                    (r->content->transparency_bsp) ? (BSP_POLYGONS_ANIMATED) : (BSP_POLYGONS_ALL));
+        }
+
+        for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
+        {
+            static_mesh_p sm = r->content->static_mesh + j;
+            if((sm->mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(sm->obb, frustum))
+            {
+                batches->BeginBatch(sm->pos);
+                batches->AddPolygonList(sm->mesh->transparency_polygons, sm->transform, BSP_POLYGONS_ALL);
+            }
+        }
+
+        for(engine_container_p cont = r->content->containers; cont; cont = cont->next)
+        {
+            if(cont->object_type == OBJECT_ENTITY)
+            {
+                entity_p ent = (entity_p)cont->object;
+                if((ent->bf->animations.model->transparency_flags == MESH_HAS_TRANSPARENCY) && (ent->state_flags & ENTITY_STATE_VISIBLE) && Frustum_IsOBBVisibleInFrustumList(ent->bv_obb, frustum))
+                {
+                    float tr[16];
+                    batches->BeginBatch(ent->transform + 12);
+                    for(uint16_t j = 0; j < ent->bf->bone_tag_count; j++)
+                    {
+                        if(ent->bf->bone_tags[j].mesh_base->transparency_polygons != NULL)
+                        {
+                            Mat4_Mat4_mul(tr, ent->transform, ent->bf->bone_tags[j].full_transform);
+                            batches->AddPolygonList(ent->bf->bone_tags[j].mesh_base->transparency_polygons, tr, BSP_POLYGONS_ALL);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    batches->Sort();
+    m_transparency_time = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+
+    if(batches->GetBatchesCount() == 0)
     {
         return;
     }
 
+    if(batches->m_vbo == 0)
+    {
+        batches->m_vbo = m_device->GenBuffer();
+    }
+
+    GLuint bound_vbo = 0;
+    this->BeginTransparency();
+    if(batches->GetPolygonsCount() > 0)
+    {
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, batches->m_vbo);
+        m_device->BufferData(GL_ARRAY_BUFFER_ARB, batches->GetActiveVertexCount() * sizeof(vertex_t), batches->GetVertexArray(), GL_STREAM_DRAW);
+    }
+
+    for(uint32_t i = 0; i < batches->GetBatchesCount(); i++)
+    {
+        const transparency_batch_t *batch = batches->GetBatch(i);
+        if(batch->bsp)
+        {
+            if(batch->bsp->m_root->polygons_front)
+            {
+                if(bound_vbo != batch->bsp->m_vbo)
+                {
+                    bound_vbo = batch->bsp->m_vbo;
+                    this->BindTransparencyVertices(bound_vbo);
+                }
+                this->DrawBSPBackToFront(batch->bsp->m_root);
+            }
+            continue;
+        }
+
+        if(bound_vbo != batches->m_vbo)
+        {
+            bound_vbo = batches->m_vbo;
+            this->BindTransparencyVertices(bound_vbo);
+        }
+        for(uint32_t j = 0; j < batch->polygons_count; j++)
+        {
+            const transparency_polygon_t *p = batches->GetPolygon(batch->first_polygon + j);
+            this->SetTransparencyState(p->transparency, p->texture_index);
+            m_device->DrawArrays(GL_TRIANGLE_FAN, p->first_vertex, p->vertex_count);
+        }
+    }
+    this->EndTransparency();
+}
+
+void CRender::DrawMeshAnimatedFaces(struct base_mesh_s *mesh)
+{
+    // Respecify the tex coord buffer
+    m_device->BindBuffer(GL_ARRAY_BUFFER, mesh->vbo_animated_texcoord_array);
+    // Tell OpenGL to discard the old values
+    m_device->BufferData(GL_ARRAY_BUFFER, mesh->animated_vertex_count * sizeof(GLfloat [2]), 0, GL_STREAM_DRAW);
+    // Get writable data (to avoid copy)
+    GLfloat *data = (GLfloat *) m_device->MapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY, mesh->animated_vertex_count * sizeof(GLfloat [2]));
+
+    for(polygon_p p = mesh->animated_polygons; p; p = p->next)
+    {
+        anim_seq_p seq = m_anim_sequences + p->anim_id - 1;
+        uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
+        tex_frame_p tf = seq->frames + frame;
+        for(uint16_t i = 0; i < p->vertex_count; i++, data += 2)
+        {
+            ApplyAnimTextureTransformation(data, p->vertices[i].tex_coord, tf);
+        }
+    }
+    m_device->UnmapBuffer(GL_ARRAY_BUFFER);
+
+    // Setup altered buffer
+    m_device->TexCoordPointer(2, GL_FLOAT, sizeof(GLfloat [2]), 0);
+    // Setup static data
+    m_device->BindBuffer(GL_ARRAY_BUFFER, mesh->vbo_animated_vertex_array);
+    m_device->VertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+    m_device->ColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+    m_device->NormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+    m_device->BindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_animated_index_array);
+
+    mesh_face_p face = mesh->animated_faces;
+    for(uint32_t face_index = 0; face_index < mesh->animated_faces_count; face_index++, face++)
+    {
+        if(m_active_texture != face->texture_index)
+        {
+            m_active_texture = face->texture_index;
+            m_device->BindTexture(m_active_texture);
+        }
+        m_device->DrawElements(GL_TRIANGLES, face->elements_count, mesh->animated_elements_type, (void*)face->elements_offset);
+    }
+}
+
+void CRender::BindFaceTexture(const struct mesh_face_s *face)
+{
+    if(face->texture_target == GL_TEXTURE_2D_ARRAY)
+    {
+        m_device->BindTextureArray(face->texture_index);
+    }
+    else
+    {
+        m_device->BindTexture(face->texture_index);
+    }
+}
+
+void CRender::BindMeshVertices(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals)
+{
     if(mesh->vbo_vertex_array)
     {
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
-        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
-        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
-        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
-        qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
+        m_device->VertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+        m_device->ColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+        m_device->NormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+        m_device->TexCoordPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));    // with tex_page
+        m_device->BindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, mesh->vbo_index_array);
     }
 
     // Bind overriden vertices if they exist
@@ -724,58 +1075,176 @@ void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices,
     {
         // Standard normals are always float. Overridden normals (from skinning)
         // are float.
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-        qglVertexPointer(3, GL_FLOAT, 0, overrideVertices);
-        qglNormalPointer(GL_FLOAT, 0, overrideNormals);
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+        m_device->VertexPointer(3, GL_FLOAT, 0, overrideVertices);
+        m_device->NormalPointer(GL_FLOAT, 0, overrideNormals);
+    }
+}
+
+/**
+ * Draws mesh faces with textures of target: array texture faces need other
+ * shader, animated faces are drawn with 2D ones.
+ */
+void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals, GLenum target)
+{
+    if(mesh->animated_vertex_count && (target == GL_TEXTURE_2D))
+    {
+        this->DrawMeshAnimatedFaces(mesh);
+    }
+
+    if(mesh->vertex_count == 0)
+    {
+        return;
     }
 
+    this->BindMeshVertices(mesh, overrideVertices, overrideNormals);
+
     mesh_face_p face = mesh->faces;
     for(uint32_t face_index = 0; face_index < mesh->faces_count; face_index++, face++)
     {
+        if(face->texture_target != target)
+        {
+            continue;
+        }
         if(m_active_texture != face->texture_index)
         {
             m_active_texture = face->texture_index;
-            qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+            this->BindFaceTexture(face);
         }
-        qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
+        m_device->DrawElements(GL_TRIANGLES, face->elements_count, mesh->elements_type, (void*)face->elements_offset);
     }
 }
 
-void CRender::DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16])
+/**
+ * Writes skinned vertices to dst, normals follow vertices. Transform is
+ * orthonormal, so inverse is transposed rotation; it's translation part
+ * is calculated once, not per vertex. SSE path is used where available,
+ * scalar loop is the fallback.
+ */
+void CRender::SkinMeshVertices(GLfloat *dst, struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, const uint32_t *map, const float transform[16])
 {
-    uint32_t i;
-    vertex_p v;
-    float *p_vertex, *src_v, *dst_v;
-    GLfloat *p_normale, *src_n, *dst_n;
-    size_t buf_size = mesh->vertex_count * 3 * sizeof(GLfloat);
-
-    p_vertex  = (GLfloat*)Sys_GetTempMem(buf_size);
-    p_normale = (GLfloat*)Sys_GetTempMem(buf_size);
-    dst_v = p_vertex;
-    dst_n = p_normale;
-    v = mesh->vertices;
-    for(i = 0; i < mesh->vertex_count; i++, v++, map++)
+    const float r0[3] = {transform[0], transform[1], transform[2]};
+    const float r1[3] = {transform[4], transform[5], transform[6]};
+    const float r2[3] = {transform[8], transform[9], transform[10]};
+    const float mov[3] = {vec3_dot(r0, transform + 12), vec3_dot(r1, transform + 12), vec3_dot(r2, transform + 12)};
+    const vertex_t *v = mesh->vertices;
+    const vertex_t *pv = parent_mesh->vertices;
+    GLfloat *dst_v = dst;
+    GLfloat *dst_n = dst + 3 * mesh->vertex_count;
+
+#if defined(RENDER_SSE)
+    // columns of transposed rotation; positions and normals are float[4], so 4 floats loads stay inside vertex
+    const __m128 c0 = _mm_setr_ps(r0[0], r1[0], r2[0], 0.0f);
+    const __m128 c1 = _mm_setr_ps(r0[1], r1[1], r2[1], 0.0f);
+    const __m128 c2 = _mm_setr_ps(r0[2], r1[2], r2[2], 0.0f);
+    const __m128 m = _mm_setr_ps(mov[0], mov[1], mov[2], 0.0f);
+    for(uint32_t i = 0; i < mesh->vertex_count; i++, v++, dst_v += 3, dst_n += 3)
+    {
+        __m128 p, n;
+        if(map[i] == 0xFFFFFFFF)
+        {
+            p = _mm_loadu_ps(v->position);
+            n = _mm_loadu_ps(v->normal);
+        }
+        else
+        {
+            __m128 sv = _mm_loadu_ps(pv[map[i]].position);
+            __m128 sn = _mm_loadu_ps(v->normal);
+            p = _mm_mul_ps(c0, _mm_shuffle_ps(sv, sv, _MM_SHUFFLE(0, 0, 0, 0)));
+            p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_shuffle_ps(sv, sv, _MM_SHUFFLE(1, 1, 1, 1))));
+            p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_shuffle_ps(sv, sv, _MM_SHUFFLE(2, 2, 2, 2))));
+            p = _mm_sub_ps(p, m);                                               // M^-1 * src
+            n = _mm_mul_ps(c0, _mm_shuffle_ps(sn, sn, _MM_SHUFFLE(0, 0, 0, 0)));
+            n = _mm_add_ps(n, _mm_mul_ps(c1, _mm_shuffle_ps(sn, sn, _MM_SHUFFLE(1, 1, 1, 1))));
+            n = _mm_add_ps(n, _mm_mul_ps(c2, _mm_shuffle_ps(sn, sn, _MM_SHUFFLE(2, 2, 2, 2))));
+        }
+        // 3 floats stores: dst is packed, 4th lane would overwrite neighbour data
+        _mm_storel_pi((__m64*)dst_v, p);
+        _mm_store_ss(dst_v + 2, _mm_movehl_ps(p, p));
+        _mm_storel_pi((__m64*)dst_n, n);
+        _mm_store_ss(dst_n + 2, _mm_movehl_ps(n, n));
+    }
+#else
+    for(uint32_t i = 0; i < mesh->vertex_count; i++, v++, dst_v += 3, dst_n += 3)
     {
-        src_v = v->position;
-        src_n = v->normal;
-        if(*map == 0xFFFFFFFF)
+        if(map[i] == 0xFFFFFFFF)
         {
-            vec3_copy(dst_v, src_v);
-            vec3_copy(dst_n, src_n);
+            vec3_copy(dst_v, v->position);
+            vec3_copy(dst_n, v->normal);
         }
         else
         {
-            Mat4_vec3_mul_inv(dst_v, transform, parent_mesh->vertices[*map].position);
-            dst_n[0]  = transform[0] * src_n[0] + transform[1] * src_n[1] + transform[2]  * src_n[2];             // (M^-1 * src).x
-            dst_n[1]  = transform[4] * src_n[0] + transform[5] * src_n[1] + transform[6]  * src_n[2];             // (M^-1 * src).y
-            dst_n[2]  = transform[8] * src_n[0] + transform[9] * src_n[1] + transform[10] * src_n[2];             // (M^-1 * src).z
+            const float *src_v = pv[map[i]].position;
+            const float *src_n = v->normal;
+            dst_v[0] = r0[0] * src_v[0] + r0[1] * src_v[1] + r0[2] * src_v[2] - mov[0];   // M^-1 * src
+            dst_v[1] = r1[0] * src_v[0] + r1[1] * src_v[1] + r1[2] * src_v[2] - mov[1];
+            dst_v[2] = r2[0] * src_v[0] + r2[1] * src_v[1] + r2[2] * src_v[2] - mov[2];
+            dst_n[0] = r0[0] * src_n[0] + r0[1] * src_n[1] + r0[2] * src_n[2];
+            dst_n[1] = r1[0] * src_n[0] + r1[1] * src_n[1] + r1[2] * src_n[2];
+            dst_n[2] = r2[0] * src_n[0] + r2[1] * src_n[1] + r2[2] * src_n[2];
+        }
+    }
+#endif
+}
+
+/**
+ * Skinned vertices and normals are allocated in temp memory:
+ * normals follow vertices, caller rollbacks temp memory after drawing.
+ */
+float *CRender::GenSkinMeshVertices(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16])
+{
+    float *p_vertex = (GLfloat*)Sys_GetTempMem(2 * mesh->vertex_count * 3 * sizeof(GLfloat));
+
+    this->SkinMeshVertices(p_vertex, mesh, parent_mesh, map, transform);
+
+    return p_vertex;
+}
+
+/**
+ * Skinning pre-pass: all queued skin jobs are written into the one
+ * streaming buffer, which is orphaned every frame (driver gives new storage
+ * while previous frame draws are in flight). Commands bind offsets only.
+ */
+void CRender::SkinQueueMeshes()
+{
+    size_t bytes = renderQueue->GetSkinBytes();
+
+    if(bytes == 0)
+    {
+        return;
+    }
+
+    if(m_skin_buffer == 0)
+    {
+        m_skin_buffer = m_device->GenBuffer();                                 // null device returns 0, it maps to scratch memory
+    }
+
+    if(bytes > m_skin_buffer_size)
+    {
+        m_skin_buffer_size = (bytes > 2 * m_skin_buffer_size) ? (bytes) : (2 * m_skin_buffer_size);
+    }
+
+    m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, m_skin_buffer);
+    m_device->BufferData(GL_ARRAY_BUFFER_ARB, m_skin_buffer_size, NULL, GL_STREAM_DRAW);
+    uint8_t *data = (uint8_t*)m_device->MapBuffer(GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY, bytes);
+    if(data)
+    {
+        for(uint32_t i = 0; i < renderQueue->GetSkinJobsCount(); i++)
+        {
+            const render_skin_job_t *job = renderQueue->GetSkinJob(i);
+            this->SkinMeshVertices((GLfloat*)(data + job->offset), job->mesh, job->parent_mesh, job->map, job->transform);
         }
-        dst_v += 3;
-        dst_n += 3;
     }
+    m_device->UnmapBuffer(GL_ARRAY_BUFFER_ARB);
+}
 
-    this->DrawMesh(mesh, p_vertex, p_normale);
-    Sys_ReturnTempMem(2 * buf_size);
+void CRender::DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16])
+{
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+    float *p_vertex = this->GenSkinMeshVertices(mesh, parent_mesh, map, transform);
+
+    this->DrawMesh(mesh, p_vertex, p_vertex + 3 * mesh->vertex_count);
+    Sys_RollbackTempMem(temp_marker);
 }
 
 void CRender::DrawSkyBox(const float modelViewProjectionMatrix[16])
@@ -785,7 +1254,7 @@ void CRender::DrawSkyBox(const float modelViewProjectionMatrix[16])
     {
         float tr[16];
         float *p;
-        qglDepthMask(GL_FALSE);
+        m_device->DepthMask(GL_FALSE);
         tr[15] = 1.0;
         p = skybox->animations->frames->bone_tags->offset;
         vec3_add(tr + 12, m_camera->gl_transform + 12, p);
@@ -795,14 +1264,14 @@ void CRender::DrawSkyBox(const float modelViewProjectionMatrix[16])
         Mat4_Mat4_mul(fullView, modelViewProjectionMatrix, tr);
 
         const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
-        qglUseProgramObjectARB(shader->program);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, fullView);
-        qglUniform1iARB(shader->sampler, 0);
+        m_device->UseProgram(shader->program);
+        m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, fullView);
+        m_device->Uniform1i(shader->sampler, 0);
         GLfloat tint[] = { 1, 1, 1, 1 };
-        qglUniform4fvARB(shader->tint_mult, 1, tint);
+        m_device->Uniform4fv(shader->tint_mult, 1, tint);
 
         this->DrawMesh(skybox->mesh_tree->mesh_base, NULL, NULL);
-        qglDepthMask(GL_TRUE);
+        m_device->DepthMask(GL_TRUE);
     }
 }
 
@@ -812,20 +1281,33 @@ void CRender::DrawSkyBox(const float modelViewProjectionMatrix[16])
 void CRender::DrawSkeletalModel(const lit_shader_description *shader, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16])
 {
     ss_bone_tag_p btag = bframe->bone_tags;
-    float mvTransform[16];
-    float mvpTransform[16];
+    const float *palette = SSBoneFrame_GetPalette(bframe);
     //mvMatrix = modelViewMatrix x entity->transform
     //mvpMatrix = modelViewProjectionMatrix x entity->transform
 
-    for(uint16_t i = 0; i < bframe->bone_tag_count; i++, btag++)
+    // palette keeps this frame bones matrices packed: whole model is uploaded once;
+    // bone tags are a fallback for not updated frames and too big models
+    palette = (bframe->bone_tag_count <= MAX_NUM_BONES) ? (palette) : (NULL);
+    m_device->UniformMatrix4fv(shader->model_view, 1, false, mvMatrix);
+    m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, mvpMatrix);
+    if(palette)
+    {
+        m_device->UniformMatrix4fv(shader->bones, bframe->bone_tag_count, false, palette);
+    }
+
+    for(uint16_t i = 0; i < bframe->bone_tag_count; i++, btag++)
     {
         if(!btag->is_hidden)
         {
-            Mat4_Mat4_mul(mvTransform, mvMatrix, btag->full_transform);
-            qglUniformMatrix4fvARB(shader->model_view, 1, false, mvTransform);
-
-            Mat4_Mat4_mul(mvpTransform, mvpMatrix, btag->full_transform);
-            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, mvpTransform);
+            if(palette)
+            {
+                m_device->Uniform1i(shader->bone_index, i);
+            }
+            else
+            {
+                m_device->UniformMatrix4fv(shader->bones, 1, false, btag->full_transform);
+                m_device->Uniform1i(shader->bone_index, 0);
+            }
 
             this->DrawMesh((btag->mesh_replace) ? (btag->mesh_replace) : (btag->mesh_base), NULL, NULL);
             if(btag->mesh_slot)
@@ -840,7 +1322,39 @@ void CRender::DrawSkeletalModel(const lit_shader_description *shader, struct ss_
     }
 }
 
-void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
+/**
+ * skeletal model commands generation: one render object per bone, bone
+ * meshes share entity's model matrices, lights setup and bones palette,
+ * so submission uploads palette once and sets only bone index per bone.
+ */
+void CRender::QueueSkeletalModel(const lit_shader_description *shader, uint32_t lights, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16], float depth)
+{
+    ss_bone_tag_p btag = bframe->bone_tags;
+    const float *palette = SSBoneFrame_GetPalette(bframe);
+
+    palette = (bframe->bone_tag_count <= MAX_NUM_BONES) ? (palette) : (NULL);
+    for(uint16_t i = 0; i < bframe->bone_tag_count; i++, btag++)
+    {
+        if(!btag->is_hidden)
+        {
+            uint32_t obj = (palette) ? (renderQueue->AddObject(mvpMatrix, mvMatrix, NULL, lights, palette, bframe->bone_tag_count, i)) :
+                                       (renderQueue->AddObject(mvpMatrix, mvMatrix, NULL, lights, btag->full_transform, 1, 0));
+
+            renderQueue->AddMesh(shader, RENDER_SHADER_LIT, obj, (btag->mesh_replace) ? (btag->mesh_replace) : (btag->mesh_base), RENDER_NO_SKIN, depth);
+            if(btag->mesh_slot)
+            {
+                renderQueue->AddMesh(shader, RENDER_SHADER_LIT, obj, btag->mesh_slot, RENDER_NO_SKIN, depth);
+            }
+            if(btag->mesh_skin && btag->parent)
+            {
+                uint32_t skin = renderQueue->AddSkinJob(btag->mesh_skin, btag->parent->mesh_base, btag->skin_map, btag->transform);
+                renderQueue->AddMesh(shader, RENDER_SHADER_LIT, obj, btag->mesh_skin, skin, depth);
+            }
+        }
+    }
+}
+
+void CRender::QueueEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
 {
     if(!(entity->state_flags & ENTITY_STATE_VISIBLE) || (entity->bf->animations.model->hide && !(r_flags & R_DRAW_NULLMESHES)))
     {
@@ -848,7 +1362,9 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
     }
 
     // Calculate lighting
-    const lit_shader_description *shader = this->SetupEntityLight(entity, modelViewMatrix);
+    const lit_shader_description *shader;
+    uint32_t lights = this->SetupEntityLight(entity, modelViewMatrix, &shader);
+    float depth = vec3_dist(m_camera->gl_transform + 12, entity->transform + 12);
 
     if(entity->bf->animations.model && entity->bf->animations.model->animations)
     {
@@ -868,7 +1384,7 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
             Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, entity->transform);
         }
 
-        this->DrawSkeletalModel(shader, entity->bf, subModelView, subModelViewProjection);
+        this->QueueSkeletalModel(shader, lights, entity->bf, subModelView, subModelViewProjection, depth);
 
         if(entity->character && entity->character->hair_count)
         {
@@ -883,26 +1399,28 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
                     Mat4_Mat4_mul(subModelView, modelViewMatrix, transform);
                     Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, transform);
 
-                    qglUniformMatrix4fvARB(shader->model_view, 1, GL_FALSE, subModelView);
-                    qglUniformMatrix4fvARB(shader->model_view_projection, 1, GL_FALSE, subModelViewProjection);
-                    this->DrawMesh(mesh, NULL, NULL);
+                    uint32_t obj = renderQueue->AddObject(subModelViewProjection, subModelView, NULL, lights);
+                    renderQueue->AddMesh(shader, RENDER_SHADER_LIT, obj, mesh, RENDER_NO_SKIN, depth);
                 }
             }
         }
     }
 }
 
-void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
+/**
+ * Generates room commands: room mesh, visible statics and entities (with
+ * near rooms objects that overlaps the room). Room that needs stencil is
+ * drawn immediately: stencil state can not be sorted with other commands.
+ */
+void CRender::QueueRoom(struct room_s *room, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16], float depth)
 {
     float transform[16];
     engine_container_p cont;
     entity_p ent;
-
-    const shader_description *lastShader = 0;
+    bool need_stencil = false;
 
 #if STENCIL_FRUSTUM
     ////start test stencil test code
-    bool need_stencil = false;
     if(room->frustum != NULL)
     {
         for(uint16_t i = 0; i < room->overlapped_room_list_size; i++)
@@ -920,16 +1438,17 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
             const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
             size_t buf_size;
 
-            qglUseProgramObjectARB(shader->program);
-            qglUniform1iARB(shader->sampler, 0);
-            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, engine_camera.gl_view_proj_mat);
-            qglEnable(GL_STENCIL_TEST);
-            qglClear(GL_STENCIL_BUFFER_BIT);
-            qglStencilFunc(GL_NEVER, 1, 0x00);
-            qglStencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
+            m_device->UseProgram(shader->program);
+            m_device->Uniform1i(shader->sampler, 0);
+            m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, engine_camera.gl_view_proj_mat);
+            m_device->Enable(GL_STENCIL_TEST);
+            m_device->Clear(GL_STENCIL_BUFFER_BIT);
+            m_device->StencilFunc(GL_NEVER, 1, 0x00);
+            m_device->StencilOp(GL_REPLACE, GL_KEEP, GL_KEEP);
             for(frustum_p f = room->frustum; f; f = f->next)
             {
                 buf_size = f->vertex_count * elem_size;
+                mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
                 GLfloat *v, *buf = (GLfloat*)Sys_GetTempMem(buf_size);
                 v=buf;
                 for(int16_t i = f->vertex_count - 1; i >= 0; i--)
@@ -941,17 +1460,17 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
                 }
 
                 m_active_texture = 0;
-                BindWhiteTexture();
-                qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-                qglVertexPointer(3, GL_FLOAT, elem_size, buf+0);
-                qglNormalPointer(GL_FLOAT, elem_size, buf+3);
-                qglColorPointer(4, GL_FLOAT, elem_size, buf+3+3);
-                qglTexCoordPointer(2, GL_FLOAT, elem_size, buf+3+3+4);
-                qglDrawArrays(GL_TRIANGLE_FAN, 0, f->vertex_count);
-
-                Sys_ReturnTempMem(buf_size);
+                m_device->BindWhiteTexture();
+                m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+                m_device->VertexPointer(3, GL_FLOAT, elem_size, buf+0);
+                m_device->NormalPointer(GL_FLOAT, elem_size, buf+3);
+                m_device->ColorPointer(4, GL_FLOAT, elem_size, buf+3+3);
+                m_device->TexCoordPointer(2, GL_FLOAT, elem_size, buf+3+3+4);
+                m_device->DrawArrays(GL_TRIANGLE_FAN, 0, f->vertex_count);
+
+                Sys_RollbackTempMem(temp_marker);
             }
-            qglStencilFunc(GL_EQUAL, 1, 0xFF);
+            m_device->StencilFunc(GL_EQUAL, 1, 0xFF);
         }
     }
 #endif
@@ -962,39 +1481,65 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
         Mat4_Mat4_mul(modelViewProjectionTransform, modelViewProjectionMatrix, room->transform);
 
         const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(room->content->light_mode == 1, room->flags & 1);
+        const unlit_tinted_shader_description *array_shader = NULL;
+
+        if(shaderManager->hasTextureArray())
+        {
+            array_shader = shaderManager->getRoomShader(room->content->light_mode == 1, room->flags & 1, true);
+        }
 
         GLfloat tint[4];
         CalculateWaterTint(tint, 1);
-        if (shader != lastShader)
+        if(need_stencil)
         {
-            qglUseProgramObjectARB(shader->program);
+            m_device->UseProgram(shader->program);
+            m_device->Uniform4fv(shader->tint_mult, 1, tint);
+            m_device->Uniform1f(shader->current_tick, (GLfloat) SDL_GetTicks());
+            m_device->Uniform1i(shader->sampler, 0);
+            m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, modelViewProjectionTransform);
+            this->DrawMesh(room->content->mesh, NULL, NULL);
+            if(array_shader)
+            {
+                m_device->UseProgram(array_shader->program);
+                m_device->Uniform4fv(array_shader->tint_mult, 1, tint);
+                m_device->Uniform1f(array_shader->current_tick, (GLfloat) SDL_GetTicks());
+                m_device->Uniform1i(array_shader->sampler, 0);
+                m_device->UniformMatrix4fv(array_shader->model_view_projection, 1, false, modelViewProjectionTransform);
+                this->DrawMesh(room->content->mesh, NULL, NULL, GL_TEXTURE_2D_ARRAY);
+            }
+        }
+        else
+        {
+            uint32_t obj = renderQueue->AddObject(modelViewProjectionTransform, NULL, tint, RENDER_NO_LIGHTS);
+            renderQueue->AddMesh(shader, RENDER_SHADER_UNLIT_TINTED, obj, room->content->mesh, RENDER_NO_SKIN, depth, array_shader);
         }
-
-        lastShader = shader;
-        qglUniform4fvARB(shader->tint_mult, 1, tint);
-        qglUniform1fARB(shader->current_tick, (GLfloat) SDL_GetTicks());
-        qglUniform1iARB(shader->sampler, 0);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, modelViewProjectionTransform);
-        this->DrawMesh(room->content->mesh, NULL, NULL);
     }
 
 #if STENCIL_FRUSTUM
     if(need_stencil)
     {
-        qglDisable(GL_STENCIL_TEST);
+        m_device->Disable(GL_STENCIL_TEST);
     }
 #endif
 
     if (room->content->static_mesh_count > 0)
     {
-        qglUseProgramObjectARB(shaderManager->getStaticMeshShader()->program);
+        const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
+        mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+        obb_p *obbs = (obb_p*)Sys_GetTempMem(room->content->static_mesh_count * sizeof(obb_p));
+        uint8_t *visible = (uint8_t*)Sys_GetTempMem(room->content->static_mesh_count * sizeof(uint8_t));
         for(uint32_t i = 0; i < room->content->static_mesh_count; i++)
         {
-            if(Frustum_IsOBBVisibleInFrustumList(room->content->static_mesh[i].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-               (!room->content->static_mesh[i].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+            obbs[i] = room->content->static_mesh[i].obb;
+        }
+        Frustum_ClassifyOBBsInFrustumList(obbs, room->content->static_mesh_count, (room->frustum) ? (room->frustum) : (m_camera->frustum), visible);
+
+        for(uint32_t i = 0; i < room->content->static_mesh_count; i++)
+        {
+            if(visible[i] && (!room->content->static_mesh[i].hide || (r_flags & R_DRAW_DUMMY_STATICS)) &&
+               !this->IsOccluded(room->content->static_mesh[i].obb))
             {
                 Mat4_Mat4_mul(transform, modelViewProjectionMatrix, room->content->static_mesh[i].transform);
-                qglUniformMatrix4fvARB(shaderManager->getStaticMeshShader()->model_view_projection, 1, false, transform);
                 base_mesh_s *mesh = room->content->static_mesh[i].mesh;
                 GLfloat tint[4];
 
@@ -1005,10 +1550,12 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
                 {
                     CalculateWaterTint(tint, 0);
                 }
-                qglUniform4fvARB(shaderManager->getStaticMeshShader()->tint_mult, 1, tint);
-                this->DrawMesh(mesh, NULL, NULL);
+                uint32_t obj = renderQueue->AddObject(transform, NULL, tint, RENDER_NO_LIGHTS);
+                renderQueue->AddMesh(shader, RENDER_SHADER_UNLIT_TINTED, obj, mesh, RENDER_NO_SKIN,
+                                     vec3_dist(m_camera->gl_transform + 12, room->content->static_mesh[i].transform + 12));
             }
         }
+        Sys_RollbackTempMem(temp_marker);
     }
 
     for(cont = room->content->containers; cont; cont = cont->next)
@@ -1017,9 +1564,9 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
         {
         case OBJECT_ENTITY:
             ent = (entity_p)cont->object;
-            if(Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
+            if(Frustum_IsOBBVisibleInFrustumList(ent->bv_obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) && !this->IsOccluded(ent->bv_obb))
             {
-                this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
+                this->QueueEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
             }
             break;
         };
@@ -1032,15 +1579,15 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
         {
             if (near_room->content->static_mesh_count > 0)
             {
+                const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
                 for(uint32_t si = 0; si < near_room->content->static_mesh_count; si++)
                 {
                     if(OBB_OBB_Test(near_room->content->static_mesh[si].obb, room->obb, 0.0f) &&
                        Frustum_IsOBBVisibleInFrustumList(near_room->content->static_mesh[si].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-                       (!near_room->content->static_mesh[si].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+                       (!near_room->content->static_mesh[si].hide || (r_flags & R_DRAW_DUMMY_STATICS)) &&
+                       !this->IsOccluded(near_room->content->static_mesh[si].obb))
                     {
-                        qglUseProgramObjectARB(shaderManager->getStaticMeshShader()->program);
                         Mat4_Mat4_mul(transform, modelViewProjectionMatrix, near_room->content->static_mesh[si].transform);
-                        qglUniformMatrix4fvARB(shaderManager->getStaticMeshShader()->model_view_projection, 1, false, transform);
                         base_mesh_s *mesh = near_room->content->static_mesh[si].mesh;
                         GLfloat tint[4];
 
@@ -1051,8 +1598,9 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
                         {
                             CalculateWaterTint(tint, 0);
                         }
-                        qglUniform4fvARB(shaderManager->getStaticMeshShader()->tint_mult, 1, tint);
-                        this->DrawMesh(mesh, NULL, NULL);
+                        uint32_t obj = renderQueue->AddObject(transform, NULL, tint, RENDER_NO_LIGHTS);
+                        renderQueue->AddMesh(shader, RENDER_SHADER_UNLIT_TINTED, obj, mesh, RENDER_NO_SKIN,
+                                             vec3_dist(m_camera->gl_transform + 12, near_room->content->static_mesh[si].transform + 12));
                     }
                 }
             }
@@ -1063,10 +1611,11 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
                 {
                 case OBJECT_ENTITY:
                     ent = (entity_p)cont->object;
-                    if(OBB_OBB_Test(ent->obb, room->obb, 0.0f) &&
-                       Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
+                    if(OBB_OBB_Test(ent->bv_obb, room->obb, 0.0f) &&
+                       Frustum_IsOBBVisibleInFrustumList(ent->bv_obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
+                       !this->IsOccluded(ent->bv_obb))
                     {
-                        this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
+                        this->QueueEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
                     }
                     break;
                 };
@@ -1075,54 +1624,208 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
     }
 }
 
+/**
+ * Sorts render queue and issues it's commands; program, texture, vertex
+ * buffer, object and lights uniforms are set only when they differ from
+ * the state of the bound program.
+ */
+void CRender::SubmitQueue()
+{
+    render_queue_state_t state;
+    GLfloat tick = (GLfloat)SDL_GetTicks();
+    GLfloat identity[16];
+
+    Mat4_E(identity);
+    renderQueue->Sort();
+    this->SkinQueueMeshes();
+    renderQueue->ResetState(&state);
+    for(uint32_t i = 0; i < renderQueue->GetCommandsCount(); i++)
+    {
+        const render_command_t *cmd = renderQueue->GetCommand(i);
+        const render_object_t *obj = renderQueue->GetObject(cmd->object);
+        uint32_t changes = renderQueue->NextState(&state, cmd);
+
+        if(changes & RENDER_STATE_PROGRAM)
+        {
+            m_device->UseProgram(cmd->shader->program);
+        }
+
+        if(cmd->shader_type == RENDER_SHADER_LIT)
+        {
+            const lit_shader_description *shader = static_cast<const lit_shader_description*>(cmd->shader);
+            if(changes & RENDER_STATE_PROGRAM_SETUP)
+            {
+                m_device->Uniform1i(shader->sampler, 0);
+            }
+            if(changes & RENDER_STATE_OBJECT)
+            {
+                m_device->UniformMatrix4fv(shader->model_view, 1, GL_FALSE, obj->mv);
+                m_device->UniformMatrix4fv(shader->model_view_projection, 1, GL_FALSE, obj->mvp);
+                m_device->UniformMatrix4fv(shader->bones, (obj->bones) ? (obj->bones_count) : (1), GL_FALSE, (obj->bones) ? (obj->bones) : (identity));
+            }
+            if(changes & (RENDER_STATE_OBJECT | RENDER_STATE_BONE))
+            {
+                m_device->Uniform1i(shader->bone_index, obj->bone);
+            }
+            if((changes & RENDER_STATE_LIGHTS) && (obj->lights != RENDER_NO_LIGHTS))
+            {
+                const render_lights_t *lights = renderQueue->GetLights(obj->lights);
+                m_device->Uniform4fv(shader->light_ambient, 1, lights->ambient);
+                m_device->Uniform4fv(shader->light_color, lights->count, lights->colors);
+                m_device->Uniform3fv(shader->light_position, lights->count, lights->positions);
+                m_device->Uniform1fv(shader->light_inner_radius, lights->count, lights->inner_radiuses);
+                m_device->Uniform1fv(shader->light_outer_radius, lights->count, lights->outer_radiuses);
+            }
+        }
+        else
+        {
+            const unlit_tinted_shader_description *shader = static_cast<const unlit_tinted_shader_description*>(cmd->shader);
+            if(changes & RENDER_STATE_PROGRAM_SETUP)
+            {
+                m_device->Uniform1i(shader->sampler, 0);
+                m_device->Uniform1f(shader->current_tick, tick);
+            }
+            if(changes & RENDER_STATE_OBJECT)
+            {
+                m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, obj->mvp);
+                m_device->Uniform4fv(shader->tint_mult, 1, obj->tint);
+            }
+        }
 
-void CRender::DrawRoomSprites(struct room_s *room)
+        if(changes & RENDER_STATE_ANIMATED)
+        {
+            m_active_texture = 0;
+            this->DrawMeshAnimatedFaces(cmd->mesh);
+            continue;
+        }
+
+        if(changes & RENDER_STATE_MESH)
+        {
+            this->BindMeshVertices(cmd->mesh, NULL, NULL);
+            if(cmd->skin != RENDER_NO_SKIN)
+            {
+                size_t offset = renderQueue->GetSkinJob(cmd->skin)->offset;
+                m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, m_skin_buffer);
+                m_device->VertexPointer(3, GL_FLOAT, 0, (void*)offset);
+                m_device->NormalPointer(GL_FLOAT, 0, (void*)(offset + 3 * sizeof(GLfloat) * cmd->mesh->vertex_count));
+            }
+        }
+
+        if(changes & RENDER_STATE_TEXTURE)
+        {
+            this->BindFaceTexture(cmd->face);
+        }
+        m_device->DrawElements(GL_TRIANGLES, cmd->face->elements_count, cmd->mesh->elements_type, (void*)cmd->face->elements_offset);
+    }
+    m_active_texture = state.texture;
+}
+
+const struct render_queue_stats_s *CRender::GetQueueStats() const
 {
-    if (room->content->sprites_count > 0)
+    return renderQueue->GetStats();
+}
+
+/**
+ * Room sprites are drawn from static buffers: sprite shader turns quads to
+ * camera. Null device uses CPU billboarding (same vertices data) instead.
+ */
+void CRender::DrawSprites()
+{
+    const sprite_shader_description *sprite_shader = shaderManager->getSpriteShader();
+    bool use_buffers = (sprite_shader != NULL) && !this->IsNullDevice();
+
+    if(use_buffers)
+    {
+        m_device->UseProgram(sprite_shader->program);
+        m_device->Uniform1i(sprite_shader->sampler, 0);
+        m_device->UniformMatrix4fv(sprite_shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
+        m_device->Uniform3fv(sprite_shader->camera_right, 1, m_camera->gl_transform + 0);
+        m_device->Uniform3fv(sprite_shader->camera_up, 1, m_camera->gl_transform + 4);
+    }
+    else
     {
         const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
-        GLfloat *view = m_camera->gl_transform + 8;
-        GLfloat *up = m_camera->gl_transform + 4;
-        GLfloat *right = m_camera->gl_transform + 0;
+        m_device->UseProgram(shader->program);
+        m_device->Uniform1i(shader->sampler, 0);
+        m_device->UniformMatrix4fv(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
+    }
 
-        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-        qglUseProgramObjectARB(shader->program);
-        qglUniform1iARB(shader->sampler, 0);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, m_camera->gl_view_proj_mat);
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        this->DrawRoomSprites(r_list[i].room, use_buffers);
+    }
+}
 
-        for(uint32_t i = 0; i < room->content->sprites_count; i++)
-        {
-            room_sprite_p s = room->content->sprites + i;
-            vertex_p v = room->content->sprites_vertices + i * 4;
-            vec3_copy_inv(v[0].normal, view);
-            vec3_copy_inv(v[1].normal, view);
-            vec3_copy_inv(v[2].normal, view);
-            vec3_copy_inv(v[3].normal, view);
+void CRender::DrawRoomSprites(struct room_s *room, bool use_buffer)
+{
+    room_content_p content = room->content;
 
-            v[0].position[0] = s->pos[0] + s->sprite->right * right[0] + s->sprite->top * up[0];
-            v[0].position[1] = s->pos[1] + s->sprite->right * right[1] + s->sprite->top * up[1];
-            v[0].position[2] = s->pos[2] + s->sprite->right * right[2] + s->sprite->top * up[2];
+    if((content->sprites_count == 0) || (use_buffer && !content->sprites_vbo))
+    {
+        return;
+    }
+
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+
+    if(use_buffer)
+    {
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, content->sprites_vbo);
+        m_device->VertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+        m_device->ColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+        m_device->NormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+        m_device->TexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+    }
+    else
+    {
+        GLfloat *right = m_camera->gl_transform + 0;
+        GLfloat *up = m_camera->gl_transform + 4;
+        vertex_p v = content->sprites_vertices;
+        GLfloat *positions = (GLfloat*)Sys_GetTempMem(4 * content->sprites_count * 3 * sizeof(GLfloat));
+        GLfloat *p = positions;
 
-            v[1].position[0] = s->pos[0] + s->sprite->left * right[0] + s->sprite->top * up[0];
-            v[1].position[1] = s->pos[1] + s->sprite->left * right[1] + s->sprite->top * up[1];
-            v[1].position[2] = s->pos[2] + s->sprite->left * right[2] + s->sprite->top * up[2];
+        for(uint32_t i = 0; i < 4 * content->sprites_count; i++, v++, p += 3)
+        {
+            p[0] = v->position[0] + v->normal[0] * right[0] + v->normal[1] * up[0];
+            p[1] = v->position[1] + v->normal[0] * right[1] + v->normal[1] * up[1];
+            p[2] = v->position[2] + v->normal[0] * right[2] + v->normal[1] * up[2];
+        }
 
-            v[2].position[0] = s->pos[0] + s->sprite->left * right[0] + s->sprite->bottom * up[0];
-            v[2].position[1] = s->pos[1] + s->sprite->left * right[1] + s->sprite->bottom * up[1];
-            v[2].position[2] = s->pos[2] + s->sprite->left * right[2] + s->sprite->bottom * up[2];
+        m_device->BindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+        m_device->VertexPointer(3, GL_FLOAT, 0, positions);
+        m_device->ColorPointer(4, GL_FLOAT, sizeof(vertex_t), content->sprites_vertices->color);
+        m_device->NormalPointer(GL_FLOAT, sizeof(vertex_t), content->sprites_vertices->normal);
+        m_device->TexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), content->sprites_vertices->tex_coord);
+    }
 
-            v[3].position[0] = s->pos[0] + s->sprite->right * right[0] + s->sprite->bottom * up[0];
-            v[3].position[1] = s->pos[1] + s->sprite->right * right[1] + s->sprite->bottom * up[1];
-            v[3].position[2] = s->pos[2] + s->sprite->right * right[2] + s->sprite->bottom * up[2];
+    // one draw call per sprites run with the same texture
+    uint32_t first = 0;
+    while(first < content->sprites_count)
+    {
+        GLuint texture = (content->sprites[first].sprite) ? (content->sprites[first].sprite->texture_index) : (0);
+        uint32_t last = first + 1;
+        while((last < content->sprites_count) && content->sprites[last].sprite &&
+              (content->sprites[last].sprite->texture_index == texture))
+        {
+            last++;
         }
 
-        qglBindTexture(GL_TEXTURE_2D, room->content->sprites->sprite->texture_index);
-        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), room->content->sprites_vertices->position);
-        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), room->content->sprites_vertices->color);
-        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), room->content->sprites_vertices->normal);
-        qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), room->content->sprites_vertices->tex_coord);
-        qglDrawArrays(GL_QUADS, 0, 4 * room->content->sprites_count);
+        if(m_active_texture != texture)
+        {
+            m_active_texture = texture;
+            m_device->BindTexture(texture);
+        }
+        m_device->DrawArrays(GL_QUADS, 4 * first, 4 * (last - first));
+        first = last;
     }
+
+    Sys_RollbackTempMem(temp_marker);
+}
+
+
+void CRender::SetNullDevice(bool is_null)
+{
+    m_device = (is_null) ? (m_null_device) : (m_gl_device);
+    m_active_texture = 0;
 }
 
 
@@ -1184,10 +1887,10 @@ int  CRender::AddRoom(struct room_s *room)
 }
 
 /**
- * The reccursion algorithm: go through the rooms with portal - frustum occlusion test
+ * Portal traversal step: go through the room's portals with portal - frustum occlusion test
  * @portal - we entered to the room through that portal
  * @frus - frustum that intersects the portal
- * @return number of added rooms
+ * @return number of generated frustums (queued portals)
  */
 int CRender::ProcessRoom(struct portal_s *portal, struct frustum_s *frus)
 {
@@ -1199,16 +1902,17 @@ int CRender::ProcessRoom(struct portal_s *portal, struct frustum_s *frus)
         return 0;
     }
 
+    m_rooms_visited++;
     for(uint16_t i = 0; i < room->portals_count; i++)
     {
         portal_p p = room->portals + i;
         room_p dest_room = p->dest_room->real_room;
-        frustum_p gen_frus = frustumManager->PortalFrustumIntersect(p, frus, m_camera);  // backface portals are filtered here
+        frustum_p gen_frus = this->PortalFrustum(p, frus);                      // backface portals are filtered here
         if(gen_frus)
         {
             ret++;
             this->AddRoom(dest_room);
-            this->ProcessRoom(p, gen_frus);
+            this->PushPortal(p, gen_frus);
         }
     }
 
@@ -1216,18 +1920,296 @@ int CRender::ProcessRoom(struct portal_s *portal, struct frustum_s *frus)
 }
 
 /**
- * Sets up the light calculations for the given entity based on its current
- * room. Returns the used shader, which will have been made current already.
+ * Generates frustum through the portal within destination room's frustums budget.
+ * Camera frustum through the portal contains any other frustum through it, so
+ * when room has R_ROOM_MAX_FRUSTUMS frustums new one is replaced by camera one,
+ * and when room already has camera one, new frustum is redundant.
  */
-const lit_shader_description *CRender::SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16])
+struct frustum_s *CRender::PortalFrustum(struct portal_s *portal, struct frustum_s *emitter)
 {
-    // Calculate lighting
-    const lit_shader_description *shader;
+    room_p dest_room = portal->dest_room->real_room;
+    uint32_t frustums_count = 0;
+
+    for(frustum_p f = dest_room->frustum; f; f = f->next, frustums_count++)
+    {
+        if((f->portal == portal) && (f->parent == m_camera->frustum))
+        {
+            m_frustums_dropped++;
+            return NULL;
+        }
+    }
+
+    if((frustums_count >= R_ROOM_MAX_FRUSTUMS) && (emitter != m_camera->frustum))
+    {
+        m_frustums_merged++;
+        emitter = m_camera->frustum;
+    }
+
+    return frustumManager->PortalFrustumIntersect(portal, emitter, m_camera);
+}
+
+void CRender::PushPortal(struct portal_s *portal, struct frustum_s *frus)
+{
+    if(m_portal_queue_count >= m_portal_queue_size)
+    {
+        m_portal_queue_size *= 2;
+        m_portal_queue = (struct portal_queue_item_s*)realloc(m_portal_queue, m_portal_queue_size * sizeof(struct portal_queue_item_s));
+    }
+    m_portal_queue[m_portal_queue_count].portal = portal;
+    m_portal_queue[m_portal_queue_count].frustum = frus;
+    m_portal_queue_count++;
+}
+
+/**
+ * Breadth first portal traversal: rooms are processed by portals distance
+ * from camera, so room gets all it's near frustums before far ones.
+ */
+void CRender::ProcessPortalQueue()
+{
+    for(uint32_t i = 0; i < m_portal_queue_count; i++)                          // queue grows while processing
+    {
+        this->ProcessRoom(m_portal_queue[i].portal, m_portal_queue[i].frustum);
+    }
+}
+
+void CRender::GetVisibilityStats(struct render_visibility_stats_s *stats)
+{
+    stats->rooms_in_list = r_list_active_count;
+    stats->rooms_visited = m_rooms_visited;
+    stats->portals_queued = m_portal_queue_count;
+    stats->frustums_merged = m_frustums_merged;
+    stats->frustums_dropped = m_frustums_dropped;
+    frustumManager->GetStats(&stats->frustums_generated, &stats->frustum_buffer_used, &stats->frustum_buffer_high_water, &stats->frustum_buffer_size);
+    Frustum_GetOBBStats(&stats->obb_tests, &stats->obb_planes_rejected);
+    stats->obb_bench = Frustum_GetOBBBench(&stats->obb_bench_scalar_us, &stats->obb_bench_simd_us, &stats->obb_bench_mismatches) ? (1) : (0);
+    if(settings.occlusion_culling)
+    {
+        stats->occluder_triangles = m_occlusion->GetTrianglesCount();
+        stats->occlusion_tests = m_occlusion->GetTestsCount();
+        stats->occlusion_culled = m_occlusion->GetOccludedCount();
+        stats->occlusion_time_us = m_occlusion_time;
+    }
+    else
+    {
+        stats->occluder_triangles = 0;
+        stats->occlusion_tests = 0;
+        stats->occlusion_culled = 0;
+        stats->occlusion_time_us = 0;
+    }
+}
+
+/*
+ * Software occlusion culling
+ */
+
+/**
+ * Occluders are big opaque room polygons, triangulated in world space once
+ * per level; every triangle keeps the polygon normal for backface test.
+ */
+void CRender::BuildRoomsOccluders()
+{
+    for(uint32_t i = 0; i < m_rooms_count; i++)
+    {
+        room_p r = m_rooms + i;
+        base_mesh_p mesh = r->content->mesh;
+        uint32_t count = 0;
+
+        if((mesh == NULL) || (r->content->occluders != NULL))
+        {
+            continue;
+        }
+
+        for(int pass = 0; pass < 2; pass++)
+        {
+            float *t = r->content->occluders;
+            polygon_p p = mesh->polygons;
+            for(uint32_t j = 0; j < mesh->polygons_count; j++, p++)
+            {
+                float area = 0.0f, v1[3], v2[3], n[3];
+                if((p->transparency != BM_OPAQUE) || (p->anim_id != 0) || (p->vertex_count < 3) || Polygon_IsBroken(p))
+                {
+                    continue;
+                }
+
+                for(uint16_t k = 2; k < p->vertex_count; k++)
+                {
+                    vec3_sub(v1, p->vertices[k - 1].position, p->vertices[0].position);
+                    vec3_sub(v2, p->vertices[k].position, p->vertices[0].position);
+                    vec3_cross(n, v1, v2);
+                    area += 0.5f * vec3_abs(n);
+                }
+                if(area < OCCLUSION_MIN_AREA)
+                {
+                    continue;
+                }
+
+                if(pass == 0)
+                {
+                    count += p->vertex_count - 2;
+                    continue;
+                }
+
+                for(uint16_t k = 2; k < p->vertex_count; k++, t += 12)
+                {
+                    Mat4_vec3_mul_macro(t + 0, r->transform, p->vertices[0].position);
+                    Mat4_vec3_mul_macro(t + 3, r->transform, p->vertices[k - 1].position);
+                    Mat4_vec3_mul_macro(t + 6, r->transform, p->vertices[k].position);
+                    Mat4_vec3_rot_macro(t + 9, r->transform, p->plane);
+                }
+            }
 
+            if((pass == 0) && (count > 0))
+            {
+                r->content->occluders = (float*)malloc(12 * count * sizeof(float));
+                r->content->occluders_count = count;
+            }
+            else if(pass == 0)
+            {
+                break;
+            }
+        }
+    }
+}
+
+void CRender::ClearRoomsOccluders()
+{
+    if(m_rooms)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
+        {
+            if(m_rooms[i].content && m_rooms[i].content->occluders)
+            {
+                free(m_rooms[i].content->occluders);
+                m_rooms[i].content->occluders = NULL;
+                m_rooms[i].content->occluders_count = 0;
+            }
+        }
+    }
+}
+
+void CRender::RasterizeOccluders()
+{
+    m_occlusion_active = false;
+    if(!settings.occlusion_culling || !m_camera)
+    {
+        return;
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    float *cam_pos = m_camera->gl_transform + 12;
+    m_occlusion->Reset(m_camera->gl_view_proj_mat);
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_content_p content = r_list[i].room->content;
+        float *t = content->occluders;
+        for(uint32_t j = 0; j < content->occluders_count; j++, t += 12)
+        {
+            float dir[3];
+            vec3_sub(dir, cam_pos, t);
+            if(vec3_dot(dir, t + 9) > 0.0f)                                     // front faces only, as GL culls them
+            {
+                m_occlusion->AddOccluder(t, t + 3, t + 6);
+            }
+        }
+    }
+    m_occlusion->UpdateTiles();
+    m_occlusion_active = true;
+    m_occlusion_time = (SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency();
+}
+
+bool CRender::IsOccluded(struct obb_s *obb)
+{
+    return m_occlusion_active && m_occlusion->IsOBBOccluded(obb);
+}
+
+void CRender::GetTransparencyStats(struct render_transparency_stats_s *stats)
+{
+    if(settings.transparency_mode == RENDER_TRANSPARENCY_BATCHES)
+    {
+        stats->polygons = m_transparency_batches->GetPolygonsCount();
+        stats->splits = 0;
+        stats->batches = m_transparency_batches->GetBatchesCount();
+    }
+    else
+    {
+        stats->polygons = dynamicBSP->GetAddedPolygonsCount();
+        stats->splits = dynamicBSP->GetSplitPolygonsCount();
+        stats->batches = 0;
+    }
+    stats->prebuilt_polygons = m_prebuilt_polygons;
+    stats->prebuilt_splits = m_prebuilt_splits;
+    stats->build_time_us = m_transparency_time;
+}
+
+void CRender::GetLightingStats(struct render_lighting_stats_s *stats)
+{
+    stats->entities = m_light_setups;
+    stats->candidates = m_light_candidates;
+    stats->bins_cells = m_light_bins_cells;
+}
+
+/**
+ * Static rooms lights are binned once per level: each room content gets grid
+ * with cells of room sector size, cell keeps the strongest lights reaching it.
+ */
+void CRender::BuildRoomsLightBins()
+{
+    m_light_bins_cells = 0;
+    for(uint32_t i = 0; i < m_rooms_count; i++)
+    {
+        room_p r = m_rooms + i;
+        if((r->content->light_bins == NULL) && (r->content->lights_count > 0))
+        {
+            r->content->light_bins = LightBins_Create(r->bb_min, r->bb_max, r->content->lights, r->content->lights_count, MAX_NUM_LIGHTS);
+            if(r->content->light_bins)
+            {
+                light_bins_p bins = r->content->light_bins;
+                m_light_bins_cells += (uint32_t)bins->size[0] * bins->size[1] * bins->size[2];
+            }
+        }
+    }
+}
+
+void CRender::ClearRoomsLightBins()
+{
+    if(m_rooms)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
+        {
+            if(m_rooms[i].content && m_rooms[i].content->light_bins)
+            {
+                LightBins_Clear(m_rooms[i].content->light_bins);
+                m_rooms[i].content->light_bins = NULL;
+            }
+        }
+    }
+    m_light_bins_cells = 0;
+}
+
+/**
+ * Sets up the light calculations for the given entity based on its current
+ * room into the render queue lights setup. Returns the setup index (shared
+ * by all entity's render objects), *shader receives the shader to use.
+ * Own room suns go first, then candidates are taken from entity position
+ * cell of room and near rooms lights bins; MAX_NUM_LIGHTS strongest are used.
+ */
+uint32_t CRender::SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16], const lit_shader_description **shader)
+{
     room_s *room = entity->self->room;
     if(room != NULL)
     {
-        GLfloat ambient_component[4];
+        struct
+        {
+            const light_s  *light;
+            float           score;
+            bool            water_tint;
+        } best[MAX_NUM_LIGHTS];
+        uint32_t best_count = 0;
+        float *entity_pos = entity->transform + 12;
+
+        render_lights_p lights;
+        uint32_t ret = renderQueue->AddLights(&lights);
+        GLfloat *ambient_component = lights->ambient;
 
         ambient_component[0] = room->content->ambient_lighting[0];
         ambient_component[1] = room->content->ambient_lighting[1];
@@ -1239,105 +2221,100 @@ const lit_shader_description *CRender::SetupEntityLight(struct entity_s *entity,
             CalculateWaterTint(ambient_component, 0);
         }
 
-        GLenum current_light_number = 0;
-        light_s *current_light = NULL;
+        // only own room suns are used, they are not scored and take first slots
+        if(room->content->light_bins)
+        {
+            const light_bins_t *bins = room->content->light_bins;
+            for(uint16_t i = 0; (i < bins->suns_count) && (best_count < MAX_NUM_LIGHTS); i++)
+            {
+                best[best_count].light = room->content->lights + bins->suns[i];
+                best[best_count].score = 1.0e10f;
+                best[best_count].water_tint = (room->flags & TR_ROOM_FLAG_WATER) != 0;
+                best_count++;
+            }
+        }
 
-        GLfloat positions[3*MAX_NUM_LIGHTS];
-        GLfloat colors[4*MAX_NUM_LIGHTS];
-        GLfloat innerRadiuses[1*MAX_NUM_LIGHTS];
-        GLfloat outerRadiuses[1*MAX_NUM_LIGHTS];
-        memset(positions, 0, sizeof(positions));
-        memset(colors, 0, sizeof(colors));
-        memset(innerRadiuses, 0, sizeof(innerRadiuses));
-        memset(outerRadiuses, 0, sizeof(outerRadiuses));
+        // room_index 0 is entity room itself, then near rooms
+        for(uint32_t room_index = 0; room_index <= (uint32_t)room->near_room_list_size; room_index++)
+        {
+            bool is_own_room = (room_index == 0);
+            room_p r = (is_own_room) ? (room) : (room->near_room_list[room_index - 1]);
+            uint16_t count = 0;
+            const uint16_t *indexes = LightBins_GetCell(r->content->light_bins, entity_pos, &count);
 
-        float *entity_pos = entity->transform + 12;
+            for(uint16_t i = 0; i < count; i++)
+            {
+                const light_s *light = r->content->lights + indexes[i];
+                float score;
 
-        for(uint32_t i = 0; (i < room->content->lights_count) && (current_light_number < MAX_NUM_LIGHTS); i++)
-        {
-            current_light = &room->content->lights[i];
+                m_light_candidates++;
+                score = Light_GetScore(light, entity_pos);
+                if(score < 0.0f)
+                {
+                    continue;
+                }
+
+                uint32_t j = (best_count < MAX_NUM_LIGHTS) ? (best_count++) : (MAX_NUM_LIGHTS);
+                for( ; (j > 0) && (best[j - 1].score < score); j--)
+                {
+                    if(j < MAX_NUM_LIGHTS)
+                    {
+                        best[j] = best[j - 1];
+                    }
+                }
+                if(j < MAX_NUM_LIGHTS)
+                {
+                    best[j].light = light;
+                    best[j].score = score;
+                    best[j].water_tint = is_own_room && (room->flags & TR_ROOM_FLAG_WATER);
+                }
+            }
+        }
 
-            float x = entity_pos[0] - current_light->pos[0];
-            float y = entity_pos[1] - current_light->pos[1];
-            float z = entity_pos[2] - current_light->pos[2];
+        GLfloat *positions = lights->positions;                                 // setup is zeroed by queue
+        GLfloat *colors = lights->colors;
+        GLfloat *innerRadiuses = lights->inner_radiuses;
+        GLfloat *outerRadiuses = lights->outer_radiuses;
 
-            float distance = sqrtf(x * x + y * y + z * z);
+        for(uint32_t i = 0; i < best_count; i++)
+        {
+            const light_s *current_light = best[i].light;
 
             // Find color
-            colors[current_light_number*4 + 0] = std::fmin(std::fmax(current_light->colour[0], 0.0), 1.0);
-            colors[current_light_number*4 + 1] = std::fmin(std::fmax(current_light->colour[1], 0.0), 1.0);
-            colors[current_light_number*4 + 2] = std::fmin(std::fmax(current_light->colour[2], 0.0), 1.0);
-            colors[current_light_number*4 + 3] = std::fmin(std::fmax(current_light->colour[3], 0.0), 1.0);
+            colors[i*4 + 0] = std::fmin(std::fmax(current_light->colour[0], 0.0), 1.0);
+            colors[i*4 + 1] = std::fmin(std::fmax(current_light->colour[1], 0.0), 1.0);
+            colors[i*4 + 2] = std::fmin(std::fmax(current_light->colour[2], 0.0), 1.0);
+            colors[i*4 + 3] = std::fmin(std::fmax(current_light->colour[3], 0.0), 1.0);
 
-            if(room->flags & TR_ROOM_FLAG_WATER)
+            if(best[i].water_tint)
             {
-                CalculateWaterTint(colors + current_light_number * 4, 0);
+                CalculateWaterTint(colors + i * 4, 0);
             }
 
             // Find position
-            Mat4_vec3_mul(&positions[3*current_light_number], modelViewMatrix, current_light->pos);
+            Mat4_vec3_mul(&positions[3*i], modelViewMatrix, current_light->pos);
 
             // Find fall-off
             if(current_light->light_type == LT_SUN)
             {
-                innerRadiuses[current_light_number] = 1e20f;
-                outerRadiuses[current_light_number] = 1e21f;
-                current_light_number++;
+                innerRadiuses[i] = 1e20f;
+                outerRadiuses[i] = 1e21f;
             }
-            else if(distance <= current_light->outer + 1024.0f && (current_light->light_type == LT_POINT || current_light->light_type == LT_SHADOW))
+            else
             {
-                innerRadiuses[current_light_number] = std::fabs(current_light->inner);
-                outerRadiuses[current_light_number] = std::fabs(current_light->outer);
-                current_light_number++;
+                innerRadiuses[i] = std::fabs(current_light->inner);
+                outerRadiuses[i] = std::fabs(current_light->outer);
             }
         }
 
-        for(uint32_t room_index = 0; (current_light_number < MAX_NUM_LIGHTS) && (room_index < room->near_room_list_size); room_index++)
-        {
-            room_p near_room = room->near_room_list[room_index];
-            for(uint32_t i = 0; (i < near_room->content->lights_count) && (current_light_number < MAX_NUM_LIGHTS); i++)
-            {
-                current_light = &near_room->content->lights[i];
-
-                float x = entity_pos[0] - current_light->pos[0];
-                float y = entity_pos[1] - current_light->pos[1];
-                float z = entity_pos[2] - current_light->pos[2];
-
-                float distance = sqrtf(x * x + y * y + z * z);
-
-                // Find color
-                colors[current_light_number*4 + 0] = std::fmin(std::fmax(current_light->colour[0], 0.0), 1.0);
-                colors[current_light_number*4 + 1] = std::fmin(std::fmax(current_light->colour[1], 0.0), 1.0);
-                colors[current_light_number*4 + 2] = std::fmin(std::fmax(current_light->colour[2], 0.0), 1.0);
-                colors[current_light_number*4 + 3] = std::fmin(std::fmax(current_light->colour[3], 0.0), 1.0);
-
-                // Find position
-                Mat4_vec3_mul(&positions[3*current_light_number], modelViewMatrix, current_light->pos);
-
-                // Find fall-off
-                if(distance <= current_light->outer + 1024.0f && (current_light->light_type == LT_POINT || current_light->light_type == LT_SHADOW))
-                {
-                    innerRadiuses[current_light_number] = std::fabs(current_light->inner);
-                    outerRadiuses[current_light_number] = std::fabs(current_light->outer);
-                    current_light_number++;
-                }
-            }
-        }
-
-        shader = shaderManager->getEntityShader(current_light_number);
-        qglUseProgramObjectARB(shader->program);
-        qglUniform4fvARB(shader->light_ambient, 1, ambient_component);
-        qglUniform4fvARB(shader->light_color, current_light_number, colors);
-        qglUniform3fvARB(shader->light_position, current_light_number, positions);
-        qglUniform1fvARB(shader->light_inner_radius, current_light_number, innerRadiuses);
-        qglUniform1fvARB(shader->light_outer_radius, current_light_number, outerRadiuses);
+        m_light_setups++;
+        lights->count = best_count;
+        *shader = shaderManager->getEntityShader(best_count);
+        return ret;
     }
-    else
-    {
-        shader = shaderManager->getEntityShader(0);
-        qglUseProgramObjectARB(shader->program);
-    }
-    return shader;
+
+    *shader = shaderManager->getEntityShader(0);
+    return RENDER_NO_LIGHTS;
 }
 
 /**
@@ -1708,7 +2685,7 @@ void CRenderDebugDrawer::DrawEntityDebugLines(struct entity_s *entity)
     if(m_drawFlags & R_DRAW_BOXES)
     {
         this->SetColor(0.0, 0.0, 1.0);
-        this->DrawOBB(entity->obb);
+        this->DrawOBB(Entity_GetOBB(entity));
     }
 
     if(m_drawFlags & R_DRAW_AXIS)
@@ -1819,7 +2796,7 @@ void CRenderDebugDrawer::DrawRoomDebugLines(struct room_s *room, struct camera_s
         {
             case OBJECT_ENTITY:
                 ent = (entity_p)cont->object;
-                if(Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (cam->frustum)))
+                if(Frustum_IsOBBVisibleInFrustumList(ent->bv_obb, (room->frustum) ? (room->frustum) : (cam->frustum)))
                 {
                     this->DrawEntityDebugLines(ent);
                 }
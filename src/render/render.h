@@ -28,6 +28,9 @@
 
 #define STENCIL_FRUSTUM 1
 
+#define R_ROOM_MAX_FRUSTUMS             (8)                                     // room's frustums budget, next ones are merged
+#define R_PORTAL_QUEUE_DEFAULT_SIZE     (256)
+
 struct portal_s;
 struct frustum_s;
 struct world_s;
@@ -38,6 +41,8 @@ struct sprite_s;
 struct base_mesh_s;
 struct obb_s;
 struct lit_shader_description;
+struct render_queue_stats_s;
+class  CRenderDevice;
 
 // Native TR blending modes.
 
@@ -63,6 +68,11 @@ enum BlendingMode
 #define TR_ANIMTEXTURE_BACKWARD          1
 #define TR_ANIMTEXTURE_REVERSE           2
 
+// Transparency drawing modes
+
+#define RENDER_TRANSPARENCY_DYNAMIC_BSP  0                                      // all visible polygons to one BSP per frame
+#define RENDER_TRANSPARENCY_BATCHES      1                                      // prebuilt rooms BSPs + sorted objects batches
+
 
 typedef struct render_settings_s
 {
@@ -75,11 +85,54 @@ typedef struct render_settings_s
     int8_t    texture_border;
     int8_t    z_depth;
     int8_t    fog_enabled;
+    int8_t    use_texture_array;                                                // rooms atlas pages as one GL_TEXTURE_2D_ARRAY
+    int8_t    transparency_mode;                                                // RENDER_TRANSPARENCY_*
+    int8_t    occlusion_culling;                                                // software depth buffer for statics and entities
     GLfloat   fog_color[4];
     float     fog_start_depth;
     float     fog_end_depth;
 }render_settings_t, *render_settings_p;
 
+typedef struct render_visibility_stats_s
+{
+    uint32_t  rooms_in_list;
+    uint32_t  rooms_visited;                                                    // portal traversal steps
+    uint32_t  portals_queued;
+    uint32_t  frustums_generated;
+    uint32_t  frustums_merged;                                                  // replaced by camera frustum through the portal
+    uint32_t  frustums_dropped;                                                 // portal already has camera frustum
+    uint32_t  frustum_buffer_used;
+    uint32_t  frustum_buffer_high_water;
+    uint32_t  frustum_buffer_size;
+    uint32_t  obb_tests;                                                        // boxes tested against frustum lists
+    uint32_t  obb_planes_rejected;                                              // box / frustum pairs rejected by planes test only
+    uint32_t  obb_bench;                                                        // scalar vs SIMD planes kernels timing is on
+    uint32_t  obb_bench_scalar_us;
+    uint32_t  obb_bench_simd_us;
+    uint32_t  obb_bench_mismatches;                                             // must be 0
+    uint32_t  occluder_triangles;                                               // rasterized this frame
+    uint32_t  occlusion_tests;
+    uint32_t  occlusion_culled;
+    uint32_t  occlusion_time_us;                                                // CPU rasterization time
+}render_visibility_stats_t, *render_visibility_stats_p;
+
+typedef struct render_transparency_stats_s
+{
+    uint32_t  polygons;                                                         // added this frame
+    uint32_t  splits;                                                           // this frame
+    uint32_t  batches;
+    uint32_t  prebuilt_polygons;                                                // rooms BSPs, built on level load
+    uint32_t  prebuilt_splits;
+    uint32_t  build_time_us;                                                    // CPU time of this frame BSP / batches build and sort
+}render_transparency_stats_t, *render_transparency_stats_p;
+
+typedef struct render_lighting_stats_s
+{
+    uint32_t  entities;                                                         // lights setups this frame
+    uint32_t  candidates;                                                       // binned lights scored this frame
+    uint32_t  bins_cells;                                                       // all rooms grids, built on level load
+}render_lighting_stats_t, *render_lighting_stats_p;
+
 
 class CRenderDebugDrawer
 {
@@ -148,17 +201,23 @@ class CRender
         void DrawBSPFrontToBack(struct bsp_node_s *root);
         void DrawBSPBackToFront(struct bsp_node_s *root);
 
-        void DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals);
+        void DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals, GLenum target = GL_TEXTURE_2D);
         void DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16]);
         void DrawSkyBox(const float matrix[16]);
 
         void DrawSkeletalModel(const struct lit_shader_description *shader, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16]);
-        void DrawEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16]);
+        void DrawSprites();                                                     // all rooms in render list
 
-        void DrawRoom(struct room_s *room, const float matrix[16], const float modelViewProjectionMatrix[16]);
-        void DrawRoomSprites(struct room_s *room);
+        const struct render_queue_stats_s *GetQueueStats() const;
+        void GetVisibilityStats(struct render_visibility_stats_s *stats);
+        void GetTransparencyStats(struct render_transparency_stats_s *stats);
+        void GetLightingStats(struct render_lighting_stats_s *stats);
 
         struct gl_text_line_s *OutTextXYZ(GLfloat x, GLfloat y, GLfloat z, const char *fmt, ...);
+
+        void SetNullDevice(bool is_null);                                       // null device records render calls without GL
+        bool IsNullDevice() const {return m_device == m_null_device;}
+        CRenderDevice *GetDevice() {return m_device;}
         
     private:
         struct render_list_s
@@ -168,12 +227,54 @@ class CRender
             float              dist;
         };
 
+        struct portal_queue_item_s
+        {
+            struct portal_s   *portal;
+            struct frustum_s  *frustum;
+        };
+
         void InitSettings();
         int  AddRoom(struct room_s *room);
         int  ProcessRoom(struct portal_s *portal, struct frustum_s *frus);
-        const lit_shader_description *SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16]);
+        struct frustum_s *PortalFrustum(struct portal_s *portal, struct frustum_s *emitter);
+        void PushPortal(struct portal_s *portal, struct frustum_s *frus);
+        void ProcessPortalQueue();
+        uint32_t SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16], const lit_shader_description **shader);
+        void BuildRoomsLightBins();
+        void ClearRoomsLightBins();
+        void BuildRoomsOccluders();
+        void ClearRoomsOccluders();
+        void RasterizeOccluders();
+        bool IsOccluded(struct obb_s *obb);
+
+        void BindFaceTexture(const struct mesh_face_s *face);
+        void BindMeshVertices(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals);
+        void DrawMeshAnimatedFaces(struct base_mesh_s *mesh);
+        void SkinMeshVertices(GLfloat *dst, struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, const uint32_t *map, const float transform[16]);
+        float *GenSkinMeshVertices(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16]);
+
+        // render queue commands generation and submission
+        void QueueSkeletalModel(const struct lit_shader_description *shader, uint32_t lights, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16], float depth);
+        void QueueEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16]);
+        void QueueRoom(struct room_s *room, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16], float depth);
+        void SkinQueueMeshes();
+        void DrawRoomSprites(struct room_s *room, bool use_buffer);
+
+        // transparency
+        void BuildRoomsTransparency();
+        void ClearRoomsTransparency();
+        void SetTransparencyState(uint16_t transparency, GLuint texture);
+        void BeginTransparency();
+        void BindTransparencyVertices(GLuint vbo);
+        void EndTransparency();
+        void DrawTransparencyDynamicBSP();
+        void DrawTransparencyBatches();
+        void SubmitQueue();
         
         struct camera_s            *m_camera;
+        class CRenderDevice        *m_device;
+        class CRenderDevice        *m_gl_device;
+        class CRenderDevice        *m_null_device;
         
         struct room_s              *m_rooms;
         uint32_t                    m_rooms_count;
@@ -186,7 +287,27 @@ class CRender
         uint32_t                    r_list_size;
         uint32_t                    r_list_active_count;
         struct render_list_s       *r_list;
+
+        uint32_t                    m_portal_queue_size;
+        uint32_t                    m_portal_queue_count;
+        struct portal_queue_item_s *m_portal_queue;
+        uint32_t                    m_rooms_visited;
+        uint32_t                    m_frustums_merged;
+        uint32_t                    m_frustums_dropped;
+        GLuint                      m_skin_buffer;                              // streaming skinned vertices, all frame's skin jobs
+        size_t                      m_skin_buffer_size;
+        class CTransparencyBatches *m_transparency_batches;
+        uint32_t                    m_prebuilt_polygons;
+        uint32_t                    m_prebuilt_splits;
+        uint32_t                    m_transparency_time;                        // microseconds
+        uint32_t                    m_light_setups;
+        uint32_t                    m_light_candidates;
+        uint32_t                    m_light_bins_cells;
+        class COcclusionBuffer     *m_occlusion;
+        bool                        m_occlusion_active;                         // buffer is filled for this frame
+        uint32_t                    m_occlusion_time;                           // microseconds
         class CFrustumManager      *frustumManager;
+        class CRenderQueue         *renderQueue;
         
     public:
         struct render_settings_s    settings;
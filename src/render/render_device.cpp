@@ -0,0 +1,425 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "../core/gl_util.h"
+#include "../core/system.h"
+#include "render_device.h"
+
+
+/*
+ * NULL (RECORDING) DEVICE
+ */
+CRenderDevice::CRenderDevice():
+m_log_file(NULL),
+m_map_buffer(NULL),
+m_map_buffer_size(0),
+m_element_buffer(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(&m_last_frame_stats, 0, sizeof(m_last_frame_stats));
+}
+
+CRenderDevice::~CRenderDevice()
+{
+    free(m_map_buffer);
+    m_map_buffer = NULL;
+    m_map_buffer_size = 0;
+}
+
+void CRenderDevice::BeginFrame()
+{
+    m_last_frame_stats = m_stats;
+    memset(&m_stats, 0, sizeof(m_stats));
+    this->Log("frame");
+}
+
+void CRenderDevice::Log(const char *fmt, ...)
+{
+    if(m_log_file)
+    {
+        char buf[256];
+        va_list argptr;
+        va_start(argptr, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, argptr);
+        va_end(argptr);
+        Sys_DebugLog(m_log_file, "%s", buf);
+    }
+}
+
+void CRenderDevice::Enable(GLenum cap)
+{
+    m_stats.state_changes++;
+    this->Log("enable 0x%X", cap);
+}
+
+void CRenderDevice::Disable(GLenum cap)
+{
+    m_stats.state_changes++;
+    this->Log("disable 0x%X", cap);
+}
+
+void CRenderDevice::BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    m_stats.state_changes++;
+    this->Log("blend 0x%X 0x%X", sfactor, dfactor);
+}
+
+void CRenderDevice::DepthMask(GLboolean flag)
+{
+    m_stats.state_changes++;
+    this->Log("depth mask %d", flag);
+}
+
+void CRenderDevice::PolygonMode(GLenum face, GLenum mode)
+{
+    m_stats.state_changes++;
+    this->Log("polygon mode 0x%X 0x%X", face, mode);
+}
+
+void CRenderDevice::PointSize(GLfloat size)
+{
+    m_stats.state_changes++;
+    this->Log("point size %f", size);
+}
+
+void CRenderDevice::Clear(GLbitfield mask)
+{
+    m_stats.state_changes++;
+    this->Log("clear 0x%X", mask);
+}
+
+void CRenderDevice::StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    m_stats.state_changes++;
+    this->Log("stencil func 0x%X %d 0x%X", func, ref, mask);
+}
+
+void CRenderDevice::StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+    m_stats.state_changes++;
+    this->Log("stencil op 0x%X 0x%X 0x%X", sfail, dpfail, dppass);
+}
+
+void CRenderDevice::UseProgram(GLhandleARB program)
+{
+    m_stats.program_changes++;
+    this->Log("program %d", (int)program);
+}
+
+void CRenderDevice::Uniform1i(GLint location, GLint v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::Uniform1f(GLint location, GLfloat v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::Uniform1fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::Uniform3fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::Uniform4fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *v)
+{
+    m_stats.uniforms++;
+}
+
+void CRenderDevice::BindTexture(GLuint texture)
+{
+    m_stats.texture_changes++;
+    this->Log("texture %d", texture);
+}
+
+void CRenderDevice::BindTextureArray(GLuint texture)
+{
+    m_stats.texture_changes++;
+    this->Log("texture array %d", texture);
+}
+
+void CRenderDevice::BindWhiteTexture()
+{
+    m_stats.texture_changes++;
+    this->Log("texture white");
+}
+
+GLuint CRenderDevice::GenBuffer()
+{
+    this->Log("gen buffer");
+    return 0;
+}
+
+void CRenderDevice::DeleteBuffer(GLuint buffer)
+{
+    this->Log("delete buffer %d", buffer);
+}
+
+void CRenderDevice::BindBuffer(GLenum target, GLuint buffer)
+{
+    m_stats.buffer_binds++;
+    if(target == GL_ELEMENT_ARRAY_BUFFER_ARB)
+    {
+        m_element_buffer = buffer;
+    }
+}
+
+void CRenderDevice::BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    m_stats.bytes_uploaded += size;
+    this->Log("buffer data 0x%X %d", target, (int)size);
+}
+
+void *CRenderDevice::MapBuffer(GLenum target, GLenum access, size_t size)
+{
+    m_stats.bytes_uploaded += size;
+    this->Log("map buffer 0x%X %d", target, (int)size);
+    if(size > m_map_buffer_size)
+    {
+        free(m_map_buffer);
+        m_map_buffer = (uint8_t*)malloc(size);
+        m_map_buffer_size = (m_map_buffer) ? (size) : (0);
+    }
+    return m_map_buffer;
+}
+
+void CRenderDevice::UnmapBuffer(GLenum target)
+{
+}
+
+void CRenderDevice::VertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+}
+
+void CRenderDevice::ColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+}
+
+void CRenderDevice::NormalPointer(GLenum type, GLsizei stride, const void *pointer)
+{
+}
+
+void CRenderDevice::TexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+}
+
+void CRenderDevice::DrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    m_stats.draw_calls++;
+    m_stats.elements += count;
+    if(m_element_buffer == 0)
+    {
+        m_stats.client_index_bytes += count * ((type == GL_UNSIGNED_INT) ? (4) : ((type == GL_UNSIGNED_SHORT) ? (2) : (1)));
+    }
+    this->Log("draw elements 0x%X %d 0x%X", mode, count, type);
+}
+
+void CRenderDevice::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    m_stats.draw_calls++;
+    m_stats.elements += count;
+    this->Log("draw arrays 0x%X %d", mode, count);
+}
+
+
+/*
+ * GL DEVICE
+ */
+void CGLRenderDevice::Enable(GLenum cap)
+{
+    CRenderDevice::Enable(cap);
+    qglEnable(cap);
+}
+
+void CGLRenderDevice::Disable(GLenum cap)
+{
+    CRenderDevice::Disable(cap);
+    qglDisable(cap);
+}
+
+void CGLRenderDevice::BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    CRenderDevice::BlendFunc(sfactor, dfactor);
+    qglBlendFunc(sfactor, dfactor);
+}
+
+void CGLRenderDevice::DepthMask(GLboolean flag)
+{
+    CRenderDevice::DepthMask(flag);
+    qglDepthMask(flag);
+}
+
+void CGLRenderDevice::PolygonMode(GLenum face, GLenum mode)
+{
+    CRenderDevice::PolygonMode(face, mode);
+    qglPolygonMode(face, mode);
+}
+
+void CGLRenderDevice::PointSize(GLfloat size)
+{
+    CRenderDevice::PointSize(size);
+    qglPointSize(size);
+}
+
+void CGLRenderDevice::Clear(GLbitfield mask)
+{
+    CRenderDevice::Clear(mask);
+    qglClear(mask);
+}
+
+void CGLRenderDevice::StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+    CRenderDevice::StencilFunc(func, ref, mask);
+    qglStencilFunc(func, ref, mask);
+}
+
+void CGLRenderDevice::StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+    CRenderDevice::StencilOp(sfail, dpfail, dppass);
+    qglStencilOp(sfail, dpfail, dppass);
+}
+
+void CGLRenderDevice::UseProgram(GLhandleARB program)
+{
+    CRenderDevice::UseProgram(program);
+    qglUseProgramObjectARB(program);
+}
+
+void CGLRenderDevice::Uniform1i(GLint location, GLint v)
+{
+    CRenderDevice::Uniform1i(location, v);
+    qglUniform1iARB(location, v);
+}
+
+void CGLRenderDevice::Uniform1f(GLint location, GLfloat v)
+{
+    CRenderDevice::Uniform1f(location, v);
+    qglUniform1fARB(location, v);
+}
+
+void CGLRenderDevice::Uniform1fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    CRenderDevice::Uniform1fv(location, count, v);
+    qglUniform1fvARB(location, count, v);
+}
+
+void CGLRenderDevice::Uniform3fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    CRenderDevice::Uniform3fv(location, count, v);
+    qglUniform3fvARB(location, count, v);
+}
+
+void CGLRenderDevice::Uniform4fv(GLint location, GLsizei count, const GLfloat *v)
+{
+    CRenderDevice::Uniform4fv(location, count, v);
+    qglUniform4fvARB(location, count, v);
+}
+
+void CGLRenderDevice::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *v)
+{
+    CRenderDevice::UniformMatrix4fv(location, count, transpose, v);
+    qglUniformMatrix4fvARB(location, count, transpose, v);
+}
+
+void CGLRenderDevice::BindTexture(GLuint texture)
+{
+    CRenderDevice::BindTexture(texture);
+    qglBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void CGLRenderDevice::BindTextureArray(GLuint texture)
+{
+    CRenderDevice::BindTextureArray(texture);
+    qglBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
+void CGLRenderDevice::BindWhiteTexture()
+{
+    CRenderDevice::BindWhiteTexture();
+    ::BindWhiteTexture();
+}
+
+GLuint CGLRenderDevice::GenBuffer()
+{
+    GLuint buffer = 0;
+    CRenderDevice::GenBuffer();
+    qglGenBuffersARB(1, &buffer);
+    return buffer;
+}
+
+void CGLRenderDevice::DeleteBuffer(GLuint buffer)
+{
+    CRenderDevice::DeleteBuffer(buffer);
+    qglDeleteBuffersARB(1, &buffer);
+}
+
+void CGLRenderDevice::BindBuffer(GLenum target, GLuint buffer)
+{
+    CRenderDevice::BindBuffer(target, buffer);
+    qglBindBufferARB(target, buffer);
+}
+
+void CGLRenderDevice::BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+    CRenderDevice::BufferData(target, size, data, usage);
+    qglBufferDataARB(target, size, data, usage);
+}
+
+void *CGLRenderDevice::MapBuffer(GLenum target, GLenum access, size_t size)
+{
+    m_stats.bytes_uploaded += size;
+    this->Log("map buffer 0x%X %d", target, (int)size);
+    return qglMapBufferARB(target, access);
+}
+
+void CGLRenderDevice::UnmapBuffer(GLenum target)
+{
+    qglUnmapBufferARB(target);
+}
+
+void CGLRenderDevice::VertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+    qglVertexPointer(size, type, stride, pointer);
+}
+
+void CGLRenderDevice::ColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+    qglColorPointer(size, type, stride, pointer);
+}
+
+void CGLRenderDevice::NormalPointer(GLenum type, GLsizei stride, const void *pointer)
+{
+    qglNormalPointer(type, stride, pointer);
+}
+
+void CGLRenderDevice::TexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+    qglTexCoordPointer(size, type, stride, pointer);
+}
+
+void CGLRenderDevice::DrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    CRenderDevice::DrawElements(mode, count, type, indices);
+    qglDrawElements(mode, count, type, indices);
+}
+
+void CGLRenderDevice::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    CRenderDevice::DrawArrays(mode, first, count);
+    qglDrawArrays(mode, first, count);
+}
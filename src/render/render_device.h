@@ -0,0 +1,130 @@
+
+#ifndef RENDER_DEVICE_H
+#define RENDER_DEVICE_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+
+typedef struct render_device_stats_s
+{
+    uint32_t    draw_calls;
+    uint32_t    elements;                                                       // indices / vertices passed to draw calls
+    uint32_t    state_changes;                                                  // enable / disable, blend, depth, stencil, polygon modes
+    uint32_t    program_changes;
+    uint32_t    texture_changes;
+    uint32_t    buffer_binds;
+    uint32_t    uniforms;
+    uint32_t    bytes_uploaded;
+    uint32_t    client_index_bytes;                                             // indices read from client memory by draw calls
+}render_device_stats_t, *render_device_stats_p;
+
+/*
+ * Render device: the only way renderer talks to the graphics API.
+ * Base class is a null device: it records statistics (and optionally logs
+ * every call) without any API calls, so render lists can be processed
+ * without GPU. GL device forwards calls to qgl* after recording.
+ */
+class CRenderDevice
+{
+    public:
+        CRenderDevice();
+        virtual ~CRenderDevice();
+
+        void BeginFrame();                                                      // last frame stats are saved, counters are reset
+        const render_device_stats_t *GetStats() const {return &m_stats;}
+        const render_device_stats_t *GetLastFrameStats() const {return &m_last_frame_stats;}
+        void SetLogFile(const char *file_name) {m_log_file = file_name;}        // NULL disables calls logging
+
+        virtual void Enable(GLenum cap);
+        virtual void Disable(GLenum cap);
+        virtual void BlendFunc(GLenum sfactor, GLenum dfactor);
+        virtual void DepthMask(GLboolean flag);
+        virtual void PolygonMode(GLenum face, GLenum mode);
+        virtual void PointSize(GLfloat size);
+        virtual void Clear(GLbitfield mask);
+        virtual void StencilFunc(GLenum func, GLint ref, GLuint mask);
+        virtual void StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass);
+
+        virtual void UseProgram(GLhandleARB program);
+        virtual void Uniform1i(GLint location, GLint v);
+        virtual void Uniform1f(GLint location, GLfloat v);
+        virtual void Uniform1fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void Uniform3fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void Uniform4fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *v);
+
+        virtual void BindTexture(GLuint texture);                               // GL_TEXTURE_2D target
+        virtual void BindTextureArray(GLuint texture);                          // GL_TEXTURE_2D_ARRAY target
+        virtual void BindWhiteTexture();
+
+        virtual GLuint GenBuffer();                                             // null device has no buffers: returns 0
+        virtual void DeleteBuffer(GLuint buffer);
+        virtual void BindBuffer(GLenum target, GLuint buffer);
+        virtual void BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+        virtual void *MapBuffer(GLenum target, GLenum access, size_t size);
+        virtual void UnmapBuffer(GLenum target);
+
+        virtual void VertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+        virtual void ColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+        virtual void NormalPointer(GLenum type, GLsizei stride, const void *pointer);
+        virtual void TexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+
+        virtual void DrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+        virtual void DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+    protected:
+        void Log(const char *fmt, ...);
+
+        render_device_stats_t   m_stats;
+        render_device_stats_t   m_last_frame_stats;
+        const char             *m_log_file;
+        uint8_t                *m_map_buffer;                                   // null device mapped buffers storage
+        size_t                  m_map_buffer_size;
+        GLuint                  m_element_buffer;
+};
+
+
+class CGLRenderDevice : public CRenderDevice
+{
+    public:
+        virtual void Enable(GLenum cap);
+        virtual void Disable(GLenum cap);
+        virtual void BlendFunc(GLenum sfactor, GLenum dfactor);
+        virtual void DepthMask(GLboolean flag);
+        virtual void PolygonMode(GLenum face, GLenum mode);
+        virtual void PointSize(GLfloat size);
+        virtual void Clear(GLbitfield mask);
+        virtual void StencilFunc(GLenum func, GLint ref, GLuint mask);
+        virtual void StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass);
+
+        virtual void UseProgram(GLhandleARB program);
+        virtual void Uniform1i(GLint location, GLint v);
+        virtual void Uniform1f(GLint location, GLfloat v);
+        virtual void Uniform1fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void Uniform3fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void Uniform4fv(GLint location, GLsizei count, const GLfloat *v);
+        virtual void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *v);
+
+        virtual void BindTexture(GLuint texture);
+        virtual void BindTextureArray(GLuint texture);
+        virtual void BindWhiteTexture();
+
+        virtual GLuint GenBuffer();
+        virtual void DeleteBuffer(GLuint buffer);
+        virtual void BindBuffer(GLenum target, GLuint buffer);
+        virtual void BufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+        virtual void *MapBuffer(GLenum target, GLenum access, size_t size);
+        virtual void UnmapBuffer(GLenum target);
+
+        virtual void VertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+        virtual void ColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+        virtual void NormalPointer(GLenum type, GLsizei stride, const void *pointer);
+        virtual void TexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+
+        virtual void DrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+        virtual void DrawArrays(GLenum mode, GLint first, GLsizei count);
+};
+
+#endif
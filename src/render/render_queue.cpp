@@ -0,0 +1,378 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "../mesh.h"
+#include "shader_description.h"
+#include "render_queue.h"
+
+
+CRenderQueue::CRenderQueue(uint32_t commands_size):
+m_commands_size(commands_size),
+m_commands_count(0),
+m_objects_size(commands_size / 4),
+m_objects_count(0),
+m_lights_size(64),
+m_lights_count(0),
+m_skin_jobs_size(64),
+m_skin_jobs_count(0),
+m_skin_bytes(0)
+{
+    m_commands  = (render_command_t*)malloc(m_commands_size * sizeof(render_command_t));
+    m_items     = (struct sort_item_s*)malloc(m_commands_size * sizeof(struct sort_item_s));
+    m_items_tmp = (struct sort_item_s*)malloc(m_commands_size * sizeof(struct sort_item_s));
+    m_objects   = (render_object_t*)malloc(m_objects_size * sizeof(render_object_t));
+    m_lights    = (render_lights_t*)malloc(m_lights_size * sizeof(render_lights_t));
+    m_skin_jobs = (render_skin_job_t*)malloc(m_skin_jobs_size * sizeof(render_skin_job_t));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CRenderQueue::~CRenderQueue()
+{
+    free(m_commands);
+    m_commands = NULL;
+    free(m_items);
+    m_items = NULL;
+    free(m_items_tmp);
+    m_items_tmp = NULL;
+    free(m_objects);
+    m_objects = NULL;
+    free(m_lights);
+    m_lights = NULL;
+    free(m_skin_jobs);
+    m_skin_jobs = NULL;
+    m_commands_size = 0;
+    m_commands_count = 0;
+    m_objects_size = 0;
+    m_objects_count = 0;
+    m_lights_size = 0;
+    m_lights_count = 0;
+    m_skin_jobs_size = 0;
+    m_skin_jobs_count = 0;
+    m_skin_bytes = 0;
+}
+
+void CRenderQueue::Reset()
+{
+    m_commands_count = 0;
+    m_objects_count = 0;
+    m_lights_count = 0;
+    m_skin_jobs_count = 0;
+    m_skin_bytes = 0;
+}
+
+uint32_t CRenderQueue::AddLights(render_lights_p *lights)
+{
+    if(m_lights_count >= m_lights_size)
+    {
+        m_lights_size *= 2;
+        m_lights = (render_lights_t*)realloc(m_lights, m_lights_size * sizeof(render_lights_t));
+    }
+    *lights = m_lights + m_lights_count;
+    memset(*lights, 0, sizeof(render_lights_t));
+    return m_lights_count++;
+}
+
+uint32_t CRenderQueue::AddObject(const GLfloat mvp[16], const GLfloat mv[16], const GLfloat tint[4], uint32_t lights,
+                                 const GLfloat *bones, uint16_t bones_count, uint16_t bone)
+{
+    render_object_p obj;
+
+    if(m_objects_count >= m_objects_size)
+    {
+        m_objects_size *= 2;
+        m_objects = (render_object_t*)realloc(m_objects, m_objects_size * sizeof(render_object_t));
+    }
+
+    obj = m_objects + m_objects_count;
+    memcpy(obj->mvp, mvp, sizeof(obj->mvp));
+    if(mv)
+    {
+        memcpy(obj->mv, mv, sizeof(obj->mv));
+    }
+    if(tint)
+    {
+        memcpy(obj->tint, tint, sizeof(obj->tint));
+    }
+    obj->lights = lights;
+    obj->bones = bones;
+    obj->bones_count = bones_count;
+    obj->bone = bone;
+
+    return m_objects_count++;
+}
+
+/**
+ * Skinned mesh vertices are not generated here: all jobs are processed by
+ * renderer in one pass before submission, into one streaming buffer.
+ */
+uint32_t CRenderQueue::AddSkinJob(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, const uint32_t *map, const GLfloat transform[16])
+{
+    render_skin_job_p job;
+
+    if(m_skin_jobs_count >= m_skin_jobs_size)
+    {
+        m_skin_jobs_size *= 2;
+        m_skin_jobs = (render_skin_job_t*)realloc(m_skin_jobs, m_skin_jobs_size * sizeof(render_skin_job_t));
+    }
+
+    job = m_skin_jobs + m_skin_jobs_count;
+    job->mesh = mesh;
+    job->parent_mesh = parent_mesh;
+    job->map = map;
+    memcpy(job->transform, transform, sizeof(job->transform));
+    job->offset = m_skin_bytes;
+    m_skin_bytes += 2 * 3 * sizeof(GLfloat) * mesh->vertex_count;
+
+    return m_skin_jobs_count++;
+}
+
+void CRenderQueue::AddCommand(const render_command_t *cmd, uint64_t key)
+{
+    if(m_commands_count >= m_commands_size)
+    {
+        m_commands_size *= 2;
+        m_commands  = (render_command_t*)realloc(m_commands, m_commands_size * sizeof(render_command_t));
+        m_items     = (struct sort_item_s*)realloc(m_items, m_commands_size * sizeof(struct sort_item_s));
+        m_items_tmp = (struct sort_item_s*)realloc(m_items_tmp, m_commands_size * sizeof(struct sort_item_s));
+    }
+
+    m_commands[m_commands_count] = *cmd;
+    m_items[m_commands_count].key = key;
+    m_items[m_commands_count].command = m_commands_count;
+    m_commands_count++;
+}
+
+/**
+ * Adds one command per mesh face: key bits are
+ * [63..60] pass, [59..48] shader, [47..32] texture, [31..0] depth.
+ * Depth is a non negative float, so it's bits order is the values order.
+ * Faces with texture array are drawn by array_shader (same uniforms).
+ */
+void CRenderQueue::AddMesh(const struct shader_description *shader, uint16_t shader_type, uint32_t object, struct base_mesh_s *mesh,
+                           uint32_t skin, float depth, const struct shader_description *array_shader)
+{
+    render_command_t cmd;
+    uint64_t key;
+    union
+    {
+        float       f;
+        uint32_t    u;
+    }depth_bits;
+
+    depth_bits.f = (depth > 0.0f) ? (depth) : (0.0f);
+    cmd.shader = shader;
+    cmd.shader_type = shader_type;
+    cmd.object = object;
+    cmd.mesh = mesh;
+    cmd.skin = skin;
+
+    if(mesh->animated_vertex_count)
+    {
+        cmd.pass = RENDER_PASS_ANIMATED_TEXTURE;
+        cmd.face = NULL;
+        key  = ((uint64_t)cmd.pass << 60) | ((uint64_t)(shader->program & 0x0FFF) << 48);
+        key |= depth_bits.u;
+        this->AddCommand(&cmd, key);
+    }
+
+    if(mesh->vertex_count == 0)
+    {
+        return;
+    }
+
+    cmd.pass = RENDER_PASS_OPAQUE;
+    cmd.face = mesh->faces;
+    for(uint32_t i = 0; i < mesh->faces_count; i++, cmd.face++)
+    {
+        cmd.shader = ((cmd.face->texture_target == GL_TEXTURE_2D_ARRAY) && array_shader) ? (array_shader) : (shader);
+        key  = ((uint64_t)cmd.pass << 60) | ((uint64_t)(cmd.shader->program & 0x0FFF) << 48);
+        key |= ((uint64_t)(cmd.face->texture_index & 0xFFFF) << 32) | depth_bits.u;
+        this->AddCommand(&cmd, key);
+    }
+}
+
+/**
+ * LSD radix sort by 8 bit digits; digits with the same value for all
+ * commands (typically pass and high shader bits) are skipped.
+ */
+void CRenderQueue::Sort()
+{
+    uint32_t histogram[8][256];
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.commands = m_commands_count;
+    m_stats.objects = m_objects_count;
+    m_stats.lights = m_lights_count;
+    m_stats.skin_jobs = m_skin_jobs_count;
+    m_stats.skin_vertices = m_skin_bytes / (2 * 3 * sizeof(GLfloat));
+    this->CountStateChanges(&m_stats.unsorted_program_changes, &m_stats.unsorted_texture_changes,
+                            &m_stats.unsorted_uniform_sets, &m_stats.unsorted_buffer_binds);
+    if(m_commands_count == 0)
+    {
+        return;
+    }
+
+    memset(histogram, 0, sizeof(histogram));
+    for(uint32_t i = 0; i < m_commands_count; i++)
+    {
+        uint64_t key = m_items[i].key;
+        for(int d = 0; d < 8; d++, key >>= 8)
+        {
+            histogram[d][key & 0xFF]++;
+        }
+    }
+
+    for(int d = 0; d < 8; d++)
+    {
+        uint32_t *h = histogram[d];
+        uint32_t offset = 0;
+        int shift = d * 8;
+
+        if(h[(m_items[0].key >> shift) & 0xFF] == m_commands_count)
+        {
+            continue;
+        }
+
+        for(int i = 0; i < 256; i++)
+        {
+            uint32_t count = h[i];
+            h[i] = offset;
+            offset += count;
+        }
+
+        for(uint32_t i = 0; i < m_commands_count; i++)
+        {
+            m_items_tmp[h[(m_items[i].key >> shift) & 0xFF]++] = m_items[i];
+        }
+
+        struct sort_item_s *t = m_items;
+        m_items = m_items_tmp;
+        m_items_tmp = t;
+    }
+
+    this->CountStateChanges(&m_stats.program_changes, &m_stats.texture_changes,
+                            &m_stats.uniform_sets, &m_stats.buffer_binds);
+}
+
+void CRenderQueue::ResetState(render_queue_state_p state)
+{
+    state->shader = NULL;
+    state->mesh = NULL;
+    state->skin = RENDER_NO_SKIN;
+    state->texture = 0;
+    state->programs_count = 0;
+}
+
+/**
+ * Updates submission state by command and returns the state changes to apply
+ */
+uint32_t CRenderQueue::NextState(render_queue_state_p state, const render_command_t *cmd)
+{
+    uint32_t ret = 0x00;
+    uint32_t lights = m_objects[cmd->object].lights;
+    uint32_t program_index = RENDER_QUEUE_MAX_PROGRAMS;
+
+    for(uint32_t i = 0; i < state->programs_count; i++)
+    {
+        if(state->programs[i].shader == cmd->shader)
+        {
+            program_index = i;
+            break;
+        }
+    }
+
+    if(state->shader != cmd->shader)
+    {
+        ret |= RENDER_STATE_PROGRAM;
+        state->shader = cmd->shader;
+        if(program_index == RENDER_QUEUE_MAX_PROGRAMS)
+        {
+            ret |= RENDER_STATE_PROGRAM_SETUP;
+            if(state->programs_count < RENDER_QUEUE_MAX_PROGRAMS)
+            {
+                program_index = state->programs_count++;
+                state->programs[program_index].shader = cmd->shader;
+                state->programs[program_index].object = RENDER_NO_OBJECT;
+                state->programs[program_index].lights = RENDER_NO_LIGHTS;
+                state->programs[program_index].bones = NULL;
+            }
+        }
+    }
+
+    if(program_index < RENDER_QUEUE_MAX_PROGRAMS)
+    {
+        if(state->programs[program_index].object != cmd->object)
+        {
+            const GLfloat *bones = (cmd->shader_type == RENDER_SHADER_LIT) ? (m_objects[cmd->object].bones) : (NULL);
+            if(bones && (state->programs[program_index].bones == bones))
+            {
+                ret |= RENDER_STATE_BONE;                                       // next bone of the same model
+            }
+            else
+            {
+                ret |= RENDER_STATE_OBJECT;
+                state->programs[program_index].bones = bones;
+            }
+            state->programs[program_index].object = cmd->object;
+        }
+        if((cmd->shader_type == RENDER_SHADER_LIT) && (state->programs[program_index].lights != lights))
+        {
+            ret |= RENDER_STATE_LIGHTS;
+            state->programs[program_index].lights = lights;
+        }
+    }
+    else                                                                        // programs table overflow: nothing is cached
+    {
+        ret |= RENDER_STATE_OBJECT;
+        ret |= (cmd->shader_type == RENDER_SHADER_LIT) ? (RENDER_STATE_LIGHTS) : (0x00);
+    }
+
+    if(cmd->face == NULL)
+    {
+        ret |= RENDER_STATE_ANIMATED;                                           // binds own buffers and textures
+        state->mesh = NULL;
+        state->skin = RENDER_NO_SKIN;
+        state->texture = 0;
+        return ret;
+    }
+
+    if((state->mesh != cmd->mesh) || (state->skin != cmd->skin))
+    {
+        ret |= RENDER_STATE_MESH;
+        state->mesh = cmd->mesh;
+        state->skin = cmd->skin;
+    }
+
+    if(state->texture != cmd->face->texture_index)
+    {
+        ret |= RENDER_STATE_TEXTURE;
+        state->texture = cmd->face->texture_index;
+    }
+
+    return ret;
+}
+
+void CRenderQueue::CountStateChanges(uint32_t *programs, uint32_t *textures, uint32_t *uniforms, uint32_t *buffers)
+{
+    render_queue_state_t state;
+
+    *programs = 0;
+    *textures = 0;
+    *uniforms = 0;
+    *buffers = 0;
+    this->ResetState(&state);
+    for(uint32_t i = 0; i < m_commands_count; i++)
+    {
+        uint32_t changes = this->NextState(&state, m_commands + m_items[i].command);
+        *programs += (changes & RENDER_STATE_PROGRAM) ? (1) : (0);
+        *textures += (changes & RENDER_STATE_TEXTURE) ? (1) : (0);
+        *uniforms += (changes & RENDER_STATE_PROGRAM_SETUP) ? (1) : (0);
+        *uniforms += (changes & RENDER_STATE_OBJECT) ? (1) : (0);
+        *uniforms += (changes & RENDER_STATE_BONE) ? (1) : (0);
+        *uniforms += (changes & RENDER_STATE_LIGHTS) ? (1) : (0);
+        *buffers  += (changes & (RENDER_STATE_MESH | RENDER_STATE_ANIMATED)) ? (1) : (0);
+    }
+}
@@ -0,0 +1,177 @@
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "shader_manager.h"
+
+struct base_mesh_s;
+struct mesh_face_s;
+
+#define RENDER_PASS_OPAQUE              (0)
+#define RENDER_PASS_ANIMATED_TEXTURE    (1)                                     // meshes parts with streamed animated tex coords
+
+#define RENDER_SHADER_UNLIT_TINTED      (0)
+#define RENDER_SHADER_LIT               (1)
+
+#define RENDER_NO_OBJECT                (0xFFFFFFFF)
+#define RENDER_NO_LIGHTS                (0xFFFFFFFF)
+#define RENDER_NO_SKIN                  (0xFFFFFFFF)
+#define RENDER_QUEUE_MAX_PROGRAMS       (32)
+
+/*
+ * submission state changes, returned by CRenderQueue::NextState
+ */
+#define RENDER_STATE_PROGRAM            (0x0001)                                // glUseProgram
+#define RENDER_STATE_PROGRAM_SETUP      (0x0002)                                // first program usage in frame: sampler, tick
+#define RENDER_STATE_OBJECT             (0x0004)                                // object matrices / tint
+#define RENDER_STATE_LIGHTS             (0x0008)                                // lit shader light uniforms
+#define RENDER_STATE_MESH               (0x0010)                                // vertex buffer and pointers
+#define RENDER_STATE_TEXTURE            (0x0020)
+#define RENDER_STATE_ANIMATED           (0x0040)                                // command streams and draws animated faces by itself
+#define RENDER_STATE_BONE               (0x0080)                                // same model palette, bone index only
+
+
+typedef struct render_lights_s
+{
+    uint32_t                            count;
+    GLfloat                             ambient[4];
+    GLfloat                             positions[3 * MAX_NUM_LIGHTS];
+    GLfloat                             colors[4 * MAX_NUM_LIGHTS];
+    GLfloat                             inner_radiuses[MAX_NUM_LIGHTS];
+    GLfloat                             outer_radiuses[MAX_NUM_LIGHTS];
+}render_lights_t, *render_lights_p;
+
+typedef struct render_object_s
+{
+    GLfloat                             mvp[16];
+    GLfloat                             mv[16];                                 // lit shaders only
+    GLfloat                             tint[4];                                // unlit tinted shaders only
+    uint32_t                            lights;                                 // lights setup index or RENDER_NO_LIGHTS
+    const GLfloat                      *bones;                                  // lit shaders: model bones palette, NULL is identity
+    uint16_t                            bones_count;
+    uint16_t                            bone;                                   // palette index of object mesh
+}render_object_t, *render_object_p;
+
+typedef struct render_command_s
+{
+    const struct shader_description    *shader;
+    uint16_t                            shader_type;
+    uint16_t                            pass;
+    uint32_t                            object;
+    struct base_mesh_s                 *mesh;
+    struct mesh_face_s                 *face;                                   // NULL in animated texture pass
+    uint32_t                            skin;                                   // skin job index or RENDER_NO_SKIN
+}render_command_t, *render_command_p;
+
+typedef struct render_skin_job_s
+{
+    struct base_mesh_s                 *mesh;
+    struct base_mesh_s                 *parent_mesh;
+    const uint32_t                     *map;                                    // mesh vertex -> parent vertex, 0xFFFFFFFF if not skinned
+    GLfloat                             transform[16];
+    size_t                              offset;                                 // in skin buffer, bytes: vertices then normals
+}render_skin_job_t, *render_skin_job_p;
+
+typedef struct render_queue_state_s
+{
+    const struct shader_description    *shader;
+    struct base_mesh_s                 *mesh;
+    uint32_t                            skin;
+    GLuint                              texture;
+    uint32_t                            programs_count;
+    struct
+    {
+        const struct shader_description *shader;
+        uint32_t                        object;
+        uint32_t                        lights;
+        const GLfloat                  *bones;                                  // uploaded palette
+    }                                   programs[RENDER_QUEUE_MAX_PROGRAMS];    // uniforms are kept by program objects
+}render_queue_state_t, *render_queue_state_p;
+
+typedef struct render_queue_stats_s
+{
+    uint32_t                            commands;
+    uint32_t                            objects;
+    uint32_t                            lights;
+    uint32_t                            skin_jobs;
+    uint32_t                            skin_vertices;
+    uint32_t                            program_changes;                        // state changes in sorted order
+    uint32_t                            texture_changes;
+    uint32_t                            uniform_sets;
+    uint32_t                            buffer_binds;
+    uint32_t                            unsorted_program_changes;               // state changes in generation order
+    uint32_t                            unsorted_texture_changes;
+    uint32_t                            unsorted_uniform_sets;
+    uint32_t                            unsorted_buffer_binds;
+}render_queue_stats_t, *render_queue_stats_p;
+
+/*
+ * Render queue: the frame draw calls are collected as commands with 64 bit
+ * sort key (pass, shader, texture, depth), radix sorted and submitted in
+ * that order, so program, texture and uniform changes are issued only once
+ * per group.
+ */
+class CRenderQueue
+{
+public:
+    CRenderQueue(uint32_t commands_size);
+   ~CRenderQueue();
+
+    void Reset();
+    uint32_t AddLights(render_lights_p *lights);                                // returns index, *lights points to setup to fill
+    uint32_t AddObject(const GLfloat mvp[16], const GLfloat mv[16], const GLfloat tint[4], uint32_t lights,
+                       const GLfloat *bones = NULL, uint16_t bones_count = 0, uint16_t bone = 0);    // bones palette must live until submission
+    uint32_t AddSkinJob(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, const uint32_t *map, const GLfloat transform[16]);
+    void AddMesh(const struct shader_description *shader, uint16_t shader_type, uint32_t object, struct base_mesh_s *mesh,
+                 uint32_t skin, float depth, const struct shader_description *array_shader = NULL);    // array shader for GL_TEXTURE_2D_ARRAY faces
+    void Sort();
+
+    uint32_t GetCommandsCount() const {return m_commands_count;}
+    const render_command_t *GetCommand(uint32_t i) const {return m_commands + m_items[i].command;}    // in sorted order
+    const render_object_t *GetObject(uint32_t i) const {return m_objects + i;}
+    const render_lights_t *GetLights(uint32_t i) const {return m_lights + i;}
+    uint32_t GetSkinJobsCount() const {return m_skin_jobs_count;}
+    const render_skin_job_t *GetSkinJob(uint32_t i) const {return m_skin_jobs + i;}
+    size_t GetSkinBytes() const {return m_skin_bytes;}                         // skin buffer size for all jobs
+    const render_queue_stats_t *GetStats() const {return &m_stats;}         // last sorted queue
+
+    void ResetState(render_queue_state_p state);
+    uint32_t NextState(render_queue_state_p state, const render_command_t *cmd);
+
+private:
+    struct sort_item_s
+    {
+        uint64_t        key;
+        uint32_t        command;
+    };
+
+    void AddCommand(const render_command_t *cmd, uint64_t key);
+    void CountStateChanges(uint32_t *programs, uint32_t *textures, uint32_t *uniforms, uint32_t *buffers);
+
+    uint32_t                    m_commands_size;
+    uint32_t                    m_commands_count;
+    render_command_t           *m_commands;
+    struct sort_item_s         *m_items;
+    struct sort_item_s         *m_items_tmp;
+
+    uint32_t                    m_objects_size;
+    uint32_t                    m_objects_count;
+    render_object_t            *m_objects;
+
+    uint32_t                    m_lights_size;
+    uint32_t                    m_lights_count;
+    render_lights_t            *m_lights;
+
+    uint32_t                    m_skin_jobs_size;
+    uint32_t                    m_skin_jobs_count;
+    render_skin_job_t          *m_skin_jobs;
+    size_t                      m_skin_bytes;
+
+    render_queue_stats_t        m_stats;
+};
+
+#endif
@@ -59,6 +59,8 @@ lit_shader_description::lit_shader_description(const shader_stage &vertex, const
 : unlit_shader_description(vertex, fragment)
 {
     model_view = qglGetUniformLocationARB(program, "modelView");
+    bones = qglGetUniformLocationARB(program, "bones");
+    bone_index = qglGetUniformLocationARB(program, "bone_index");
     number_of_lights = qglGetUniformLocationARB(program, "number_of_lights");
     light_position = qglGetUniformLocationARB(program, "light_position");
     light_color = qglGetUniformLocationARB(program, "light_color");
@@ -73,3 +75,10 @@ unlit_tinted_shader_description::unlit_tinted_shader_description(const shader_st
     current_tick = qglGetUniformLocationARB(program, "fCurrentTick");
     tint_mult = qglGetUniformLocationARB(program, "tintMult");
 }
+
+sprite_shader_description::sprite_shader_description(const shader_stage &vertex, const shader_stage &fragment)
+: unlit_shader_description(vertex, fragment)
+{
+    camera_right = qglGetUniformLocationARB(program, "cameraRight");
+    camera_up = qglGetUniformLocationARB(program, "cameraUp");
+}
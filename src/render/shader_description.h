@@ -58,6 +58,8 @@ struct unlit_shader_description : public shader_description
 struct lit_shader_description : public unlit_shader_description
 {
     GLint model_view;
+    GLint bones;
+    GLint bone_index;
     GLint number_of_lights;
     GLint light_position;
     GLint light_color;
@@ -76,4 +78,16 @@ struct unlit_tinted_shader_description : public unlit_shader_description
     unlit_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment);
 };
 
+/*!
+ * A shader description for camera facing sprites: quad corners are moved
+ * along camera right and up axes in the vertex shader.
+ */
+struct sprite_shader_description : public unlit_shader_description
+{
+    GLint camera_right;
+    GLint camera_up;
+    
+    sprite_shader_description(const shader_stage &vertex, const shader_stage &fragment);
+};
+
 #endif /* defined(__OpenTomb__shader_description__) */
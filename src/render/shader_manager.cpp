@@ -1,29 +1,42 @@
 #include <cassert>
+#include <cstring>
 #include <sstream>
 
 #include "shader_manager.h"
 
-shader_manager::shader_manager()
+shader_manager::shader_manager(bool textureArray)
 {
     //Color mult prog
     static_mesh_shader = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh"), shader_stage(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh"));
 
-    //Room prog
-    shader_stage roomFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/room.fsh");
-    for (int isWater = 0; isWater < 2; isWater++)
+    //Sprite prog
+    sprite_shader = new sprite_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/sprite.vsh"), shader_stage(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh"));
+
+    //Room prog; texture array variants are built only if they are used
+    memset(room_shaders, 0, sizeof(room_shaders));
+    for (int isArray = 0; isArray < (textureArray ? 2 : 1); isArray++)
     {
-        for (int isFlicker = 0; isFlicker < 2; isFlicker++)
+        std::ostringstream arrayStream;
+        arrayStream << "#define TEXTURE_ARRAY " << isArray << std::endl;
+        shader_stage roomFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/room.fsh", arrayStream.str().c_str());
+        for (int isWater = 0; isWater < 2; isWater++)
         {
-            std::ostringstream stream;
-            stream << "#define IS_WATER " << isWater << std::endl;
-            stream << "#define IS_FLICKER " << isFlicker << std::endl;
+            for (int isFlicker = 0; isFlicker < 2; isFlicker++)
+            {
+                std::ostringstream stream;
+                stream << "#define IS_WATER " << isWater << std::endl;
+                stream << "#define IS_FLICKER " << isFlicker << std::endl;
+                stream << "#define TEXTURE_ARRAY " << isArray << std::endl;
 
-            room_shaders[isWater][isFlicker] = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/room.vsh", stream.str().c_str()), roomFragmentShader);
+                room_shaders[isArray][isWater][isFlicker] = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/room.vsh", stream.str().c_str()), roomFragmentShader);
+            }
         }
     }
 
     // Entity prog
-    shader_stage entityVertexShader(GL_VERTEX_SHADER_ARB, "shaders/entity.vsh");
+    std::ostringstream bonesStream;
+    bonesStream << "#define NUMBER_OF_BONES " << MAX_NUM_BONES << std::endl;
+    shader_stage entityVertexShader(GL_VERTEX_SHADER_ARB, "shaders/entity.vsh", bonesStream.str().c_str());
     for (int i = 0; i <= MAX_NUM_LIGHTS; i++) {
         std::ostringstream stream;
         stream << "#define NUMBER_OF_LIGHTS " << i << std::endl;
@@ -45,7 +58,7 @@ const lit_shader_description *shader_manager::getEntityShader(unsigned numberOfL
     return entity_shader[numberOfLights];
 }
 
-const unlit_tinted_shader_description *shader_manager::getRoomShader(bool isFlickering, bool isWater) const
+const unlit_tinted_shader_description *shader_manager::getRoomShader(bool isFlickering, bool isWater, bool isTextureArray) const
 {
-    return room_shaders[isWater ? 1 : 0][isFlickering ? 1 : 0];
+    return room_shaders[isTextureArray ? 1 : 0][isWater ? 1 : 0][isFlickering ? 1 : 0];
 }
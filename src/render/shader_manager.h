@@ -5,22 +5,31 @@
 
 // Highest number of lights that will show up in the entity shader.
 #define MAX_NUM_LIGHTS 8
+// Highest number of bones in entity shader palette; bigger models are drawn
+// with one palette entry per bone. 24 matrices fit the GL 2.0 minimum of
+// vertex uniforms together with the model matrices.
+#define MAX_NUM_BONES 24
 
 class shader_manager {
-    unlit_tinted_shader_description *room_shaders[2][2];
+    unlit_tinted_shader_description *room_shaders[2][2][2];                   // [texture array][water][flicker]
     unlit_tinted_shader_description *static_mesh_shader;
+    sprite_shader_description *sprite_shader;
     lit_shader_description *entity_shader[MAX_NUM_LIGHTS+1];
     text_shader_description *text;
 
 public:
-    shader_manager();
+    shader_manager(bool textureArray = false);
     ~shader_manager();
     
     const lit_shader_description *getEntityShader(unsigned numberOfLights) const;
     
     const unlit_tinted_shader_description *getStaticMeshShader() const { return static_mesh_shader; }
+
+    const sprite_shader_description *getSpriteShader() const { return sprite_shader; }
     
-    const unlit_tinted_shader_description *getRoomShader(bool isFlickering, bool isWater) const;
+    const unlit_tinted_shader_description *getRoomShader(bool isFlickering, bool isWater, bool isTextureArray = false) const;
+
+    bool hasTextureArray() const { return room_shaders[1][0][0] != NULL; }
     
     const text_shader_description *getTextShader() const { return text; }
 };
@@ -0,0 +1,209 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "../core/gl_util.h"
+#include "../core/vmath.h"
+#include "../core/polygon.h"
+#include "bsp_tree.h"
+#include "transparency_batches.h"
+
+
+static int TransparencyPolygon_Compare(const void *a, const void *b)
+{
+    float da = ((const transparency_polygon_t*)a)->dist;
+    float db = ((const transparency_polygon_t*)b)->dist;
+    return (da < db) ? (1) : ((da > db) ? (-1) : (0));                          // far first
+}
+
+static int TransparencyBatch_Compare(const void *a, const void *b)
+{
+    float da = ((const transparency_batch_t*)a)->dist;
+    float db = ((const transparency_batch_t*)b)->dist;
+    return (da < db) ? (1) : ((da > db) ? (-1) : (0));
+}
+
+
+CTransparencyBatches::CTransparencyBatches(uint32_t vertices_size):
+m_vbo(0),
+m_anim_seq(NULL),
+m_vertices_size(vertices_size),
+m_vertices_count(0),
+m_polygons_size(vertices_size / 4),
+m_polygons_count(0),
+m_batches_size(64),
+m_batches_count(0)
+{
+    m_vertices = (vertex_p)malloc(m_vertices_size * sizeof(vertex_t));
+    m_polygons = (transparency_polygon_p)malloc(m_polygons_size * sizeof(transparency_polygon_t));
+    m_batches  = (transparency_batch_p)malloc(m_batches_size * sizeof(transparency_batch_t));
+    vec3_set_zero(m_camera_pos);
+}
+
+CTransparencyBatches::~CTransparencyBatches()
+{
+    if(m_vbo != 0)
+    {
+        qglDeleteBuffersARB(1, &m_vbo);
+        m_vbo = 0;
+    }
+
+    free(m_vertices);
+    m_vertices = NULL;
+    free(m_polygons);
+    m_polygons = NULL;
+    free(m_batches);
+    m_batches = NULL;
+    m_vertices_size = 0;
+    m_vertices_count = 0;
+    m_polygons_size = 0;
+    m_polygons_count = 0;
+    m_batches_size = 0;
+    m_batches_count = 0;
+    m_anim_seq = NULL;
+}
+
+void CTransparencyBatches::Reset(struct anim_seq_s *seq, const float camera_pos[3])
+{
+    m_anim_seq = seq;
+    vec3_copy(m_camera_pos, camera_pos);
+    m_vertices_count = 0;
+    m_polygons_count = 0;
+    m_batches_count = 0;
+}
+
+struct vertex_s *CTransparencyBatches::AllocVertices(uint32_t count)
+{
+    if(m_vertices_count + count > m_vertices_size)
+    {
+        while(m_vertices_count + count > m_vertices_size)
+        {
+            m_vertices_size *= 2;
+        }
+        m_vertices = (vertex_p)realloc(m_vertices, m_vertices_size * sizeof(vertex_t));
+    }
+
+    vertex_p ret = m_vertices + m_vertices_count;
+    m_vertices_count += count;
+    return ret;
+}
+
+transparency_polygon_p CTransparencyBatches::AllocPolygon()
+{
+    if(m_polygons_count >= m_polygons_size)
+    {
+        m_polygons_size *= 2;
+        m_polygons = (transparency_polygon_p)realloc(m_polygons, m_polygons_size * sizeof(transparency_polygon_t));
+    }
+    return m_polygons + m_polygons_count++;
+}
+
+transparency_batch_p CTransparencyBatches::AllocBatch()
+{
+    if(m_batches_count >= m_batches_size)
+    {
+        m_batches_size *= 2;
+        m_batches = (transparency_batch_p)realloc(m_batches, m_batches_size * sizeof(transparency_batch_t));
+    }
+    return m_batches + m_batches_count++;
+}
+
+void CTransparencyBatches::AddBSP(class CDynamicBSP *bsp, const float pos[3])
+{
+    transparency_batch_p batch = this->AllocBatch();
+    batch->dist = vec3_dist_sq(m_camera_pos, pos);
+    batch->bsp = bsp;
+    batch->first_polygon = m_polygons_count;
+    batch->polygons_count = 0;
+}
+
+void CTransparencyBatches::BeginBatch(const float pos[3])
+{
+    transparency_batch_p batch = this->AllocBatch();
+    batch->dist = vec3_dist_sq(m_camera_pos, pos);
+    batch->bsp = NULL;
+    batch->first_polygon = m_polygons_count;
+    batch->polygons_count = 0;
+}
+
+/**
+ * Polygons are transformed to world space and appended to the last batch as
+ * is: nothing is split, sorting order inside batch is by polygons centres.
+ */
+void CTransparencyBatches::AddPolygonList(struct polygon_s *p, const float transform[16], uint16_t filter)
+{
+    if(m_batches_count == 0)
+    {
+        return;
+    }
+
+    transparency_batch_p batch = m_batches + m_batches_count - 1;
+    for( ; p; p = p->next)
+    {
+        if(!(filter & ((p->anim_id > 0) ? (BSP_POLYGONS_ANIMATED) : (BSP_POLYGONS_STATIC))))
+        {
+            continue;
+        }
+
+        uint32_t first_vertex = m_vertices_count;
+        vertex_p dst_v = this->AllocVertices(p->vertex_count);
+        vertex_p src_v = p->vertices;
+        tex_frame_p tf = NULL;
+        float centre[3] = {0.0f, 0.0f, 0.0f};
+        transparency_polygon_p tp = this->AllocPolygon();
+
+        tp->first_vertex = first_vertex;
+        tp->vertex_count = p->vertex_count;
+        tp->transparency = p->transparency;
+        tp->texture_index = p->texture_index;
+        if((p->anim_id > 0) && m_anim_seq)
+        {
+            anim_seq_p seq = m_anim_seq + p->anim_id - 1;
+            uint16_t frame = (seq->current_frame + p->frame_offset) % seq->frames_count;
+            tf = seq->frames + frame;
+            tp->texture_index = tf->texture_index;
+        }
+
+        for(uint16_t i = 0; i < p->vertex_count; i++, src_v++, dst_v++)
+        {
+            Mat4_vec3_mul_macro(dst_v->position, transform, src_v->position);
+            Mat4_vec3_rot_macro(dst_v->normal, transform, src_v->normal);
+            vec4_copy(dst_v->color, src_v->color);
+            if(tf)
+            {
+                ApplyAnimTextureTransformation(dst_v->tex_coord, src_v->tex_coord, tf);
+            }
+            else
+            {
+                dst_v->tex_coord[0] = src_v->tex_coord[0];
+                dst_v->tex_coord[1] = src_v->tex_coord[1];
+            }
+            dst_v->tex_page = src_v->tex_page;
+            vec3_add(centre, centre, dst_v->position);
+        }
+        vec3_mul_scalar(centre, centre, 1.0f / (float)p->vertex_count);
+        tp->dist = vec3_dist_sq(m_camera_pos, centre);
+        batch->polygons_count++;
+    }
+}
+
+void CTransparencyBatches::Sort()
+{
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < m_batches_count; i++)
+    {
+        if((m_batches[i].bsp == NULL) && (m_batches[i].polygons_count == 0))
+        {
+            continue;                                                           // object without visible transparency
+        }
+        if(m_batches[i].polygons_count > 1)
+        {
+            qsort(m_polygons + m_batches[i].first_polygon, m_batches[i].polygons_count, sizeof(transparency_polygon_t), TransparencyPolygon_Compare);
+        }
+        m_batches[count++] = m_batches[i];
+    }
+    m_batches_count = count;
+    qsort(m_batches, m_batches_count, sizeof(transparency_batch_t), TransparencyBatch_Compare);
+}
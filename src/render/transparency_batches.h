@@ -0,0 +1,79 @@
+
+#ifndef TRANSPARENCY_BATCHES_H
+#define TRANSPARENCY_BATCHES_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+struct polygon_s;
+struct vertex_s;
+struct anim_seq_s;
+class CDynamicBSP;
+
+typedef struct transparency_polygon_s
+{
+    float                   dist;                                               // sort key, squared camera distance of centre
+    uint32_t                first_vertex;                                       // triangle fan in batches vertex buffer
+    uint16_t                vertex_count;
+    uint16_t                transparency;
+    GLuint                  texture_index;
+}transparency_polygon_t, *transparency_polygon_p;
+
+typedef struct transparency_batch_s
+{
+    float                   dist;                                               // sort key, squared camera distance of object
+    class CDynamicBSP      *bsp;                                                // prebuilt room BSP or NULL
+    uint32_t                first_polygon;
+    uint32_t                polygons_count;
+}transparency_batch_t, *transparency_batch_p;
+
+/*
+ * Per frame transparency without polygons splitting: every object adds its
+ * transparent polygons as one batch, batches and polygons inside batches are
+ * sorted back to front by distance. Rooms static transparency is drawn from
+ * prebuilt per room BSPs, added as batches with bsp != NULL.
+ */
+class CTransparencyBatches
+{
+public:
+    CTransparencyBatches(uint32_t vertices_size);
+   ~CTransparencyBatches();
+
+    void Reset(struct anim_seq_s *seq, const float camera_pos[3]);
+    void AddBSP(class CDynamicBSP *bsp, const float pos[3]);
+    void BeginBatch(const float pos[3]);                                        // next polygon lists go to new object batch
+    void AddPolygonList(struct polygon_s *p, const float transform[16], uint16_t filter);    // filter: BSP_POLYGONS_*
+    void Sort();
+
+    uint32_t GetBatchesCount() const {return m_batches_count;}
+    const transparency_batch_t *GetBatch(uint32_t i) const {return m_batches + i;}
+    const transparency_polygon_t *GetPolygon(uint32_t i) const {return m_polygons + i;}
+    struct vertex_s *GetVertexArray() {return m_vertices;}
+    uint32_t GetActiveVertexCount() const {return m_vertices_count;}
+    uint32_t GetPolygonsCount() const {return m_polygons_count;}
+
+    GLuint m_vbo;
+
+private:
+    struct vertex_s        *AllocVertices(uint32_t count);
+    transparency_polygon_p  AllocPolygon();
+    transparency_batch_p    AllocBatch();
+
+    struct anim_seq_s      *m_anim_seq;
+    float                   m_camera_pos[3];
+
+    uint32_t                m_vertices_size;
+    uint32_t                m_vertices_count;
+    struct vertex_s        *m_vertices;
+
+    uint32_t                m_polygons_size;
+    uint32_t                m_polygons_count;
+    transparency_polygon_t *m_polygons;
+
+    uint32_t                m_batches_size;
+    uint32_t                m_batches_count;
+    transparency_batch_t   *m_batches;
+};
+
+#endif
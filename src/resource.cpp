@@ -214,15 +214,15 @@ bool Res_Sector_Is2SidePortals(struct room_sector_s *s1, struct room_sector_s *s
 
 bool Res_Sector_IsWall(struct room_sector_s *wall_sector, struct room_sector_s *near_sector)
 {
-    if(!wall_sector->portal_to_room && !near_sector->portal_to_room && (wall_sector->floor_penetration_config == TR_PENETRATION_CONFIG_WALL))
+    if(!wall_sector->portal_to_room && !near_sector->portal_to_room && (wall_sector->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_WALL))
     {
         return true;
     }
 
-    if(!near_sector->portal_to_room && wall_sector->portal_to_room && (near_sector->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
+    if(!near_sector->portal_to_room && wall_sector->portal_to_room && (near_sector->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
     {
         wall_sector = Room_GetSectorRaw(wall_sector->portal_to_room->real_room, wall_sector->pos);
-        if((wall_sector->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) || (!Res_Sector_Is2SidePortals(near_sector, wall_sector)))
+        if((wall_sector->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) || (!Res_Sector_Is2SidePortals(near_sector, wall_sector)))
         {
             return true;
         }
@@ -252,42 +252,42 @@ bool Res_Sector_IsTweenAlterable(struct room_sector_s *s1, struct room_sector_s
 void Res_Sector_GenXTween(sector_tween_s *room_tween, room_sector_p current_heightmap, room_sector_p next_heightmap)
 {
     /* XY corners coordinates must be calculated from native room sector */
-    room_tween->floor_corners[0][1] = current_heightmap->floor_corners[0][1];
+    room_tween->floor_corners[0][1] = current_heightmap->geometry->floor_corners[0][1];
     room_tween->floor_corners[1][1] = room_tween->floor_corners[0][1];
     room_tween->floor_corners[2][1] = room_tween->floor_corners[0][1];
     room_tween->floor_corners[3][1] = room_tween->floor_corners[0][1];
-    room_tween->floor_corners[0][0] = current_heightmap->floor_corners[0][0];
+    room_tween->floor_corners[0][0] = current_heightmap->geometry->floor_corners[0][0];
     room_tween->floor_corners[1][0] = room_tween->floor_corners[0][0];
-    room_tween->floor_corners[2][0] = current_heightmap->floor_corners[1][0];
+    room_tween->floor_corners[2][0] = current_heightmap->geometry->floor_corners[1][0];
     room_tween->floor_corners[3][0] = room_tween->floor_corners[2][0];
 
-    room_tween->ceiling_corners[0][1] = current_heightmap->ceiling_corners[0][1];
+    room_tween->ceiling_corners[0][1] = current_heightmap->geometry->ceiling_corners[0][1];
     room_tween->ceiling_corners[1][1] = room_tween->ceiling_corners[0][1];
     room_tween->ceiling_corners[2][1] = room_tween->ceiling_corners[0][1];
     room_tween->ceiling_corners[3][1] = room_tween->ceiling_corners[0][1];
-    room_tween->ceiling_corners[0][0] = current_heightmap->ceiling_corners[0][0];
+    room_tween->ceiling_corners[0][0] = current_heightmap->geometry->ceiling_corners[0][0];
     room_tween->ceiling_corners[1][0] = room_tween->ceiling_corners[0][0];
-    room_tween->ceiling_corners[2][0] = current_heightmap->ceiling_corners[1][0];
+    room_tween->ceiling_corners[2][0] = current_heightmap->geometry->ceiling_corners[1][0];
     room_tween->ceiling_corners[3][0] = room_tween->ceiling_corners[2][0];
 
-    if((next_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) || (current_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))                                                           // Init X-plane tween [ | ]
+    if((next_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) || (current_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))                                                           // Init X-plane tween [ | ]
     {
         if(Res_Sector_IsWall(next_heightmap, current_heightmap))
         {
-            room_tween->floor_corners[0][2] = current_heightmap->floor_corners[0][2];
-            room_tween->floor_corners[1][2] = current_heightmap->ceiling_corners[0][2];
-            room_tween->floor_corners[2][2] = current_heightmap->ceiling_corners[1][2];
-            room_tween->floor_corners[3][2] = current_heightmap->floor_corners[1][2];
+            room_tween->floor_corners[0][2] = current_heightmap->geometry->floor_corners[0][2];
+            room_tween->floor_corners[1][2] = current_heightmap->geometry->ceiling_corners[0][2];
+            room_tween->floor_corners[2][2] = current_heightmap->geometry->ceiling_corners[1][2];
+            room_tween->floor_corners[3][2] = current_heightmap->geometry->floor_corners[1][2];
             Res_Sector_SetTweenFloorConfig(room_tween);
             room_tween->floor_tween_inverted = 0x01;
             room_tween->ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
         }
         else if(Res_Sector_IsWall(current_heightmap, next_heightmap))
         {
-            room_tween->floor_corners[0][2] = next_heightmap->floor_corners[3][2];
-            room_tween->floor_corners[1][2] = next_heightmap->ceiling_corners[3][2];
-            room_tween->floor_corners[2][2] = next_heightmap->ceiling_corners[2][2];
-            room_tween->floor_corners[3][2] = next_heightmap->floor_corners[2][2];
+            room_tween->floor_corners[0][2] = next_heightmap->geometry->floor_corners[3][2];
+            room_tween->floor_corners[1][2] = next_heightmap->geometry->ceiling_corners[3][2];
+            room_tween->floor_corners[2][2] = next_heightmap->geometry->ceiling_corners[2][2];
+            room_tween->floor_corners[3][2] = next_heightmap->geometry->floor_corners[2][2];
             Res_Sector_SetTweenFloorConfig(room_tween);
             room_tween->ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
         }
@@ -298,23 +298,23 @@ void Res_Sector_GenXTween(sector_tween_s *room_tween, room_sector_p current_heig
             {
                 current_heightmap = Res_Sector_GetPortalSectorTarget(current_heightmap);
                 next_heightmap    = Res_Sector_GetPortalSectorTarget(next_heightmap);
-                if(!current_heightmap->portal_to_room && !next_heightmap->portal_to_room && (current_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) && (next_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
+                if(!current_heightmap->portal_to_room && !next_heightmap->portal_to_room && (current_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) && (next_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
                 {
-                    if((current_heightmap->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID))
+                    if((current_heightmap->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID))
                     {
-                        room_tween->floor_corners[0][2] = current_heightmap->floor_corners[0][2];
-                        room_tween->floor_corners[1][2] = next_heightmap->floor_corners[3][2];
-                        room_tween->floor_corners[2][2] = next_heightmap->floor_corners[2][2];
-                        room_tween->floor_corners[3][2] = current_heightmap->floor_corners[1][2];
+                        room_tween->floor_corners[0][2] = current_heightmap->geometry->floor_corners[0][2];
+                        room_tween->floor_corners[1][2] = next_heightmap->geometry->floor_corners[3][2];
+                        room_tween->floor_corners[2][2] = next_heightmap->geometry->floor_corners[2][2];
+                        room_tween->floor_corners[3][2] = current_heightmap->geometry->floor_corners[1][2];
                         Res_Sector_SetTweenFloorConfig(room_tween);
                         room_tween->floor_tween_inverted = 0x01;
                     }
-                    if((current_heightmap->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID))
+                    if((current_heightmap->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID))
                     {
-                        room_tween->ceiling_corners[0][2] = current_heightmap->ceiling_corners[0][2];
-                        room_tween->ceiling_corners[1][2] = next_heightmap->ceiling_corners[3][2];
-                        room_tween->ceiling_corners[2][2] = next_heightmap->ceiling_corners[2][2];
-                        room_tween->ceiling_corners[3][2] = current_heightmap->ceiling_corners[1][2];
+                        room_tween->ceiling_corners[0][2] = current_heightmap->geometry->ceiling_corners[0][2];
+                        room_tween->ceiling_corners[1][2] = next_heightmap->geometry->ceiling_corners[3][2];
+                        room_tween->ceiling_corners[2][2] = next_heightmap->geometry->ceiling_corners[2][2];
+                        room_tween->ceiling_corners[3][2] = current_heightmap->geometry->ceiling_corners[1][2];
                         Res_Sector_SetTweenCeilingConfig(room_tween);
                     }
                 }
@@ -326,43 +326,43 @@ void Res_Sector_GenXTween(sector_tween_s *room_tween, room_sector_p current_heig
 
 void Res_Sector_GenYTween(sector_tween_s *room_tween, room_sector_p current_heightmap, room_sector_p next_heightmap)
 {
-    room_tween->floor_corners[0][0] = current_heightmap->floor_corners[1][0];
+    room_tween->floor_corners[0][0] = current_heightmap->geometry->floor_corners[1][0];
     room_tween->floor_corners[1][0] = room_tween->floor_corners[0][0];
     room_tween->floor_corners[2][0] = room_tween->floor_corners[0][0];
     room_tween->floor_corners[3][0] = room_tween->floor_corners[0][0];
-    room_tween->floor_corners[0][1] = current_heightmap->floor_corners[1][1];
+    room_tween->floor_corners[0][1] = current_heightmap->geometry->floor_corners[1][1];
     room_tween->floor_corners[1][1] = room_tween->floor_corners[0][1];
-    room_tween->floor_corners[2][1] = current_heightmap->floor_corners[2][1];
+    room_tween->floor_corners[2][1] = current_heightmap->geometry->floor_corners[2][1];
     room_tween->floor_corners[3][1] = room_tween->floor_corners[2][1];
 
-    room_tween->ceiling_corners[0][0] = current_heightmap->ceiling_corners[1][0];
+    room_tween->ceiling_corners[0][0] = current_heightmap->geometry->ceiling_corners[1][0];
     room_tween->ceiling_corners[1][0] = room_tween->ceiling_corners[0][0];
     room_tween->ceiling_corners[2][0] = room_tween->ceiling_corners[0][0];
     room_tween->ceiling_corners[3][0] = room_tween->ceiling_corners[0][0];
-    room_tween->ceiling_corners[0][1] = current_heightmap->ceiling_corners[1][1];
+    room_tween->ceiling_corners[0][1] = current_heightmap->geometry->ceiling_corners[1][1];
     room_tween->ceiling_corners[1][1] = room_tween->ceiling_corners[0][1];
-    room_tween->ceiling_corners[2][1] = current_heightmap->ceiling_corners[2][1];
+    room_tween->ceiling_corners[2][1] = current_heightmap->geometry->ceiling_corners[2][1];
     room_tween->ceiling_corners[3][1] = room_tween->ceiling_corners[2][1];
 
-    if((next_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) || (current_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
+    if((next_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) || (current_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
     {
         // Init Y-plane tween  [ - ]
         if(Res_Sector_IsWall(next_heightmap, current_heightmap))
         {
-            room_tween->floor_corners[0][2] = current_heightmap->floor_corners[1][2];
-            room_tween->floor_corners[1][2] = current_heightmap->ceiling_corners[1][2];
-            room_tween->floor_corners[2][2] = current_heightmap->ceiling_corners[2][2];
-            room_tween->floor_corners[3][2] = current_heightmap->floor_corners[2][2];
+            room_tween->floor_corners[0][2] = current_heightmap->geometry->floor_corners[1][2];
+            room_tween->floor_corners[1][2] = current_heightmap->geometry->ceiling_corners[1][2];
+            room_tween->floor_corners[2][2] = current_heightmap->geometry->ceiling_corners[2][2];
+            room_tween->floor_corners[3][2] = current_heightmap->geometry->floor_corners[2][2];
             Res_Sector_SetTweenFloorConfig(room_tween);
             room_tween->floor_tween_inverted = 0x01;
             room_tween->ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
         }
         else if(Res_Sector_IsWall(current_heightmap, next_heightmap))
         {
-            room_tween->floor_corners[0][2] = next_heightmap->floor_corners[0][2];
-            room_tween->floor_corners[1][2] = next_heightmap->ceiling_corners[0][2];
-            room_tween->floor_corners[2][2] = next_heightmap->ceiling_corners[3][2];
-            room_tween->floor_corners[3][2] = next_heightmap->floor_corners[3][2];
+            room_tween->floor_corners[0][2] = next_heightmap->geometry->floor_corners[0][2];
+            room_tween->floor_corners[1][2] = next_heightmap->geometry->ceiling_corners[0][2];
+            room_tween->floor_corners[2][2] = next_heightmap->geometry->ceiling_corners[3][2];
+            room_tween->floor_corners[3][2] = next_heightmap->geometry->floor_corners[3][2];
             Res_Sector_SetTweenFloorConfig(room_tween);
             room_tween->ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
         }
@@ -373,23 +373,23 @@ void Res_Sector_GenYTween(sector_tween_s *room_tween, room_sector_p current_heig
             {
                 current_heightmap = Res_Sector_GetPortalSectorTarget(current_heightmap);
                 next_heightmap    = Res_Sector_GetPortalSectorTarget(next_heightmap);
-                if(!current_heightmap->portal_to_room && !next_heightmap->portal_to_room && (current_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) && (next_heightmap->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
+                if(!current_heightmap->portal_to_room && !next_heightmap->portal_to_room && (current_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL) && (next_heightmap->geometry->floor_penetration_config != TR_PENETRATION_CONFIG_WALL))
                 {
-                    if((current_heightmap->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID))
+                    if((current_heightmap->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_SOLID))
                     {
-                        room_tween->floor_corners[0][2] = current_heightmap->floor_corners[1][2];
-                        room_tween->floor_corners[1][2] = next_heightmap->floor_corners[0][2];
-                        room_tween->floor_corners[2][2] = next_heightmap->floor_corners[3][2];
-                        room_tween->floor_corners[3][2] = current_heightmap->floor_corners[2][2];
+                        room_tween->floor_corners[0][2] = current_heightmap->geometry->floor_corners[1][2];
+                        room_tween->floor_corners[1][2] = next_heightmap->geometry->floor_corners[0][2];
+                        room_tween->floor_corners[2][2] = next_heightmap->geometry->floor_corners[3][2];
+                        room_tween->floor_corners[3][2] = current_heightmap->geometry->floor_corners[2][2];
                         Res_Sector_SetTweenFloorConfig(room_tween);
                         room_tween->floor_tween_inverted = 0x01;
                     }
-                    if((current_heightmap->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID))
+                    if((current_heightmap->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID) || (next_heightmap->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_SOLID))
                     {
-                        room_tween->ceiling_corners[0][2] = current_heightmap->ceiling_corners[1][2];
-                        room_tween->ceiling_corners[1][2] = next_heightmap->ceiling_corners[0][2];
-                        room_tween->ceiling_corners[2][2] = next_heightmap->ceiling_corners[3][2];
-                        room_tween->ceiling_corners[3][2] = current_heightmap->ceiling_corners[2][2];
+                        room_tween->ceiling_corners[0][2] = current_heightmap->geometry->ceiling_corners[1][2];
+                        room_tween->ceiling_corners[1][2] = next_heightmap->geometry->ceiling_corners[0][2];
+                        room_tween->ceiling_corners[2][2] = next_heightmap->geometry->ceiling_corners[3][2];
+                        room_tween->ceiling_corners[3][2] = current_heightmap->geometry->ceiling_corners[2][2];
                         Res_Sector_SetTweenCeilingConfig(room_tween);
                     }
                 }
@@ -703,8 +703,8 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
                     if(*entry < rooms_count)
                     {
                         sector->portal_to_room = rooms + *entry;
-                        sector->floor_penetration_config   = TR_PENETRATION_CONFIG_GHOST;
-                        sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_GHOST;
+                        sector->geometry->floor_penetration_config   = TR_PENETRATION_CONFIG_GHOST;
+                        sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_GHOST;
                     }
                     entry ++;
                     current_offset++;
@@ -717,29 +717,29 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
                     int8_t raw_y_slant =  (*entry & 0x00FF);
                     int8_t raw_x_slant = ((*entry & 0xFF00) >> 8);
 
-                    sector->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
-                    sector->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                    sector->geometry->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
+                    sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
 
                     if(raw_x_slant > 0)
                     {
-                        sector->floor_corners[2][2] -= ((float)raw_x_slant * TR_METERING_STEP);
-                        sector->floor_corners[3][2] -= ((float)raw_x_slant * TR_METERING_STEP);
+                        sector->geometry->floor_corners[2][2] -= ((float)raw_x_slant * TR_METERING_STEP);
+                        sector->geometry->floor_corners[3][2] -= ((float)raw_x_slant * TR_METERING_STEP);
                     }
                     else if(raw_x_slant < 0)
                     {
-                        sector->floor_corners[0][2] -= (fabs((float)raw_x_slant) * TR_METERING_STEP);
-                        sector->floor_corners[1][2] -= (fabs((float)raw_x_slant) * TR_METERING_STEP);
+                        sector->geometry->floor_corners[0][2] -= (fabs((float)raw_x_slant) * TR_METERING_STEP);
+                        sector->geometry->floor_corners[1][2] -= (fabs((float)raw_x_slant) * TR_METERING_STEP);
                     }
 
                     if(raw_y_slant > 0)
                     {
-                        sector->floor_corners[0][2] -= ((float)raw_y_slant * TR_METERING_STEP);
-                        sector->floor_corners[3][2] -= ((float)raw_y_slant * TR_METERING_STEP);
+                        sector->geometry->floor_corners[0][2] -= ((float)raw_y_slant * TR_METERING_STEP);
+                        sector->geometry->floor_corners[3][2] -= ((float)raw_y_slant * TR_METERING_STEP);
                     }
                     else if(raw_y_slant < 0)
                     {
-                        sector->floor_corners[1][2] -= (fabs((float)raw_y_slant) * TR_METERING_STEP);
-                        sector->floor_corners[2][2] -= (fabs((float)raw_y_slant) * TR_METERING_STEP);
+                        sector->geometry->floor_corners[1][2] -= (fabs((float)raw_y_slant) * TR_METERING_STEP);
+                        sector->geometry->floor_corners[2][2] -= (fabs((float)raw_y_slant) * TR_METERING_STEP);
                     }
 
                     entry++;
@@ -753,29 +753,29 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
                     int8_t raw_y_slant =  (*entry & 0x00FF);
                     int8_t raw_x_slant = ((*entry & 0xFF00) >> 8);
 
-                    sector->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
-                    sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                    sector->geometry->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
+                    sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
 
                     if(raw_x_slant > 0)
                     {
-                        sector->ceiling_corners[3][2] += ((float)raw_x_slant * TR_METERING_STEP);
-                        sector->ceiling_corners[2][2] += ((float)raw_x_slant * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[3][2] += ((float)raw_x_slant * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[2][2] += ((float)raw_x_slant * TR_METERING_STEP);
                     }
                     else if(raw_x_slant < 0)
                     {
-                        sector->ceiling_corners[1][2] += (fabs((float)raw_x_slant) * TR_METERING_STEP);
-                        sector->ceiling_corners[0][2] += (fabs((float)raw_x_slant) * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[1][2] += (fabs((float)raw_x_slant) * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[0][2] += (fabs((float)raw_x_slant) * TR_METERING_STEP);
                     }
 
                     if(raw_y_slant > 0)
                     {
-                        sector->ceiling_corners[1][2] += ((float)raw_y_slant * TR_METERING_STEP);
-                        sector->ceiling_corners[2][2] += ((float)raw_y_slant * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[1][2] += ((float)raw_y_slant * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[2][2] += ((float)raw_y_slant * TR_METERING_STEP);
                     }
                     else if(raw_y_slant < 0)
                     {
-                        sector->ceiling_corners[0][2] += (fabs((float)raw_y_slant) * TR_METERING_STEP);
-                        sector->ceiling_corners[3][2] += (fabs((float)raw_y_slant) * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[0][2] += (fabs((float)raw_y_slant) * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[3][2] += (fabs((float)raw_y_slant) * TR_METERING_STEP);
                     }
 
                     entry++;
@@ -796,6 +796,7 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
                         Con_AddLine("SECTOR HAS TWO OR MORE TRIGGERS!!!", FONTSTYLE_CONSOLE_WARNING);
                     }
                     sector->trigger->commands = NULL;
+                    sector->trigger->watch_state = TRIGGER_WATCH_UNKNOWN;
                     sector->trigger->function_value = fd_command.function_value;
                     sector->trigger->sub_function = fd_command.sub_function;
                     sector->trigger->mask = fd_trigger_head.mask;
@@ -925,96 +926,96 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
                         (fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NW_PORTAL_SW) ||
                         (fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NW_PORTAL_NE)  )
                     {
-                        sector->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NW;
+                        sector->geometry->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NW;
 
-                        sector->floor_corners[0][2] -= overall_adjustment - ((float)fd_slope.slope_t12 * TR_METERING_STEP);
-                        sector->floor_corners[1][2] -= overall_adjustment - ((float)fd_slope.slope_t13 * TR_METERING_STEP);
-                        sector->floor_corners[2][2] -= overall_adjustment - ((float)fd_slope.slope_t10 * TR_METERING_STEP);
-                        sector->floor_corners[3][2] -= overall_adjustment - ((float)fd_slope.slope_t11 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[0][2] -= overall_adjustment - ((float)fd_slope.slope_t12 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[1][2] -= overall_adjustment - ((float)fd_slope.slope_t13 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[2][2] -= overall_adjustment - ((float)fd_slope.slope_t10 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[3][2] -= overall_adjustment - ((float)fd_slope.slope_t11 * TR_METERING_STEP);
 
                         if(fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NW_PORTAL_SW)
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
                         }
                         else if(fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NW_PORTAL_NE)
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
                         }
                         else
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
                         }
                     }
                     else if( (fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NE)           ||
                              (fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NE_PORTAL_NW) ||
                              (fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NE_PORTAL_SE)  )
                     {
-                        sector->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NE;
+                        sector->geometry->floor_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NE;
 
-                        sector->floor_corners[0][2] -= overall_adjustment - ((float)fd_slope.slope_t12 * TR_METERING_STEP);
-                        sector->floor_corners[1][2] -= overall_adjustment - ((float)fd_slope.slope_t13 * TR_METERING_STEP);
-                        sector->floor_corners[2][2] -= overall_adjustment - ((float)fd_slope.slope_t10 * TR_METERING_STEP);
-                        sector->floor_corners[3][2] -= overall_adjustment - ((float)fd_slope.slope_t11 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[0][2] -= overall_adjustment - ((float)fd_slope.slope_t12 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[1][2] -= overall_adjustment - ((float)fd_slope.slope_t13 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[2][2] -= overall_adjustment - ((float)fd_slope.slope_t10 * TR_METERING_STEP);
+                        sector->geometry->floor_corners[3][2] -= overall_adjustment - ((float)fd_slope.slope_t11 * TR_METERING_STEP);
 
                         if(fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NE_PORTAL_NW)
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
                         }
                         else if(fd_command.function == TR_FD_FUNC_FLOORTRIANGLE_NE_PORTAL_SE)
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
                         }
                         else
                         {
-                            sector->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                            sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
                         }
                     }
                     else if( (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NW)           ||
                              (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NW_PORTAL_SW) ||
                              (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NW_PORTAL_NE)  )
                     {
-                        sector->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NW;
+                        sector->geometry->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NW;
 
-                        sector->ceiling_corners[0][2] += overall_adjustment - (float)(fd_slope.slope_t11 * TR_METERING_STEP);
-                        sector->ceiling_corners[1][2] += overall_adjustment - (float)(fd_slope.slope_t10 * TR_METERING_STEP);
-                        sector->ceiling_corners[2][2] += overall_adjustment - (float)(fd_slope.slope_t13 * TR_METERING_STEP);
-                        sector->ceiling_corners[3][2] += overall_adjustment - (float)(fd_slope.slope_t12 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[0][2] += overall_adjustment - (float)(fd_slope.slope_t11 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[1][2] += overall_adjustment - (float)(fd_slope.slope_t10 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[2][2] += overall_adjustment - (float)(fd_slope.slope_t13 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[3][2] += overall_adjustment - (float)(fd_slope.slope_t12 * TR_METERING_STEP);
 
                         if(fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NW_PORTAL_SW)
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
                         }
                         else if(fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NW_PORTAL_NE)
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
                         }
                         else
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
                         }
                     }
                     else if( (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NE)           ||
                              (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NE_PORTAL_NW) ||
                              (fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NE_PORTAL_SE)  )
                     {
-                        sector->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NE;
+                        sector->geometry->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NE;
 
-                        sector->ceiling_corners[0][2] += overall_adjustment - (float)(fd_slope.slope_t11 * TR_METERING_STEP);
-                        sector->ceiling_corners[1][2] += overall_adjustment - (float)(fd_slope.slope_t10 * TR_METERING_STEP);
-                        sector->ceiling_corners[2][2] += overall_adjustment - (float)(fd_slope.slope_t13 * TR_METERING_STEP);
-                        sector->ceiling_corners[3][2] += overall_adjustment - (float)(fd_slope.slope_t12 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[0][2] += overall_adjustment - (float)(fd_slope.slope_t11 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[1][2] += overall_adjustment - (float)(fd_slope.slope_t10 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[2][2] += overall_adjustment - (float)(fd_slope.slope_t13 * TR_METERING_STEP);
+                        sector->geometry->ceiling_corners[3][2] += overall_adjustment - (float)(fd_slope.slope_t12 * TR_METERING_STEP);
 
                         if(fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NE_PORTAL_NW)
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_A;
                         }
                         else if(fd_command.function == TR_FD_FUNC_CEILINGTRIANGLE_NE_PORTAL_SE)
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_DOOR_VERTICAL_B;
                         }
                         else
                         {
-                            sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+                            sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
                         }
                     }
                 }
@@ -1030,11 +1031,11 @@ int Res_Sector_TranslateFloorData(struct room_s *rooms, uint32_t rooms_count, st
 
     if(sector->floor == TR_METERING_WALLHEIGHT)
     {
-        sector->floor_penetration_config = TR_PENETRATION_CONFIG_WALL;
+        sector->geometry->floor_penetration_config = TR_PENETRATION_CONFIG_WALL;
     }
     if(sector->ceiling == TR_METERING_WALLHEIGHT)
     {
-        sector->ceiling_penetration_config = TR_PENETRATION_CONFIG_WALL;
+        sector->geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_WALL;
     }
 
     return ret;
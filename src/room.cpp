@@ -77,10 +77,15 @@ void Room_Clear(struct room_s *room)
             room->content->sprites_vertices = NULL;
         }
 
+        if(room->content->sprites_vbo)
+        {
+            qglDeleteBuffersARB(1, &room->content->sprites_vbo);
+            room->content->sprites_vbo = 0;
+        }
+
         if(room->content->lights_count)
         {
-            free(room->content->lights);
-            room->content->lights = NULL;
+            room->content->lights = NULL;                                       // allocated in level arena
             room->content->lights_count = 0;
         }
 
@@ -123,8 +128,7 @@ void Room_Clear(struct room_s *room)
                 s->trigger = NULL;
             }
         }
-        free(room->sectors);
-        room->sectors = NULL;
+        room->sectors = NULL;                                                   // allocated in level arena
         room->sectors_count = 0;
         room->sectors_x = 0;
         room->sectors_y = 0;
@@ -133,14 +137,12 @@ void Room_Clear(struct room_s *room)
     if(room->overlapped_room_list)
     {
         room->overlapped_room_list_size = 0;
-        free(room->overlapped_room_list);
         room->overlapped_room_list = NULL;
     }
 
     if(room->near_room_list)
     {
         room->near_room_list_size = 0;
-        free(room->near_room_list);
         room->near_room_list = NULL;
     }
 
@@ -236,18 +238,24 @@ void Room_Disable(struct room_s *room)
 
 int  Room_AddObject(struct room_s *room, struct engine_container_s *cont)
 {
-    engine_container_p curr = room->content->containers;
+    if(cont->list_room == room)
+    {
+        return 0;
+    }
 
-    for(; curr; curr = curr->next)
+    if(cont->list_room)
     {
-        if(curr == cont)
-        {
-            return 0;
-        }
+        Room_RemoveObject(cont->list_room, cont);
     }
 
     cont->room = room;
+    cont->list_room = room;
+    cont->prev = NULL;
     cont->next = room->content->containers;
+    if(cont->next)
+    {
+        cont->next->prev = cont;
+    }
     room->content->containers = cont;
     return 1;
 }
@@ -255,36 +263,29 @@ int  Room_AddObject(struct room_s *room, struct engine_container_s *cont)
 
 int  Room_RemoveObject(struct room_s *room, struct engine_container_s *cont)
 {
-    engine_container_p previous_cont, current_cont;
-
-    if(!room || !cont || !room->content->containers)
+    if(!room || !cont || (cont->list_room != room))
     {
         return 0;
     }
 
-    if(room->content->containers == cont)
+    if(cont->prev)
+    {
+        cont->prev->next = cont->next;
+    }
+    else
     {
         room->content->containers = cont->next;
-        cont->room = NULL;
-        return 1;
     }
-
-    previous_cont = room->content->containers;
-    current_cont = previous_cont->next;
-    while(current_cont)
+    if(cont->next)
     {
-        if(current_cont == cont)
-        {
-            previous_cont->next = current_cont->next;
-            cont->room = NULL;
-            return 1;
-        }
-
-        previous_cont = current_cont;
-        current_cont = current_cont->next;
+        cont->next->prev = cont->prev;
     }
 
-    return 0;
+    cont->prev = NULL;
+    cont->next = NULL;
+    cont->list_room = NULL;
+    cont->room = NULL;
+    return 1;
 }
 
 
@@ -377,12 +378,17 @@ void Room_DoFlip(struct room_s *room1, struct room_s *room2)
                 {
                     room_p alt_room = (room1 == base_room) ? room2 : room1;
                     engine_container_p *ptr = &base_room->content->containers;
+                    engine_container_p tail = NULL;
                     engine_container_p base_room_containers = alt_room->content->containers;
                     alt_room->content->containers = NULL;
                     Room_Disable(alt_room);
                     Room_Enable(base_room);                 // enable new collisions
-                    for(; *ptr; ptr = &((*ptr)->next));
+                    for(; *ptr; tail = *ptr, ptr = &((*ptr)->next));
                     *ptr = base_room_containers;            // base room containerrs enability stay as is
+                    if(base_room_containers)
+                    {
+                        base_room_containers->prev = tail;
+                    }
                     alt_room->content->containers = NULL;
                 }
             }
@@ -391,10 +397,12 @@ void Room_DoFlip(struct room_s *room1, struct room_s *room2)
             for(engine_container_p cont = room1->content->containers; cont; cont = cont->next)
             {
                 cont->room = room1;
+                cont->list_room = room1;
             }
             for(engine_container_p cont = room2->content->containers; cont; cont = cont->next)
             {
                 cont->room = room2;
+                cont->list_room = room2;
             }
         }
     }
@@ -611,28 +619,54 @@ void Room_MoveActiveItems(struct room_s *room_to, struct room_s *room_from)
     engine_container_p t = room_from->content->containers;
 
     room_from->content->containers = NULL;
-    for(; t; t = t->next)
+    while(t)
     {
+        engine_container_p next = t->next;
         t->room = room_to;
+        t->list_room = room_to;
+        t->prev = NULL;
         t->next = room_to->content->containers;
+        if(t->next)
+        {
+            t->next->prev = t;
+        }
         room_to->content->containers = t;
+        t = next;
     }
 }
 
 
+/**
+ * Sprites quads are static: every vertex keeps sprite centre as position
+ * and corner offset along camera right / up axes in normal[0] / normal[1];
+ * billboarding is done by renderer (sprite shader or CPU fallback).
+ */
 void Room_GenSpritesBuffer(struct room_s *room)
 {
     room->content->sprites_vertices = NULL;
+    room->content->sprites_vbo = 0;
 
     if(room->content->sprites_count > 0)
     {
-        room->content->sprites_vertices = (vertex_p)malloc(room->content->sprites_count * 4 * sizeof(vertex_t));
+        room->content->sprites_vertices = (vertex_p)calloc(room->content->sprites_count * 4, sizeof(vertex_t));
         for(uint32_t i = 0; i < room->content->sprites_count; i++)
         {
             room_sprite_p s = room->content->sprites + i;
             if(s->sprite)
             {
                 vertex_p v = room->content->sprites_vertices + i * 4;
+                vec3_copy(v[0].position, s->pos);
+                vec3_copy(v[1].position, s->pos);
+                vec3_copy(v[2].position, s->pos);
+                vec3_copy(v[3].position, s->pos);
+                v[0].normal[0] = s->sprite->right;
+                v[0].normal[1] = s->sprite->top;
+                v[1].normal[0] = s->sprite->left;
+                v[1].normal[1] = s->sprite->top;
+                v[2].normal[0] = s->sprite->left;
+                v[2].normal[1] = s->sprite->bottom;
+                v[3].normal[0] = s->sprite->right;
+                v[3].normal[1] = s->sprite->bottom;
                 vec4_set_one(v[0].color);
                 vec4_set_one(v[1].color);
                 vec4_set_one(v[2].color);
@@ -647,6 +681,11 @@ void Room_GenSpritesBuffer(struct room_s *room)
                 v[3].tex_coord[1] = s->sprite->tex_coord[7];
             }
         }
+
+        qglGenBuffersARB(1, &room->content->sprites_vbo);
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, room->content->sprites_vbo);
+        qglBufferDataARB(GL_ARRAY_BUFFER_ARB, room->content->sprites_count * 4 * sizeof(vertex_t), room->content->sprites_vertices, GL_STATIC_DRAW_ARB);
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
     }
 }
 
@@ -705,7 +744,7 @@ struct room_sector_s *Sector_GetPortalSectorTargetReal(struct room_sector_s *rs)
 }
 
 
-struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector)
+static struct room_sector_s *Sector_FindLowest(struct room_sector_s *sector)
 {
     for(; sector && sector->room_below; sector = Room_GetSectorRaw(sector->room_below->real_room, sector->pos));
 
@@ -713,7 +752,7 @@ struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector)
 }
 
 
-struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector)
+static struct room_sector_s *Sector_FindHighest(struct room_sector_s *sector)
 {
     for(; sector && sector->room_above; sector = Room_GetSectorRaw(sector->room_above->real_room, sector->pos));
 
@@ -721,10 +760,46 @@ struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector)
 }
 
 
+/*
+ * Derived links are NULL until Room_UpdateSectorsDerived call or if chain is broken;
+ * in that case we walk the chain as usual.
+ */
+struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector)
+{
+    return (sector && sector->lowest_sector) ? (sector->lowest_sector) : (Sector_FindLowest(sector));
+}
+
+
+struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector)
+{
+    return (sector && sector->highest_sector) ? (sector->highest_sector) : (Sector_FindHighest(sector));
+}
+
+
+void Room_UpdateSectorsDerived(struct room_s *room)
+{
+    room_sector_p rs = room->sectors;
+    for(uint32_t i = 0; i < room->sectors_count; ++i, ++rs)
+    {
+        rs->lowest_sector = Sector_FindLowest(rs);
+        rs->highest_sector = Sector_FindHighest(rs);
+        rs->derived_flags = 0x00;
+        if(rs->lowest_sector)
+        {
+            rs->derived_flags = rs->lowest_sector->flags;
+        }
+        if(rs->highest_sector)
+        {
+            rs->derived_flags |= rs->highest_sector->flags & SECTOR_FLAG_CLIMB_CEILING;
+        }
+    }
+}
+
+
 void Sector_HighestFloorCorner(room_sector_p rs, float v[3])
 {
-    float *r1 = (rs->floor_corners[0][2] > rs->floor_corners[1][2]) ? (rs->floor_corners[0]) : (rs->floor_corners[1]);
-    float *r2 = (rs->floor_corners[2][2] > rs->floor_corners[3][2]) ? (rs->floor_corners[2]) : (rs->floor_corners[3]);
+    float *r1 = (rs->geometry->floor_corners[0][2] > rs->geometry->floor_corners[1][2]) ? (rs->geometry->floor_corners[0]) : (rs->geometry->floor_corners[1]);
+    float *r2 = (rs->geometry->floor_corners[2][2] > rs->geometry->floor_corners[3][2]) ? (rs->geometry->floor_corners[2]) : (rs->geometry->floor_corners[3]);
 
     if(r1[2] > r2[2])
     {
@@ -739,8 +814,8 @@ void Sector_HighestFloorCorner(room_sector_p rs, float v[3])
 
 void Sector_LowestCeilingCorner(room_sector_p rs, float v[3])
 {
-    float *r1 = (rs->ceiling_corners[0][2] > rs->ceiling_corners[1][2]) ? (rs->ceiling_corners[0]) : (rs->ceiling_corners[1]);
-    float *r2 = (rs->ceiling_corners[2][2] > rs->ceiling_corners[3][2]) ? (rs->ceiling_corners[2]) : (rs->ceiling_corners[3]);
+    float *r1 = (rs->geometry->ceiling_corners[0][2] > rs->geometry->ceiling_corners[1][2]) ? (rs->geometry->ceiling_corners[0]) : (rs->geometry->ceiling_corners[1]);
+    float *r2 = (rs->geometry->ceiling_corners[2][2] > rs->geometry->ceiling_corners[3][2]) ? (rs->geometry->ceiling_corners[2]) : (rs->geometry->ceiling_corners[3]);
 
     if(r1[2] < r2[2])
     {
@@ -759,8 +834,8 @@ int Sectors_SimilarFloor(room_sector_p s1, room_sector_p s2, int ignore_doors)
     if( s1 ==  s2) return 1;
 
     if( (s1->floor != s2->floor) ||
-        (s1->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
-        (s2->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
+        (s1->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
+        (s2->geometry->floor_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
         (!ignore_doors && (s1->room_below || s2->room_below)) )
     {
           return 0;
@@ -768,7 +843,7 @@ int Sectors_SimilarFloor(room_sector_p s1, room_sector_p s2, int ignore_doors)
 
     for(int i = 0; i < 4; i++)
     {
-        if(s1->floor_corners[i][2] != s2->floor_corners[i][2])
+        if(s1->geometry->floor_corners[i][2] != s2->geometry->floor_corners[i][2])
         {
             return 0;
         }
@@ -784,8 +859,8 @@ int Sectors_SimilarCeiling(room_sector_p s1, room_sector_p s2, int ignore_doors)
     if( s1 ==  s2) return 1;
 
     if( (s1->ceiling != s2->ceiling) ||
-        (s1->ceiling_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
-        (s2->ceiling_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
+        (s1->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
+        (s2->geometry->ceiling_penetration_config == TR_PENETRATION_CONFIG_WALL) ||
         (!ignore_doors && (s1->room_above || s2->room_above)) )
     {
           return 0;
@@ -793,7 +868,7 @@ int Sectors_SimilarCeiling(room_sector_p s1, room_sector_p s2, int ignore_doors)
 
     for(int i = 0; i < 4; i++)
     {
-        if(s1->ceiling_corners[i][2] != s2->ceiling_corners[i][2])
+        if(s1->geometry->ceiling_corners[i][2] != s2->geometry->ceiling_corners[i][2])
         {
             return 0;
         }
@@ -124,34 +124,49 @@ typedef struct room_box_s
 }room_box_t, *room_box_p;
 
 
-typedef struct room_sector_s
+/*
+ * Sector cold data: heightmap corners and penetration info. It is used by collision
+ * generation and a few rare checks, so it lives apart from the hot sector fields.
+ */
+typedef struct room_sector_geometry_s
 {
-    uint32_t                    trig_index; // Trigger function index.
-    int32_t                     box_index;
+    float                       ceiling_corners[4][3];
+    uint8_t                     ceiling_diagonal_type;
+    uint8_t                     ceiling_penetration_config;
+
+    float                       floor_corners[4][3];
+    uint8_t                     floor_diagonal_type;
+    uint8_t                     floor_penetration_config;
+}room_sector_geometry_t, *room_sector_geometry_p;
 
-    uint32_t                    flags;      // Climbability, death etc.
-    uint32_t                    material;   // Footstep sound and footsteps.
 
+/*
+ * Sector hot data: fields read by height / flags queries and vertical links
+ * come first (offsets 0 - 63); it is still an array of structs, 112 bytes on
+ * 64 bit targets, so one sector may cross a cache line boundary.
+ */
+typedef struct room_sector_s
+{
     int32_t                     floor;
     int32_t                     ceiling;
-
-    struct trigger_header_s    *trigger;
-    struct room_s              *owner_room;    // Room that contain this sector
+    uint32_t                    flags;          // Climbability, death etc.
+    uint32_t                    derived_flags;  // derived: lowest sector flags + ceiling climb from highest one
+    struct room_sector_s       *lowest_sector;  // derived: end of room_below chain, patched on flips
+    struct room_sector_s       *highest_sector; // derived: end of room_above chain
     struct room_s              *portal_to_room;
-
     struct room_s              *room_below;
     struct room_s              *room_above;
+    struct room_s              *owner_room;     // Room that contain this sector
+
+    struct trigger_header_s    *trigger;
+    float                       pos[3];
     int16_t                     index_x;
     int16_t                     index_y;
-    float                       pos[3];
-
-    float                       ceiling_corners[4][3];
-    uint8_t                     ceiling_diagonal_type;
-    uint8_t                     ceiling_penetration_config;
+    uint32_t                    material;       // Footstep sound and footsteps.
+    uint32_t                    trig_index;     // Trigger function index.
+    int32_t                     box_index;
 
-    float                       floor_corners[4][3];
-    uint8_t                     floor_diagonal_type;
-    uint8_t                     floor_penetration_config;
+    struct room_sector_geometry_s *geometry;    // cold data, allocated right after room sectors array
 }room_sector_t, *room_sector_p;
 
 
@@ -203,9 +218,14 @@ typedef struct room_content_s
     struct static_mesh_s       *static_mesh;
     uint32_t                    sprites_count;
     struct room_sprite_s       *sprites;
-    struct vertex_s            *sprites_vertices;
+    struct vertex_s            *sprites_vertices;                               // sprite centre + corner offsets (in normal) per quad vertex
+    GLuint                      sprites_vbo;                                    // static copy of sprites_vertices
+    class CDynamicBSP          *transparency_bsp;                               // prebuilt static transparency, owned by renderer
     uint32_t                    lights_count;
     struct light_s             *lights;
+    struct light_bins_s        *light_bins;                                     // lights grid, owned by renderer
+    uint32_t                    occluders_count;
+    float                      *occluders;                                      // world triangles v0, v1, v2, normal; owned by renderer
 
     int16_t                     light_mode;                                     // (present only in TR2: 0 is normal, 1 is flickering(?), 2 and 3 are uncertain)
     uint8_t                     reverb_info;                                    // room reverb type
@@ -226,6 +246,7 @@ typedef struct room_s
 
     uint8_t                     is_in_r_list;                                   // is room in render list
     uint8_t                     is_swapped;
+    uint16_t                    vertical_group;                                 // rooms linked by room_above / room_below chains
     uint16_t                    portals_count;                                  // number of room portals
     struct portal_s            *portals;                                        // room portals array
     struct room_s              *alternate_room_next;                            // alternative room pointer
@@ -280,6 +301,7 @@ struct room_sector_s *Sector_GetPortalSectorTargetReal(struct room_sector_s *rs)
 
 struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector);
 struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector);
+void Room_UpdateSectorsDerived(struct room_s *room);
 
 
 void Sector_HighestFloorCorner(room_sector_p rs, float v[3]);
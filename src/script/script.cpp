@@ -433,6 +433,18 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs)
         rs->fog_enabled = lua_tonumber(lua, -1);
         lua_pop(lua, 1);
 
+        lua_getfield(lua, -1, "texture_array");
+        rs->use_texture_array = lua_tonumber(lua, -1);
+        lua_pop(lua, 1);
+
+        lua_getfield(lua, -1, "transparency_mode");
+        rs->transparency_mode = lua_tonumber(lua, -1);
+        lua_pop(lua, 1);
+
+        lua_getfield(lua, -1, "occlusion_culling");
+        rs->occlusion_culling = lua_tonumber(lua, -1);
+        lua_pop(lua, 1);
+
         lua_getfield(lua, -1, "fog_start_depth");
         rs->fog_start_depth = lua_tonumber(lua, -1);
         lua_pop(lua, 1);
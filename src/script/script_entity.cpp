@@ -25,6 +25,7 @@ extern "C" {
 #include "../entity.h"
 #include "../world.h"
 #include "../engine.h"
+#include "../navigation.h"
 
 
 int Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_activator)
@@ -326,6 +327,7 @@ int lua_SetEntityActivationOffset(lua_State * lua)
             {
                 ent->activation_point->offset[3] = lua_tonumber(lua, 5);
             }
+            Entity_UpdateActivationExtent(ent);
         }
         else
         {
@@ -1477,6 +1479,25 @@ int lua_SetEntitySectorStatus(lua_State *lua)
 }
 
 
+int lua_SetEntityBoxBlocked(lua_State *lua)
+{
+    if(lua_gettop(lua) >= 2)
+    {
+        entity_p ent = World_GetEntityByID(lua_tointeger(lua, 1));
+        if(ent)
+        {
+            Nav_SetBoxBlocked(Nav_GetBoxByPos(ent->transform + 12), lua_toboolean(lua, 2));
+        }
+    }
+    else
+    {
+        Con_Warning("setEntityBoxBlocked: expecting arguments (entity_id, value)");
+    }
+
+    return 0;
+}
+
+
 int lua_GetEntityOCB(lua_State * lua)
 {
     if(lua_gettop(lua) >= 1)
@@ -1552,6 +1573,7 @@ int lua_SetEntityFlags(lua_State * lua)
                 {
                     Entity_DisableCollision(ent);
                 }
+                World_UpdateEntityActivity(ent);
             }
             if(!lua_isnil(lua, 3))
             {
@@ -1705,6 +1727,7 @@ int lua_SetEntityStateFlag(lua_State *lua)
                     ent->state_flags &= ~(uint16_t)lua_tointeger(lua, 2);
                 }
             }
+            World_UpdateEntityActivity(ent);
         }
         else
         {
@@ -2565,6 +2588,7 @@ void Script_LuaRegisterEntityFuncs(lua_State *lua)
     lua_register(lua, "setEntityLock", lua_SetEntityLock);
     lua_register(lua, "getEntitySectorStatus", lua_GetEntitySectorStatus);
     lua_register(lua, "setEntitySectorStatus", lua_SetEntitySectorStatus);
+    lua_register(lua, "setEntityBoxBlocked", lua_SetEntityBoxBlocked);
 
     lua_register(lua, "getEntityActivationOffset", lua_GetEntityActivationOffset);
     lua_register(lua, "setEntityActivationOffset", lua_SetEntityActivationOffset);
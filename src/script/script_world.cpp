@@ -94,13 +94,13 @@ int lua_SetSectorFloorConfig(lua_State * lua)
         room_sector_p rs = World_GetRoomSector(id, sx, sy);
         if(rs)
         {
-            if(!lua_isnil(lua, 4))  rs->floor_penetration_config = lua_tointeger(lua, 4);
-            if(!lua_isnil(lua, 5))  rs->floor_diagonal_type = lua_tointeger(lua, 5);
+            if(!lua_isnil(lua, 4))  rs->geometry->floor_penetration_config = lua_tointeger(lua, 4);
+            if(!lua_isnil(lua, 5))  rs->geometry->floor_diagonal_type = lua_tointeger(lua, 5);
             if(!lua_isnil(lua, 6))  rs->floor = lua_tonumber(lua, 6);
-            rs->floor_corners[0][2] = lua_tonumber(lua, 7);
-            rs->floor_corners[1][2] = lua_tonumber(lua, 8);
-            rs->floor_corners[2][2] = lua_tonumber(lua, 9);
-            rs->floor_corners[3][2] = lua_tonumber(lua, 10);
+            rs->geometry->floor_corners[0][2] = lua_tonumber(lua, 7);
+            rs->geometry->floor_corners[1][2] = lua_tonumber(lua, 8);
+            rs->geometry->floor_corners[2][2] = lua_tonumber(lua, 9);
+            rs->geometry->floor_corners[3][2] = lua_tonumber(lua, 10);
         }
         else
         {
@@ -126,13 +126,13 @@ int lua_SetSectorCeilingConfig(lua_State * lua)
         room_sector_p rs = World_GetRoomSector(id, sx, sy);
         if(rs)
         {
-            if(!lua_isnil(lua, 4))  rs->ceiling_penetration_config = lua_tointeger(lua, 4);
-            if(!lua_isnil(lua, 5))  rs->ceiling_diagonal_type = lua_tointeger(lua, 5);
+            if(!lua_isnil(lua, 4))  rs->geometry->ceiling_penetration_config = lua_tointeger(lua, 4);
+            if(!lua_isnil(lua, 5))  rs->geometry->ceiling_diagonal_type = lua_tointeger(lua, 5);
             if(!lua_isnil(lua, 6))  rs->ceiling = lua_tonumber(lua, 6);
-            rs->ceiling_corners[0][2] = lua_tonumber(lua, 7);
-            rs->ceiling_corners[1][2] = lua_tonumber(lua, 8);
-            rs->ceiling_corners[2][2] = lua_tonumber(lua, 9);
-            rs->ceiling_corners[3][2] = lua_tonumber(lua, 10);
+            rs->geometry->ceiling_corners[0][2] = lua_tonumber(lua, 7);
+            rs->geometry->ceiling_corners[1][2] = lua_tonumber(lua, 8);
+            rs->geometry->ceiling_corners[2][2] = lua_tonumber(lua, 9);
+            rs->geometry->ceiling_corners[3][2] = lua_tonumber(lua, 10);
         }
         else
         {
@@ -184,10 +184,10 @@ int lua_SetSectorFlags(lua_State * lua)
         room_sector_p rs = World_GetRoomSector(id, sx, sy);
         if(rs)
         {
-            if(!lua_isnil(lua, 4))  rs->floor_penetration_config = lua_tointeger(lua, 4);
-            if(!lua_isnil(lua, 5))  rs->floor_diagonal_type = lua_tointeger(lua, 5);
-            if(!lua_isnil(lua, 6))  rs->ceiling_penetration_config = lua_tointeger(lua, 6);
-            if(!lua_isnil(lua, 7))  rs->ceiling_diagonal_type = lua_tointeger(lua, 7);
+            if(!lua_isnil(lua, 4))  rs->geometry->floor_penetration_config = lua_tointeger(lua, 4);
+            if(!lua_isnil(lua, 5))  rs->geometry->floor_diagonal_type = lua_tointeger(lua, 5);
+            if(!lua_isnil(lua, 6))  rs->geometry->ceiling_penetration_config = lua_tointeger(lua, 6);
+            if(!lua_isnil(lua, 7))  rs->geometry->ceiling_diagonal_type = lua_tointeger(lua, 7);
         }
         else
         {
@@ -346,6 +346,7 @@ int lua_SectorTriggerClear(lua_State * lua)
                 }
                 free(rs->trigger);
                 rs->trigger = NULL;
+                Trigger_ResetActivators();
             }
         }
         else
@@ -375,6 +376,7 @@ int lua_SectorAddTrigger(lua_State * lua)
         {
             rs->trigger = (trigger_header_p)malloc(sizeof(trigger_header_t));
             rs->trigger->commands = NULL;
+            rs->trigger->watch_state = TRIGGER_WATCH_UNKNOWN;
             rs->trigger->function_value = lua_tointeger(lua, 4);
             rs->trigger->sub_function = lua_tointeger(lua, 5);
             rs->trigger->mask = lua_tointeger(lua, 6);
@@ -429,6 +431,8 @@ int lua_SectorAddTriggerCommand(lua_State * lua)
             trigger_command_p *last = &rs->trigger->commands;
             for(; *last; last = &(*last)->next);
             *last = cmd;
+            rs->trigger->watch_state = TRIGGER_WATCH_UNKNOWN;
+            Trigger_ResetActivators();
         }
         else
         {
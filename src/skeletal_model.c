@@ -12,6 +12,48 @@
 
 void SSBoneFrame_InitSSAnim(struct ss_animation_s *ss_anim, uint32_t anim_type_id);
 
+/*
+ * bones matrices palette; frame data is always contiguous: when the head
+ * passes the middle of the ring the next frame starts from the beginning,
+ * so the previous frame data stays untouched while the new one is written.
+ */
+static struct
+{
+    float      *matrices;
+    uint32_t    size;                                                           // in matrices
+    uint32_t    head;
+    uint32_t    frame_start;
+    uint32_t    frame;
+    uint32_t    overflows;
+} ss_palette = {NULL, 0, 0, 0, 1, 0};
+
+/*
+ * bone tags arrays and override animations pool; freed arrays are kept in
+ * per bones count lists (link is stored in the array itself).
+ */
+static struct
+{
+    ss_bone_tag_p   bone_tags;
+    uint32_t        bone_tags_size;
+    uint32_t        bone_tags_head;
+    uint32_t        bone_tags_used;
+    ss_bone_tag_p  *free_bone_tags;                                             // indexed by bones count
+    uint16_t        max_bones;
+
+    ss_animation_p  anims;
+    uint32_t        anims_size;
+    uint32_t        anims_used;
+    ss_animation_p  free_anims;
+
+    uint32_t        heap_allocs;
+} ss_pool = {NULL, 0, 0, 0, NULL, 0, NULL, 0, 0, NULL, 0};
+
+static ss_bone_tag_p SSPool_AllocBoneTags(uint16_t count);
+static void SSPool_FreeBoneTags(ss_bone_tag_p bone_tags, uint16_t count);
+static ss_animation_p SSPool_AllocAnim();
+static void SSPool_FreeAnim(ss_animation_p ss_anim);
+
+
 void SkeletalModel_Clear(skeletal_model_p model)
 {
     if(model != NULL)
@@ -131,6 +173,32 @@ void SkeletalModel_FillTransparency(skeletal_model_p model)
 }
 
 
+void SkeletalModel_GenAnimsBB(skeletal_model_p model)
+{
+    animation_frame_p anim = model->animations;
+    for(uint16_t i = 0; i < model->animation_count; i++, anim++)
+    {
+        vec3_set_zero(anim->bb_min);
+        vec3_set_zero(anim->bb_max);
+        if(anim->frames_count > 0)
+        {
+            bone_frame_p bf = anim->frames;
+            vec3_copy(anim->bb_min, bf->bb_min);
+            vec3_copy(anim->bb_max, bf->bb_max);
+            bf++;
+            for(uint16_t j = 1; j < anim->frames_count; j++, bf++)
+            {
+                for(int k = 0; k < 3; k++)
+                {
+                    anim->bb_min[k] = (bf->bb_min[k] < anim->bb_min[k]) ? (bf->bb_min[k]) : (anim->bb_min[k]);
+                    anim->bb_max[k] = (bf->bb_max[k] > anim->bb_max[k]) ? (bf->bb_max[k]) : (anim->bb_max[k]);
+                }
+            }
+        }
+    }
+}
+
+
 void SkeletalModel_CopyMeshes(mesh_tree_tag_p dst, mesh_tree_tag_p src, int tags_count)
 {
     for(int i = 0; i < tags_count; i++)
@@ -169,13 +237,15 @@ void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model)
     bf->transform = NULL;
     bf->bone_tag_count = 0;
     bf->bone_tags = NULL;
+    bf->palette_offset = 0;
+    bf->palette_frame = 0;
     
     SSBoneFrame_InitSSAnim(&bf->animations, ANIM_TYPE_BASE);
     bf->animations.model = model;
     if(model)
     {
         bf->bone_tag_count = model->mesh_count;
-        bf->bone_tags = (ss_bone_tag_p)malloc(bf->bone_tag_count * sizeof(ss_bone_tag_t));
+        bf->bone_tags = SSPool_AllocBoneTags(bf->bone_tag_count);
         bf->bone_tags[0].parent = NULL;                                         // root
         for(uint16_t i = 0; i < bf->bone_tag_count; i++)
         {
@@ -252,7 +322,7 @@ void SSBoneFrame_Clear(ss_bone_frame_p bf)
             }
         }
         
-        free(bf->bone_tags);
+        SSPool_FreeBoneTags(bf->bone_tags, bf->bone_tag_count);
         bf->bone_tag_count = 0;
         bf->bone_tags = NULL;
     }
@@ -261,7 +331,7 @@ void SSBoneFrame_Clear(ss_bone_frame_p bf)
     {
         ss_animation_p ss_anim_next = ss_anim->next;
         ss_anim->next = NULL;
-        free(ss_anim);
+        SSPool_FreeAnim(ss_anim);
         ss_anim = ss_anim_next;
     }
     bf->animations.next = NULL;
@@ -355,6 +425,42 @@ void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time)
     {
         SSBoneFrame_TargetBoneToSlerp(bf, ss_anim, time);
     }
+
+    SSBoneFrame_UpdatePalette(bf);
+}
+
+
+/*
+ * Conservative bounds for the current frames interval: stays constant while
+ * lerp goes from current to next frame.
+ */
+void SSBoneFrame_GetIntervalBB(struct ss_bone_frame_s *bf, float bb_min[3], float bb_max[3])
+{
+    skeletal_model_p model = bf->animations.model;
+    bone_frame_p curr_bf = model->animations[bf->animations.current_animation].frames + bf->animations.current_frame;
+    bone_frame_p next_bf = model->animations[bf->animations.next_animation].frames + bf->animations.next_frame;
+
+    for(int i = 0; i < 3; i++)
+    {
+        bb_min[i] = (curr_bf->bb_min[i] < next_bf->bb_min[i]) ? (curr_bf->bb_min[i]) : (next_bf->bb_min[i]);
+        bb_max[i] = (curr_bf->bb_max[i] > next_bf->bb_max[i]) ? (curr_bf->bb_max[i]) : (next_bf->bb_max[i]);
+    }
+}
+
+/*
+ * Conservative bounds for the whole current animation; valid only while
+ * frames interval does not cross animations.
+ */
+int SSBoneFrame_GetAnimBB(struct ss_bone_frame_s *bf, float bb_min[3], float bb_max[3])
+{
+    if(bf->animations.current_animation == bf->animations.next_animation)
+    {
+        animation_frame_p anim = bf->animations.model->animations + bf->animations.current_animation;
+        vec3_copy(bb_min, anim->bb_min);
+        vec3_copy(bb_max, anim->bb_max);
+        return 1;
+    }
+    return 0;
 }
 
 
@@ -505,7 +611,7 @@ struct ss_animation_s *SSBoneFrame_AddOverrideAnim(struct ss_bone_frame_s *bf, s
 {
     if(!sm || (sm->mesh_count == bf->bone_tag_count))
     {
-        ss_animation_p ss_anim = (ss_animation_p)malloc(sizeof(ss_animation_t));
+        ss_animation_p ss_anim = SSPool_AllocAnim();
         SSBoneFrame_InitSSAnim(ss_anim, anim_type_id);
         ss_anim->model = sm;
 
@@ -592,6 +698,219 @@ void SSBoneFrame_DisableOverrideAnim(struct ss_bone_frame_s *bf, uint16_t anim_t
 }
 
 
+/*
+ * BONE FRAMES POOL
+ */
+void SSPool_Init(uint32_t bone_tags_count, uint32_t anims_count, uint16_t max_bones)
+{
+    SSPool_Destroy();
+
+    ss_pool.bone_tags = (ss_bone_tag_p)malloc(bone_tags_count * sizeof(ss_bone_tag_t));
+    ss_pool.bone_tags_size = (ss_pool.bone_tags) ? (bone_tags_count) : (0);
+    ss_pool.max_bones = max_bones;
+    ss_pool.free_bone_tags = (ss_bone_tag_p*)calloc(max_bones + 1, sizeof(ss_bone_tag_p));
+
+    ss_pool.anims = (ss_animation_p)malloc(anims_count * sizeof(ss_animation_t));
+    ss_pool.anims_size = (ss_pool.anims) ? (anims_count) : (0);
+    ss_pool.free_anims = NULL;
+    for(uint32_t i = ss_pool.anims_size; i > 0; i--)
+    {
+        ss_pool.anims[i - 1].next = ss_pool.free_anims;
+        ss_pool.free_anims = ss_pool.anims + i - 1;
+    }
+}
+
+
+void SSPool_Destroy()
+{
+    free(ss_pool.bone_tags);
+    free(ss_pool.free_bone_tags);
+    free(ss_pool.anims);
+    ss_pool.bone_tags = NULL;
+    ss_pool.bone_tags_size = 0;
+    ss_pool.bone_tags_head = 0;
+    ss_pool.bone_tags_used = 0;
+    ss_pool.free_bone_tags = NULL;
+    ss_pool.max_bones = 0;
+    ss_pool.anims = NULL;
+    ss_pool.anims_size = 0;
+    ss_pool.anims_used = 0;
+    ss_pool.free_anims = NULL;
+}
+
+
+void SSPool_GetStats(uint32_t *bone_tags_used, uint32_t *bone_tags_size, uint32_t *anims_used, uint32_t *heap_allocs)
+{
+    *bone_tags_used = ss_pool.bone_tags_used;
+    *bone_tags_size = ss_pool.bone_tags_size;
+    *anims_used = ss_pool.anims_used;
+    *heap_allocs = ss_pool.heap_allocs;
+}
+
+
+static ss_bone_tag_p SSPool_AllocBoneTags(uint16_t count)
+{
+    ss_bone_tag_p ret = NULL;
+
+    if(count <= ss_pool.max_bones)
+    {
+        if(ss_pool.free_bone_tags[count])
+        {
+            ret = ss_pool.free_bone_tags[count];
+            ss_pool.free_bone_tags[count] = *((ss_bone_tag_p*)ret);
+        }
+        else if(ss_pool.bone_tags_head + count <= ss_pool.bone_tags_size)
+        {
+            ret = ss_pool.bone_tags + ss_pool.bone_tags_head;
+            ss_pool.bone_tags_head += count;
+        }
+    }
+
+    if(ret)
+    {
+        ss_pool.bone_tags_used += count;
+        return ret;
+    }
+
+    ss_pool.heap_allocs++;
+    return (ss_bone_tag_p)malloc(count * sizeof(ss_bone_tag_t));
+}
+
+
+static void SSPool_FreeBoneTags(ss_bone_tag_p bone_tags, uint16_t count)
+{
+    if((bone_tags >= ss_pool.bone_tags) && (bone_tags < ss_pool.bone_tags + ss_pool.bone_tags_size))
+    {
+        *((ss_bone_tag_p*)bone_tags) = ss_pool.free_bone_tags[count];
+        ss_pool.free_bone_tags[count] = bone_tags;
+        ss_pool.bone_tags_used -= count;
+    }
+    else
+    {
+        free(bone_tags);
+    }
+}
+
+
+static ss_animation_p SSPool_AllocAnim()
+{
+    if(ss_pool.free_anims)
+    {
+        ss_animation_p ret = ss_pool.free_anims;
+        ss_pool.free_anims = ret->next;
+        ss_pool.anims_used++;
+        return ret;
+    }
+
+    ss_pool.heap_allocs++;
+    return (ss_animation_p)malloc(sizeof(ss_animation_t));
+}
+
+
+static void SSPool_FreeAnim(ss_animation_p ss_anim)
+{
+    if((ss_anim >= ss_pool.anims) && (ss_anim < ss_pool.anims + ss_pool.anims_size))
+    {
+        ss_anim->next = ss_pool.free_anims;
+        ss_pool.free_anims = ss_anim;
+        ss_pool.anims_used--;
+    }
+    else
+    {
+        free(ss_anim);
+    }
+}
+
+
+/*
+ * BONES MATRICES PALETTE
+ */
+void SSPalette_Init(uint32_t matrices_count)
+{
+    SSPalette_Destroy();
+    ss_palette.matrices = (float*)malloc(matrices_count * 16 * sizeof(float));
+    ss_palette.size = (ss_palette.matrices) ? (matrices_count) : (0);
+}
+
+
+void SSPalette_Destroy()
+{
+    if(ss_palette.matrices)
+    {
+        free(ss_palette.matrices);
+    }
+    ss_palette.matrices = NULL;
+    ss_palette.size = 0;
+    ss_palette.head = 0;
+    ss_palette.frame_start = 0;
+    ss_palette.overflows = 0;
+}
+
+
+void SSPalette_BeginFrame()
+{
+    ss_palette.frame++;
+    if(ss_palette.frame == 0)
+    {
+        ss_palette.frame = 1;                                                   // 0 is reserved for "never written"
+    }
+    if(ss_palette.head > ss_palette.size / 2)
+    {
+        ss_palette.head = 0;
+    }
+    ss_palette.frame_start = ss_palette.head;
+}
+
+
+void SSBoneFrame_UpdatePalette(struct ss_bone_frame_s *bf)
+{
+    float *dst;
+    ss_bone_tag_p btag = bf->bone_tags;
+
+    if(!ss_palette.matrices || !bf->bone_tag_count)
+    {
+        return;
+    }
+
+    if(bf->palette_frame != ss_palette.frame)                                   // first update of that frame - take new place
+    {
+        if(ss_palette.head + bf->bone_tag_count > ss_palette.size)
+        {
+            bf->palette_frame = 0;
+            ss_palette.overflows++;
+            return;
+        }
+        bf->palette_offset = ss_palette.head;
+        bf->palette_frame = ss_palette.frame;
+        ss_palette.head += bf->bone_tag_count;
+    }
+
+    dst = ss_palette.matrices + 16 * bf->palette_offset;
+    for(uint16_t i = 0; i < bf->bone_tag_count; i++, btag++, dst += 16)
+    {
+        Mat4_Copy(dst, btag->full_transform);
+    }
+}
+
+
+const float *SSBoneFrame_GetPalette(struct ss_bone_frame_s *bf)
+{
+    if(ss_palette.matrices && (bf->palette_frame == ss_palette.frame))
+    {
+        return ss_palette.matrices + 16 * bf->palette_offset;
+    }
+    return NULL;
+}
+
+
+void SSPalette_GetStats(uint32_t *used, uint32_t *size, uint32_t *overflows)
+{
+    *used = ss_palette.head - ss_palette.frame_start;
+    *size = ss_palette.size;
+    *overflows = ss_palette.overflows;
+}
+
+
 /*
  *******************************************************************************
  */
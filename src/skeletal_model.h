@@ -6,6 +6,10 @@
 extern "C" {
 #endif
 
+#define SS_PALETTE_SIZE             (16384)     // bones palette ring size, in matrices
+#define SS_POOL_SPAWN_RESERVE       (64)        // bone frames reserved for spawned entities and inventory items
+#define SS_POOL_ANIMS_PER_FRAME     (4)         // override animations per bone frame: head tracking and weapons
+
 #define ANIM_CMD_MOVE               0x01
 #define ANIM_CMD_CHANGE_DIRECTION   0x02
 #define ANIM_CMD_JUMP               0x04
@@ -124,6 +128,8 @@ typedef struct ss_bone_frame_s
     float                       bb_max[3];                                      // bounding box max coordinates
     float                       centre[3];                                      // bounding box centre
     float                      *transform;
+    uint32_t                    palette_offset;                                 // first matrix of this frame in bones palette
+    uint32_t                    palette_frame;                                  // palette frame the offset is valid for
 
     struct ss_animation_s       animations;                                     // animations list
 }ss_bone_frame_t, *ss_bone_frame_p;
@@ -223,6 +229,9 @@ typedef struct animation_frame_s
 
     struct animation_frame_s   *next_anim;              // Next default animation
     int32_t                     next_frame;             // Next default frame
+
+    float                       bb_min[3];              // union of all frames bounding boxes
+    float                       bb_max[3];
 }animation_frame_t, *animation_frame_p;
 
 /*
@@ -251,6 +260,7 @@ void SkeletalModel_Clear(skeletal_model_p model);
 void SkeletalModel_GenParentsIndexes(skeletal_model_p model);
 
 void SkeletalModel_FillTransparency(skeletal_model_p model);
+void SkeletalModel_GenAnimsBB(skeletal_model_p model);
 void SkeletalModel_CopyMeshes(mesh_tree_tag_p dst, mesh_tree_tag_p src, int tags_count);
 void BoneFrame_Copy(bone_frame_p dst, bone_frame_p src);
 
@@ -258,6 +268,8 @@ void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model);
 void SSBoneFrame_Clear(ss_bone_frame_p bf);
 void SSBoneFrame_Copy(struct ss_bone_frame_s *dst, struct ss_bone_frame_s *src);
 void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time);
+void SSBoneFrame_GetIntervalBB(struct ss_bone_frame_s *bf, float bb_min[3], float bb_max[3]);
+int  SSBoneFrame_GetAnimBB(struct ss_bone_frame_s *bf, float bb_min[3], float bb_max[3]);
 void SSBoneFrame_RotateBone(struct ss_bone_frame_s *bf, const float q_rotate[4], int bone);
 int  SSBoneFrame_CheckTargetBoneLimit(struct ss_bone_frame_s *bf, struct ss_animation_s *ss_anim);
 void SSBoneFrame_TargetBoneToSlerp(struct ss_bone_frame_s *bf, struct ss_animation_s *ss_anim, float time);
@@ -271,6 +283,26 @@ void SSBoneFrame_EnableOverrideAnim(struct ss_bone_frame_s *bf, struct ss_animat
 void SSBoneFrame_DisableOverrideAnim(struct ss_bone_frame_s *bf, uint16_t anim_type);
 void SSBoneFrame_FillSkinnedMeshMap(ss_bone_frame_p model);
 
+/*
+ * Per-level pool for bone tags arrays and override animations; falls back
+ * to heap (and counts it) when the pool is exhausted or not inited.
+ */
+void     SSPool_Init(uint32_t bone_tags_count, uint32_t anims_count, uint16_t max_bones);
+void     SSPool_Destroy();
+void     SSPool_GetStats(uint32_t *bone_tags_used, uint32_t *bone_tags_size, uint32_t *anims_used, uint32_t *heap_allocs);
+
+/*
+ * Per-frame bones matrices palette: one contiguous ring that every updated
+ * bone frame writes its final (full_transform) matrices into; renderer
+ * uploads model's palette slice as one entity shader uniform array.
+ */
+void     SSPalette_Init(uint32_t matrices_count);
+void     SSPalette_Destroy();
+void     SSPalette_BeginFrame();
+void     SSBoneFrame_UpdatePalette(struct ss_bone_frame_s *bf);
+const float *SSBoneFrame_GetPalette(struct ss_bone_frame_s *bf);
+void     SSPalette_GetStats(uint32_t *used, uint32_t *size, uint32_t *overflows);
+
 void Anim_AddCommand(struct animation_frame_s *anim, const animation_command_p command);
 void Anim_AddEffect(struct animation_frame_s *anim, const animation_effect_p effect);
 struct state_change_s *Anim_FindStateChangeByAnim(struct animation_frame_s *anim, int state_change_anim);
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "core/vmath.h"
+#include "entity.h"
+#include "spatial_hash.h"
+
+
+static struct
+{
+    struct entity_s        *buckets[SPATIAL_BUCKETS_COUNT];
+    spatial_stats_t         stats;
+} spatial;
+
+
+static inline int32_t Spatial_GetCell(float v)
+{
+    return (int32_t)floorf(v / SPATIAL_CELL_SIZE);
+}
+
+
+static inline int32_t Spatial_GetBucket(int32_t cx, int32_t cy)
+{
+    return (int32_t)(((uint32_t)cx * 73856093U) ^ ((uint32_t)cy * 19349663U)) & (SPATIAL_BUCKETS_COUNT - 1);
+}
+
+
+void Spatial_Clear()
+{
+    memset(spatial.buckets, 0, sizeof(spatial.buckets));
+    memset(&spatial.stats, 0, sizeof(spatial.stats));
+}
+
+
+void Spatial_UpdateEntity(struct entity_s *ent)
+{
+    int32_t cx = Spatial_GetCell(ent->transform[12 + 0]);
+    int32_t cy = Spatial_GetCell(ent->transform[12 + 1]);
+
+    if((ent->spatial_bucket != SPATIAL_NO_BUCKET) && (ent->spatial_cell[0] == cx) && (ent->spatial_cell[1] == cy))
+    {
+        return;
+    }
+
+    Spatial_RemoveEntity(ent);
+    ent->spatial_cell[0] = cx;
+    ent->spatial_cell[1] = cy;
+    ent->spatial_bucket = Spatial_GetBucket(cx, cy);
+    ent->spatial_prev = NULL;
+    ent->spatial_next = spatial.buckets[ent->spatial_bucket];
+    if(ent->spatial_next)
+    {
+        ent->spatial_next->spatial_prev = ent;
+    }
+    spatial.buckets[ent->spatial_bucket] = ent;
+    spatial.stats.relinks++;
+}
+
+
+void Spatial_RemoveEntity(struct entity_s *ent)
+{
+    if(ent->spatial_bucket != SPATIAL_NO_BUCKET)
+    {
+        if(ent->spatial_prev)
+        {
+            ent->spatial_prev->spatial_next = ent->spatial_next;
+        }
+        else
+        {
+            spatial.buckets[ent->spatial_bucket] = ent->spatial_next;
+        }
+        if(ent->spatial_next)
+        {
+            ent->spatial_next->spatial_prev = ent->spatial_prev;
+        }
+        ent->spatial_prev = NULL;
+        ent->spatial_next = NULL;
+        ent->spatial_bucket = SPATIAL_NO_BUCKET;
+    }
+}
+
+
+static uint32_t Spatial_Query(const float pos[3], const float dir[3], float cos_limit, float radius, uint16_t type_mask, uint16_t state_mask, struct entity_s **result, uint32_t max_count)
+{
+    uint32_t count = 0;
+    float r2 = radius * radius;
+    int32_t cx_min = Spatial_GetCell(pos[0] - radius);
+    int32_t cx_max = Spatial_GetCell(pos[0] + radius);
+    int32_t cy_min = Spatial_GetCell(pos[1] - radius);
+    int32_t cy_max = Spatial_GetCell(pos[1] + radius);
+
+    spatial.stats.queries++;
+    for(int32_t cx = cx_min; cx <= cx_max; ++cx)
+    {
+        for(int32_t cy = cy_min; cy <= cy_max; ++cy)
+        {
+            for(struct entity_s *ent = spatial.buckets[Spatial_GetBucket(cx, cy)]; ent; ent = ent->spatial_next)
+            {
+                // bucket may be shared by different cells, so every entity is visited once from its own cell
+                if((ent->spatial_cell[0] != cx) || (ent->spatial_cell[1] != cy) ||
+                   (type_mask && !(ent->type_flags & type_mask)) ||
+                   ((ent->state_flags & state_mask) != state_mask))
+                {
+                    continue;
+                }
+
+                float d[3];
+                vec3_sub(d, ent->transform + 12, pos);
+                float dist2 = vec3_dot(d, d);
+                spatial.stats.candidates++;
+                if(dist2 > r2)
+                {
+                    continue;
+                }
+                if(dir)
+                {
+                    float t = vec3_dot(d, dir);
+                    if((t <= 0.0f) || (t * t < cos_limit * cos_limit * dist2))
+                    {
+                        continue;
+                    }
+                }
+
+                if(count < max_count)
+                {
+                    result[count] = ent;
+                }
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+
+uint32_t Spatial_QueryRadius(const float pos[3], float radius, uint16_t type_mask, uint16_t state_mask, struct entity_s **result, uint32_t max_count)
+{
+    return Spatial_Query(pos, NULL, 0.0f, radius, type_mask, state_mask, result, max_count);
+}
+
+
+uint32_t Spatial_QueryCone(const float pos[3], const float dir[3], float cos_limit, float radius, uint16_t type_mask, uint16_t state_mask, struct entity_s **result, uint32_t max_count)
+{
+    return Spatial_Query(pos, dir, cos_limit, radius, type_mask, state_mask, result, max_count);
+}
+
+
+void Spatial_GetStats(spatial_stats_p stats)
+{
+    *stats = spatial.stats;
+}
@@ -0,0 +1,37 @@
+
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <stdint.h>
+
+/*
+ * World-space uniform grid of entities positions (XY plane), hashed into fixed buckets.
+ * Entity is relinked only when it crosses the cell border.
+ */
+#define SPATIAL_CELL_SIZE           (2048.0f)
+#define SPATIAL_BUCKETS_COUNT       (1024)                                      // must be power of 2
+#define SPATIAL_NO_BUCKET           (-1)
+
+struct entity_s;
+
+typedef struct spatial_stats_s
+{
+    uint32_t                relinks;                                            // cell changes
+    uint32_t                queries;
+    uint32_t                candidates;                                         // entities passed to exact tests
+}spatial_stats_t, *spatial_stats_p;
+
+void Spatial_Clear();
+void Spatial_UpdateEntity(struct entity_s *ent);
+void Spatial_RemoveEntity(struct entity_s *ent);
+
+/*
+ * Queries fill result array with entities which have any of type_mask flags (if type_mask != 0)
+ * and all of state_mask flags; return total found count, only first max_count
+ * entities are written, so caller may repeat query with bigger buffer.
+ */
+uint32_t Spatial_QueryRadius(const float pos[3], float radius, uint16_t type_mask, uint16_t state_mask, struct entity_s **result, uint32_t max_count);
+uint32_t Spatial_QueryCone(const float pos[3], const float dir[3], float cos_limit, float radius, uint16_t type_mask, uint16_t state_mask, struct entity_s **result, uint32_t max_count);
+void Spatial_GetStats(spatial_stats_p stats);
+
+#endif
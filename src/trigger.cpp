@@ -74,6 +74,10 @@ inline void Entity_SetLayoutEvent(entity_p ent, uint16_t status)
     }
 }
 
+static uint32_t trigger_evaluated = 0;                                          // this frame
+static uint32_t trigger_watched = 0;
+static uint32_t trigger_skipped = 0;
+
 /*
 -- Does specified flipeffect.
 
@@ -492,6 +496,152 @@ void Trigger_DoCommands(trigger_header_p trigger, struct entity_s *entity_activa
 }
 
 
+static uint16_t Trigger_Classify(trigger_header_p trigger)
+{
+    trigger_command_p command = trigger->commands;
+
+    switch(trigger->sub_function)
+    {
+        case TR_FD_TRIGTYPE_ANTIPAD:
+        case TR_FD_TRIGTYPE_ANTITRIGGER:
+        case TR_FD_TRIGTYPE_HEAVYANTITRIGGER:
+            return TRIGGER_WATCH_CONTINUOUS;                                    // antitriggers act while activator stays on sector
+
+        case TR_FD_TRIGTYPE_SWITCH:
+        case TR_FD_TRIGTYPE_HEAVYSWITCH:
+        case TR_FD_TRIGTYPE_KEY:
+        case TR_FD_TRIGTYPE_PICKUP:
+            if(command && (command->function != TR_FD_TRIGFUNC_OBJECT))
+            {
+                return TRIGGER_WATCH_CONTINUOUS;                                // commands before activator item run every frame
+            }
+            break;
+    };
+
+    if(trigger->timer > 0)
+    {
+        return TRIGGER_WATCH_CONTINUOUS;                                        // timer is re-engaged every frame
+    }
+
+    for(; command; command = command->next)
+    {
+        switch(command->function)
+        {
+            case TR_FD_TRIGFUNC_UWCURRENT:
+            case TR_FD_TRIGFUNC_SET_TARGET:
+            case TR_FD_TRIGFUNC_SET_CAMERA:
+            case TR_FD_TRIGFUNC_ENDLEVEL:
+                return TRIGGER_WATCH_CONTINUOUS;
+        };
+    }
+
+    return TRIGGER_WATCH_EVENT;
+}
+
+
+/*
+ * Packs all activator and switch item state that event trigger result depends on.
+ * Key is taken after evaluation, so the same key means the next evaluation does nothing.
+ */
+static uint32_t Trigger_GetActivatorKey(trigger_header_p trigger, entity_p ent)
+{
+    uint32_t key = ent->trigger_layout | ((uint32_t)ent->move_type << 8);
+
+    key |= (ent->type_flags & ENTITY_TYPE_HEAVYTRIGGER_ACTIVATOR) ? (0x1000) : (0);
+    if(ent->character)
+    {
+        key |= (ent->character->weapon_current_state > 0) ? (0x2000) : (0);
+        key |= (ent->character->state.tightrope) ? (0x4000) : (0);
+        key |= (ent->character->state.crouch) ? (0x8000) : (0);
+    }
+
+    if(trigger)
+    {
+        room_sector_p lowest_sector = (ent->current_sector) ? (Sector_GetLowest(ent->current_sector)) : (NULL);
+        if(lowest_sector && (ent->transform[12 + 2] <= lowest_sector->floor + 16))
+        {
+            key |= 0x10000;
+        }
+
+        for(trigger_command_p command = trigger->commands; command; command = command->next)
+        {
+            if(command->function == TR_FD_TRIGFUNC_OBJECT)
+            {
+                entity_p trig_entity = World_GetEntityByID(command->operands);
+                if(trig_entity)
+                {
+                    key |= (uint32_t)trig_entity->trigger_layout << 17;
+                    key |= (trig_entity->state_flags & ENTITY_STATE_ENABLED) ? (0x2000000) : (0);
+                }
+                break;
+            }
+        }
+    }
+
+    return key;
+}
+
+
+void Trigger_ProcessActivator(trigger_header_p trigger, struct entity_s *ent)
+{
+    if(trigger && (trigger->watch_state == TRIGGER_WATCH_UNKNOWN))
+    {
+        trigger->watch_state = Trigger_Classify(trigger);
+    }
+
+    if(trigger && (trigger->watch_state == TRIGGER_WATCH_CONTINUOUS))
+    {
+        trigger_watched++;
+        Trigger_DoCommands(trigger, ent);
+        ent->trigger_last_valid = 0x00;
+        return;
+    }
+
+    if(ent->trigger_last_valid && (ent->trigger_last == trigger) &&
+       (ent->trigger_key == Trigger_GetActivatorKey(trigger, ent)))
+    {
+        trigger_skipped++;
+        return;
+    }
+
+    trigger_evaluated++;
+    Trigger_DoCommands(trigger, ent);
+    ent->trigger_last = trigger;
+    ent->trigger_last_valid = 0x01;
+    ent->trigger_key = Trigger_GetActivatorKey(trigger, ent);
+}
+
+
+static int Trigger_ResetActivator(entity_p ent, void *data)
+{
+    ent->trigger_last = NULL;
+    ent->trigger_last_valid = 0x00;
+    return 0;
+}
+
+
+void Trigger_ResetActivators()
+{
+    World_IterateAllEntities(Trigger_ResetActivator, NULL);
+}
+
+
+void Trigger_ResetStats()
+{
+    trigger_evaluated = 0;
+    trigger_watched = 0;
+    trigger_skipped = 0;
+}
+
+
+void Trigger_GetStats(uint32_t *evaluated, uint32_t *watched, uint32_t *skipped)
+{
+    *evaluated = trigger_evaluated;
+    *watched = trigger_watched;
+    *skipped = trigger_skipped;
+}
+
+
 void Trigger_TrigMaskToStr(char buf[9], uint8_t flag)
 {
     for(int i = 7; i >= 0; --i)
@@ -129,6 +129,13 @@ typedef struct trigger_command_s
 }trigger_command_t, *trigger_command_p;
 
 
+// Trigger evaluation mode. Event triggers are evaluated only when activator state,
+// that trigger depends on, was changed; continuous ones (UW current, timers, cameras,
+// antitriggers) are watched every frame like before.
+#define TRIGGER_WATCH_UNKNOWN       (0)
+#define TRIGGER_WATCH_EVENT         (1)
+#define TRIGGER_WATCH_CONTINUOUS    (2)
+
 typedef struct trigger_header_s
 {
     uint16_t    function_value;
@@ -136,11 +143,16 @@ typedef struct trigger_header_s
     uint16_t    once : 2;
     uint16_t    timer;
     uint16_t    mask;
+    uint16_t    watch_state;                                                    // classified on first evaluation
     struct trigger_command_s       *commands;
 }trigger_header_t, *trigger_header_p;
 
 
 void Trigger_DoCommands(trigger_header_p trigger, struct entity_s *ent);
+void Trigger_ProcessActivator(trigger_header_p trigger, struct entity_s *ent);
+void Trigger_ResetActivators();
+void Trigger_ResetStats();                                                      // on frame start and level load
+void Trigger_GetStats(uint32_t *evaluated, uint32_t *watched, uint32_t *skipped);
 
 void Trigger_TrigMaskToStr(char buf[8], uint8_t flag);
 void Trigger_TrigTypeToStr(char *buf, uint32_t size, uint32_t func);
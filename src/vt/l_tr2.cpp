@@ -354,8 +354,11 @@ void TR_Level::read_tr2_level(SDL_RWops * const src, bool demo)
     for (i = 0; i < this->overlaps_count; i++)
         this->overlaps[i] = read_bitu16(src);
 
-    // Zones
-    SDL_RWseek(src, this->boxes_count * 20, RW_SEEK_CUR);
+    // Zones: normal and flipped sets, each set has 5 arrays of boxes_count
+    this->zones_count = this->boxes_count * 10;
+    this->zones = (int16_t*)malloc(this->zones_count * sizeof(int16_t));
+    for (i = 0; i < this->zones_count; i++)
+        this->zones[i] = read_bit16(src);
 
     this->animated_textures_count = read_bitu32(src);
     this->animated_textures_uv_count = 0; // No UVRotate in TR2
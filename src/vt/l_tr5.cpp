@@ -771,8 +771,11 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
     for (i = 0; i < this->overlaps_count; i++)
         this->overlaps[i] = read_bitu16(src);
 
-    // Zones
-    SDL_RWseek(src, this->boxes_count * 20, SEEK_CUR);
+    // Zones: normal and flipped sets, each set has 5 arrays of boxes_count
+    this->zones_count = this->boxes_count * 10;
+    this->zones = (int16_t*)malloc(this->zones_count * sizeof(int16_t));
+    for (i = 0; i < this->zones_count; i++)
+        this->zones[i] = read_bit16(src);
 
     this->animated_textures_count = read_bitu32(src);
     this->animated_textures = (uint16_t*)malloc(this->animated_textures_count * sizeof(uint16_t));
@@ -1,6 +1,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_rwops.h>
 
@@ -15,6 +16,7 @@ extern "C" {
 #include "core/gl_util.h"
 #include "core/console.h"
 #include "core/system.h"
+#include "core/mem_arena.h"
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
@@ -39,6 +41,8 @@ extern "C" {
 #include "resource.h"
 #include "inventory.h"
 #include "trigger.h"
+#include "navigation.h"
+#include "spatial_hash.h"
 
 
  struct world_s
@@ -61,6 +65,7 @@ extern "C" {
     bordered_texture_atlas         *tex_atlas;
     uint32_t                        tex_count;              // Number of textures
     GLuint                         *textures;               // OpenGL textures indexes
+    GLuint                          texture_array;          // rooms pages as GL_TEXTURE_2D_ARRAY layers, 0 if not used
 
     uint32_t                        anim_sequences_count;   // Animated texture sequence count
     struct anim_seq_s              *anim_sequences;         // Animated textures
@@ -80,6 +85,17 @@ extern "C" {
     std::map<uint32_t, entity_p>    entity_tree;
     std::map<uint32_t, base_item_p> items_tree;
 
+    uint32_t                        entity_table_size;
+    entity_p                       *entity_table;           // entities indexed by id, O(1) lookup
+    uint32_t                        active_entities_count;
+    uint32_t                        active_entities_size;
+    uint32_t                        active_entities_holes;  // removed during iteration, packed after it
+    uint16_t                        active_entities_iterating;
+    entity_p                       *active_entities;        // dense list of enabled entities
+
+    uint16_t                        vertical_groups_count;
+    uint8_t                        *vertical_groups_dirty;  // groups with flipped rooms, sectors derived data must be patched
+
     uint32_t                        type;
 
     uint32_t                        cameras_sinks_count;    // Amount of cameras and sinks.
@@ -87,6 +103,8 @@ extern "C" {
     uint32_t                        flyby_cameras_count;
     struct flyby_camera_state_s    *flyby_cameras;
     struct flyby_camera_sequence_s *flyby_camera_sequences;
+
+    mem_arena_t                     level_arena;            // immutable level data, released all together in World_Clear
 } global_world;
 
 
@@ -101,6 +119,7 @@ bool Res_CreateEntityFunc(lua_State *lua, const char* func_name, int entity_id);
 
 
 void World_GenTextures(class VT_Level *tr);
+void World_SetTextureParameters(GLenum target);
 void World_GenAnimTextures(class VT_Level *tr);
 void World_GenMeshes(class VT_Level *tr);
 void World_GenSprites(class VT_Level *tr);
@@ -111,6 +130,7 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr);
 void World_GenRooms(class VT_Level *tr);
 void World_GenRoomFlipMap();
 void World_GenSkeletalModels(class VT_Level *tr);
+void World_GenBoneFramesPool(class VT_Level *tr);
 void World_GenEntities(class VT_Level *tr);
 void World_GenBaseItems();
 void World_GenSpritesBuffer();
@@ -118,6 +138,10 @@ void World_GenRoomProperties(class VT_Level *tr);
 void World_GenRoomCollision();
 void World_FixRooms();
 void World_MakeEntityPickable(entity_p ent);                                    // Assign pickup functions to previously created base items.
+void World_UpdateNavFlipState();
+void World_GenSectorsDerived();
+void World_UpdateSectorsDerived();
+void World_MarkSectorsDerivedDirty(room_p room);
 
 
 void World_Prepare()
@@ -136,6 +160,7 @@ void World_Prepare()
     global_world.flip_count = 0;
     global_world.global_flip_state = 0;
     global_world.textures = NULL;
+    global_world.texture_array = 0;
     global_world.type = 0;
     global_world.Character = NULL;
 
@@ -154,6 +179,19 @@ void World_Prepare()
     global_world.skeletal_models = NULL;
     global_world.skeletal_models_count = 0;
     global_world.sky_box = NULL;
+
+    global_world.entity_table_size = 0;
+    global_world.entity_table = NULL;
+    global_world.active_entities_count = 0;
+    global_world.active_entities_size = 0;
+    global_world.active_entities_holes = 0;
+    global_world.active_entities_iterating = 0;
+    global_world.active_entities = NULL;
+
+    global_world.vertical_groups_count = 0;
+    global_world.vertical_groups_dirty = NULL;
+
+    MemArena_Init(&global_world.level_arena, WORLD_LEVEL_ARENA_BLOCK_SIZE);
 }
 
 
@@ -195,6 +233,7 @@ void World_Open(class VT_Level *tr)
 
     // Build all skeletal models. Must be generated before TR_Sector_Calculate() function.
     World_GenSkeletalModels(tr);
+    World_GenBoneFramesPool(tr);        // Must be done before any bone frame creation.
     Gui_DrawLoadScreen(600);
 
     World_GenEntities(tr);              // Build all moveables (entities)
@@ -208,6 +247,7 @@ void World_Open(class VT_Level *tr)
     Gui_DrawLoadScreen(700);
 
     World_GenRoomProperties(tr);
+    World_GenSectorsDerived();
     Gui_DrawLoadScreen(750);
 
     World_GenRoomCollision();
@@ -269,12 +309,24 @@ void World_Clear()
     global_world.Character = NULL;
 
     /* entity empty must be done before rooms destroy */
+    global_world.active_entities_count = 0;
+    global_world.active_entities_holes = 0;
     for(std::pair<const uint32_t, entity_p> &it : global_world.entity_tree)
     {
+        it.second->active_index = -1;
         Entity_Delete(it.second);
         it.second = NULL;
     }
     global_world.entity_tree.clear();
+    Spatial_Clear();
+    Trigger_ResetStats();
+
+    free(global_world.entity_table);
+    global_world.entity_table = NULL;
+    global_world.entity_table_size = 0;
+    free(global_world.active_entities);
+    global_world.active_entities = NULL;
+    global_world.active_entities_size = 0;
 
     /* Now we can delete physics misc objects */
     Physics_CleanUpObjects();
@@ -284,37 +336,34 @@ void World_Clear()
         Room_Clear(global_world.rooms + i);
     }
     global_world.rooms_count = 0;
-    free(global_world.rooms);
     global_world.rooms = NULL;
+    global_world.vertical_groups_dirty = NULL;
+    global_world.vertical_groups_count = 0;
 
     if(global_world.flip_count)
     {
         global_world.flip_count = 0;
         global_world.global_flip_state = 0;
-        free(global_world.flip_map);
-        free(global_world.flip_state);
         global_world.flip_map = NULL;
         global_world.flip_state = NULL;
     }
 
+    Nav_Destroy();
     if(global_world.room_boxes_count)
     {
         global_world.room_boxes_count = 0;
-        free(global_world.room_boxes);
         global_world.room_boxes = NULL;
     }
 
     if(global_world.cameras_sinks_count)
     {
         global_world.cameras_sinks_count = 0;
-        free(global_world.cameras_sinks);
         global_world.cameras_sinks = NULL;
     }
 
     if(global_world.flyby_cameras_count)
     {
         global_world.flyby_cameras_count = 0;
-        free(global_world.flyby_cameras);
         global_world.flyby_cameras = NULL;
     }
 
@@ -343,6 +392,9 @@ void World_Clear()
     }
     global_world.items_tree.clear();
 
+    /* all bone frames are cleared now */
+    SSPool_Destroy();
+
     if(global_world.skeletal_models_count)
     {
         for(uint32_t i = 0; i < global_world.skeletal_models_count; i++)
@@ -366,6 +418,12 @@ void World_Clear()
         global_world.meshes = NULL;
     }
 
+    if(global_world.texture_array)
+    {
+        qglDeleteTextures(1, &global_world.texture_array);
+        global_world.texture_array = 0;
+    }
+
     if(global_world.tex_count)
     {
         qglDeleteTextures(global_world.tex_count, global_world.textures);
@@ -397,6 +455,9 @@ void World_Clear()
         free(global_world.anim_sequences);
         global_world.anim_sequences = NULL;
     }
+
+    /* rooms, sectors, boxes, cameras and other immutable level data */
+    MemArena_Reset(&global_world.level_arena);
 }
 
 
@@ -509,11 +570,10 @@ uint32_t World_SpawnEntity(uint32_t model_id, uint32_t room_id, float pos[3], fl
 struct entity_s *World_GetEntityByID(uint32_t id)
 {
     entity_p ent = NULL;
-    std::map<uint32_t, entity_p>::iterator it = global_world.entity_tree.find(id);
 
-    if(it != global_world.entity_tree.end())
+    if(id < global_world.entity_table_size)
     {
-        ent = it->second;
+        ent = global_world.entity_table[id];
     }
 
     return ent;
@@ -555,6 +615,87 @@ void World_IterateAllEntities(int (*iterator)(struct entity_s *ent, void *data),
 }
 
 
+/*
+ * Iterates only enabled entities. Entities disabled by iterator are skipped at once,
+ * entities enabled by iterator will be processed in the next call.
+ */
+void World_IterateActiveEntities(int (*iterator)(struct entity_s *ent, void *data), void *data)
+{
+    uint32_t count = global_world.active_entities_count;
+
+    global_world.active_entities_iterating++;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        entity_p ent = global_world.active_entities[i];
+        if(ent && iterator(ent, data))
+        {
+            break;
+        }
+    }
+    global_world.active_entities_iterating--;
+
+    if(!global_world.active_entities_iterating && global_world.active_entities_holes)
+    {
+        uint32_t dst = 0;
+        for(uint32_t i = 0; i < global_world.active_entities_count; ++i)
+        {
+            entity_p ent = global_world.active_entities[i];
+            if(ent)
+            {
+                ent->active_index = dst;
+                global_world.active_entities[dst++] = ent;
+            }
+        }
+        global_world.active_entities_count = dst;
+        global_world.active_entities_holes = 0;
+    }
+}
+
+
+uint32_t World_GetActiveEntitiesCount()
+{
+    return global_world.active_entities_count;
+}
+
+
+void World_UpdateEntityActivity(struct entity_s *entity)
+{
+    int is_listed = (entity->active_index >= 0);
+    int is_enabled = (entity->state_flags & ENTITY_STATE_ENABLED) && (World_GetEntityByID(entity->id) == entity);
+
+    if(is_enabled && !is_listed)
+    {
+        if(global_world.active_entities_count >= global_world.active_entities_size)
+        {
+            global_world.active_entities_size = (global_world.active_entities_size) ? (2 * global_world.active_entities_size) : (64);
+            global_world.active_entities = (entity_p*)realloc(global_world.active_entities, global_world.active_entities_size * sizeof(entity_p));
+        }
+        entity->active_index = global_world.active_entities_count;
+        global_world.active_entities[global_world.active_entities_count++] = entity;
+    }
+    else if(!is_enabled && is_listed)
+    {
+        uint32_t index = entity->active_index;
+        entity->active_index = -1;
+        if(global_world.active_entities_iterating)
+        {
+            // keep order stable while somebody walks the list
+            global_world.active_entities[index] = NULL;
+            global_world.active_entities_holes++;
+        }
+        else
+        {
+            entity_p last = global_world.active_entities[--global_world.active_entities_count];
+            global_world.active_entities[index] = last;
+            if(last)
+            {
+                last->active_index = index;
+            }
+        }
+    }
+}
+
+
 struct flyby_camera_sequence_s *World_GetFlyBySequences()
 {
     return global_world.flyby_camera_sequences;
@@ -606,6 +747,15 @@ void World_GetAnimSeqInfo(struct anim_seq_s **seq, uint32_t *seq_count)
 }
 
 
+void World_GetArenaStats(size_t *used, size_t *allocated, uint32_t *blocks_count, uint32_t *allocs)
+{
+    *used = global_world.level_arena.used;
+    *allocated = global_world.level_arena.allocated;
+    *blocks_count = global_world.level_arena.blocks_count;
+    *allocs = global_world.level_arena.allocs;
+}
+
+
 void World_GetFlipInfo(uint8_t **flip_map, uint8_t **flip_state, uint32_t *flip_count)
 {
     *flip_map = global_world.flip_map;
@@ -647,7 +797,27 @@ int World_AddAnimSeq(struct anim_seq_s *seq)
 
 int World_AddEntity(struct entity_s *entity)
 {
+    if(entity->id >= global_world.entity_table_size)
+    {
+        uint32_t new_size = (global_world.entity_table_size) ? (global_world.entity_table_size) : (256);
+        while(new_size <= entity->id)
+        {
+            new_size *= 2;
+        }
+        global_world.entity_table = (entity_p*)realloc(global_world.entity_table, new_size * sizeof(entity_p));
+        memset(global_world.entity_table + global_world.entity_table_size, 0, (new_size - global_world.entity_table_size) * sizeof(entity_p));
+        global_world.entity_table_size = new_size;
+    }
+
+    entity_p old_entity = global_world.entity_table[entity->id];
     global_world.entity_tree[entity->id] = entity;
+    global_world.entity_table[entity->id] = entity;
+    if(old_entity && (old_entity != entity))
+    {
+        World_UpdateEntityActivity(old_entity);
+    }
+    World_UpdateEntityActivity(entity);
+    Spatial_UpdateEntity(entity);
 
     return 1;
 }
@@ -656,6 +826,11 @@ int World_AddEntity(struct entity_s *entity)
 int World_DeleteEntity(struct entity_s *entity)
 {
     global_world.entity_tree.erase(entity->id);
+    if(World_GetEntityByID(entity->id) == entity)
+    {
+        global_world.entity_table[entity->id] = NULL;
+    }
+    World_UpdateEntityActivity(entity);
     Entity_Delete(entity);
 
     return 1;
@@ -871,6 +1046,7 @@ struct room_sector_s *World_GetRoomSector(int room_id, int x, int y)
 
 void World_BuildNearRoomsList(struct room_s *room)
 {
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
     room->near_room_list_size = 0;
     room->near_room_list = (room_t**)Sys_GetTempMem(global_world.rooms_count * sizeof(room_t*));
 
@@ -895,7 +1071,7 @@ void World_BuildNearRoomsList(struct room_s *room)
 
     if(room->near_room_list_size > 0)
     {
-        room_t **p = (room_t**)malloc(room->near_room_list_size * sizeof(room_t*));
+        room_t **p = (room_t**)MemArena_Alloc(&global_world.level_arena, room->near_room_list_size * sizeof(room_t*));
         memcpy(p, room->near_room_list, room->near_room_list_size * sizeof(room_t*));
         room->near_room_list = p;
     }
@@ -903,12 +1079,13 @@ void World_BuildNearRoomsList(struct room_s *room)
     {
         room->near_room_list = NULL;
     }
-    Sys_ReturnTempMem(global_world.rooms_count * sizeof(room_t*));
+    Sys_RollbackTempMem(temp_marker);
 }
 
 
 void World_BuildOverlappedRoomsList(struct room_s *room)
 {
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
     room->overlapped_room_list_size = 0;
     room->overlapped_room_list = (room_t**)Sys_GetTempMem(global_world.rooms_count * sizeof(room_t*));
 
@@ -923,7 +1100,7 @@ void World_BuildOverlappedRoomsList(struct room_s *room)
 
     if(room->overlapped_room_list_size > 0)
     {
-        room_t **p = (room_t**)malloc(room->overlapped_room_list_size * sizeof(room_t*));
+        room_t **p = (room_t**)MemArena_Alloc(&global_world.level_arena, room->overlapped_room_list_size * sizeof(room_t*));
         memcpy(p, room->overlapped_room_list, room->overlapped_room_list_size * sizeof(room_t*));
         room->overlapped_room_list = p;
     }
@@ -931,7 +1108,7 @@ void World_BuildOverlappedRoomsList(struct room_s *room)
     {
         room->overlapped_room_list = NULL;
     }
-    Sys_ReturnTempMem(global_world.rooms_count * sizeof(room_t*));
+    Sys_RollbackTempMem(temp_marker);
 }
 
 /*
@@ -947,6 +1124,7 @@ void World_UpdateFlipCollisions()
         {
             int num_tweens = r->sectors_count * 4;
             size_t buff_size = num_tweens * sizeof(sector_tween_t);
+            mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
             sector_tween_p room_tween = (sector_tween_p)Sys_GetTempMem(buff_size);
 
             // Clear previous dynamic tweens
@@ -972,12 +1150,39 @@ void World_UpdateFlipCollisions()
                 }
             }
 
-            Sys_ReturnTempMem(buff_size);
+            Sys_RollbackTempMem(temp_marker);
         }
     }
 }
 
 
+/*
+ * Navigation uses alternate zones while any room is flipped.
+ */
+void World_MarkSectorsDerivedDirty(room_p room)
+{
+    if(global_world.vertical_groups_dirty)
+    {
+        global_world.vertical_groups_dirty[room->vertical_group] = 0x01;
+    }
+}
+
+
+void World_UpdateNavFlipState()
+{
+    int is_flipped = 0;
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        if(global_world.rooms[i].is_swapped)
+        {
+            is_flipped = 1;
+            break;
+        }
+    }
+    Nav_SetFlipState(is_flipped);
+}
+
+
 uint16_t World_GetGlobalFlipState()
 {
     return global_world.global_flip_state;
@@ -1008,11 +1213,14 @@ void World_SetGlobalFlipState(int flip_state)
             {
                 current_room->is_swapped = !current_room->is_swapped;
                 Room_DoFlip(current_room, current_room->alternate_room_next);
+                World_MarkSectorsDerivedDirty(current_room);
                 global_world.global_flip_state = flip_state;
             }
         }
     }
     World_UpdateFlipCollisions();
+    World_UpdateSectorsDerived();
+    World_UpdateNavFlipState();
 }
 
 
@@ -1055,6 +1263,7 @@ int World_SetFlipState(uint32_t flip_index, uint32_t flip_state)
                 {
                     current_room->is_swapped = !current_room->is_swapped;
                     Room_DoFlip(current_room, current_room->alternate_room_next);
+                    World_MarkSectorsDerivedDirty(current_room);
                     ret = 1;
                 }
             }
@@ -1066,6 +1275,8 @@ int World_SetFlipState(uint32_t flip_index, uint32_t flip_state)
     if(ret)
     {
         World_UpdateFlipCollisions();
+        World_UpdateSectorsDerived();
+        World_UpdateNavFlipState();
     }
 
     return ret;
@@ -1291,42 +1502,65 @@ void World_GenTextures(class VT_Level *tr)
 
     global_world.tex_count = (uint32_t) global_world.tex_atlas->getNumAtlasPages();
     global_world.textures = (GLuint*)malloc(global_world.tex_count * sizeof(GLuint));
+    global_world.texture_array = 0;
+    if(renderer.settings.use_texture_array)
+    {
+        global_world.tex_atlas->setUniformPagesHeight();
+    }
 
     qglPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     qglPixelZoom(1, 1);
     global_world.tex_atlas->createTextures(global_world.textures);
+    World_SetTextureParameters(GL_TEXTURE_2D);
 
-    qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);   // Mag filter is always linear.
+    if(renderer.settings.use_texture_array)
+    {
+        if(global_world.tex_atlas->createTextureArray(&global_world.texture_array))
+        {
+            World_SetTextureParameters(GL_TEXTURE_2D_ARRAY);
+        }
+        else
+        {
+            global_world.texture_array = 0;
+            Con_Warning("texture array is not available, rooms use 2D textures");
+        }
+    }
+}
+
+
+void World_SetTextureParameters(GLenum target)
+{
+    qglTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);         // Mag filter is always linear.
 
     // Select mipmap mode
     switch(renderer.settings.mipmap_mode)
     {
         case 0:
-            qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            qglTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
             break;
 
         case 1:
-            qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+            qglTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
             break;
 
         case 2:
-            qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+            qglTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
             break;
 
         case 3:
         default:
-            qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            qglTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
             break;
     };
 
     // Set mipmaps number
-    qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, renderer.settings.mipmaps);
+    qglTexParameteri(target, GL_TEXTURE_MAX_LEVEL, renderer.settings.mipmaps);
 
     // Set anisotropy degree
-    qglTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, renderer.settings.anisotropy);
+    qglTexParameteri(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, renderer.settings.anisotropy);
 
     // Read lod bias
-    qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_LOD_BIAS, renderer.settings.lod_bias);
+    qglTexParameterf(target, GL_TEXTURE_LOD_BIAS, renderer.settings.lod_bias);
 }
 
 
@@ -1499,7 +1733,7 @@ void World_GenBoxes(class VT_Level *tr)
 
     if(global_world.room_boxes_count)
     {
-        global_world.room_boxes = (room_box_p)malloc(global_world.room_boxes_count * sizeof(room_box_t));
+        global_world.room_boxes = (room_box_p)MemArena_Alloc(&global_world.level_arena, global_world.room_boxes_count * sizeof(room_box_t));
         for(uint32_t i = 0; i < global_world.room_boxes_count; i++)
         {
             global_world.room_boxes[i].overlap_index = tr->boxes[i].overlap_index;
@@ -1510,6 +1744,8 @@ void World_GenBoxes(class VT_Level *tr)
             global_world.room_boxes[i].y_max =-tr->boxes[i].zmin;
         }
     }
+
+    Nav_Init(global_world.room_boxes, global_world.room_boxes_count, tr->overlaps, tr->overlaps_count, tr->zones, tr->zones_count);
 }
 
 
@@ -1520,7 +1756,7 @@ void World_GenCameras(class VT_Level *tr)
 
     if(global_world.cameras_sinks_count)
     {
-        global_world.cameras_sinks = (static_camera_sink_p)malloc(global_world.cameras_sinks_count * sizeof(static_camera_sink_t));
+        global_world.cameras_sinks = (static_camera_sink_p)MemArena_Alloc(&global_world.level_arena, global_world.cameras_sinks_count * sizeof(static_camera_sink_t));
         for(uint32_t i = 0; i < global_world.cameras_sinks_count; i++)
         {
             global_world.cameras_sinks[i].pos[0]              =  tr->cameras[i].x;
@@ -1543,7 +1779,7 @@ void World_GenFlyByCameras(class VT_Level *tr)
     {
         uint32_t start_index = 0;
         flyby_camera_sequence_p *last_seq_ptr = &global_world.flyby_camera_sequences;
-        global_world.flyby_cameras = (flyby_camera_state_p)malloc(global_world.flyby_cameras_count * sizeof(flyby_camera_state_t));
+        global_world.flyby_cameras = (flyby_camera_state_p)MemArena_Alloc(&global_world.level_arena, global_world.flyby_cameras_count * sizeof(flyby_camera_state_t));
         for(uint32_t i = 0; i < global_world.flyby_cameras_count; i++)
         {
             union
@@ -1617,6 +1853,8 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->transform[14] = tr->rooms[room->id].offset.y;                         // z = y;
 
     room->self = (engine_container_p)malloc(sizeof(engine_container_t));
+    room->self->list_room = NULL;
+    room->self->prev = NULL;
     room->self->next = NULL;
     room->self->room = room;
     room->self->object = room;
@@ -1636,8 +1874,13 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->content->static_mesh = NULL;
     room->content->sprites = NULL;
     room->content->sprites_vertices = NULL;
+    room->content->sprites_vbo = 0;
+    room->content->transparency_bsp = NULL;
     room->content->lights_count = 0;
     room->content->lights = NULL;
+    room->content->light_bins = NULL;
+    room->content->occluders_count = 0;
+    room->content->occluders = NULL;
     room->content->light_mode = tr->rooms[room->id].light_mode;
     room->content->reverb_info = tr->rooms[room->id].reverb_info;
     room->content->water_scheme = tr->rooms[room->id].water_scheme;
@@ -1649,7 +1892,9 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     TR_GenRoomMesh(room, room->id, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
     if(room->content->mesh)
     {
+        BaseMesh_SetTextureArray(global_world.texture_array, global_world.textures, global_world.tex_count);
         BaseMesh_GenFaces(room->content->mesh);
+        BaseMesh_SetTextureArray(0, NULL, 0);
     }
     /*
      *  let us load static room meshes
@@ -1767,7 +2012,8 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->sectors_x = tr_room->num_xsectors;
     room->sectors_y = tr_room->num_zsectors;
     room->sectors_count = room->sectors_x * room->sectors_y;
-    room->sectors = (room_sector_p)malloc(room->sectors_count * sizeof(room_sector_t));
+    // hot sectors array is followed by cold geometry array in the same block (flips swap them together)
+    room->sectors = (room_sector_p)MemArena_Alloc(&global_world.level_arena, room->sectors_count * (sizeof(room_sector_t) + sizeof(room_sector_geometry_t)));
 
     /*
      * base sectors information loading and collisional mesh creation
@@ -1792,8 +2038,12 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
         sector->pos[1] = room->transform[13] + sector->index_y * TR_METERING_SECTORSIZE + 0.5f * TR_METERING_SECTORSIZE;
         sector->pos[2] = 0.5f * (tr_room->y_bottom + tr_room->y_top);
 
+        sector->geometry = (room_sector_geometry_p)(room->sectors + room->sectors_count) + i;
         sector->owner_room = room;
         sector->trigger = NULL;
+        sector->lowest_sector = NULL;
+        sector->highest_sector = NULL;
+        sector->derived_flags = 0x00;
 
         if(tr->game_version < TR_III)
         {
@@ -1826,42 +2076,42 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
 
         if(sector->ceiling == TR_METERING_WALLHEIGHT)
         {
-            room->sectors[i].ceiling_penetration_config = TR_PENETRATION_CONFIG_WALL;
+            room->sectors[i].geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_WALL;
         }
         else if(tr_room->sector_list[i].room_above != 0xFF)
         {
-            room->sectors[i].ceiling_penetration_config = TR_PENETRATION_CONFIG_GHOST;
+            room->sectors[i].geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_GHOST;
         }
         else
         {
-            room->sectors[i].ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+            room->sectors[i].geometry->ceiling_penetration_config = TR_PENETRATION_CONFIG_SOLID;
         }
 
         // Reset some sector parameters to avoid garbaged memory issues.
         room->sectors[i].portal_to_room = NULL;
-        room->sectors[i].ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
-        room->sectors[i].floor_diagonal_type   = TR_SECTOR_DIAGONAL_TYPE_NONE;
+        room->sectors[i].geometry->ceiling_diagonal_type = TR_SECTOR_DIAGONAL_TYPE_NONE;
+        room->sectors[i].geometry->floor_diagonal_type   = TR_SECTOR_DIAGONAL_TYPE_NONE;
 
         // Now, we define heightmap cells position and draft (flat) height.
         // Draft height is derived from sector's floor and ceiling values, which are
         // copied into heightmap cells Y coordinates. As result, we receive flat
         // heightmap cell, which will be operated later with floordata.
 
-        room->sectors[i].ceiling_corners[0][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[0][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[0][2] = (float)sector->ceiling;
+        room->sectors[i].geometry->ceiling_corners[0][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[0][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[0][2] = (float)sector->ceiling;
 
-        room->sectors[i].ceiling_corners[1][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[1][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[1][2] = (float)sector->ceiling;
+        room->sectors[i].geometry->ceiling_corners[1][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[1][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[1][2] = (float)sector->ceiling;
 
-        room->sectors[i].ceiling_corners[2][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[2][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[2][2] = (float)sector->ceiling;
+        room->sectors[i].geometry->ceiling_corners[2][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[2][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[2][2] = (float)sector->ceiling;
 
-        room->sectors[i].ceiling_corners[3][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[3][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
-        room->sectors[i].ceiling_corners[3][2] = (float)sector->ceiling;
+        room->sectors[i].geometry->ceiling_corners[3][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[3][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->ceiling_corners[3][2] = (float)sector->ceiling;
 
         // BUILDING FLOOR HEIGHTMAP.
 
@@ -1869,32 +2119,32 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
 
         if(sector->floor == TR_METERING_WALLHEIGHT)
         {
-            room->sectors[i].floor_penetration_config = TR_PENETRATION_CONFIG_WALL;
+            room->sectors[i].geometry->floor_penetration_config = TR_PENETRATION_CONFIG_WALL;
         }
         else if(tr_room->sector_list[i].room_below != 0xFF)
         {
-            room->sectors[i].floor_penetration_config = TR_PENETRATION_CONFIG_GHOST;
+            room->sectors[i].geometry->floor_penetration_config = TR_PENETRATION_CONFIG_GHOST;
         }
         else
         {
-            room->sectors[i].floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
+            room->sectors[i].geometry->floor_penetration_config = TR_PENETRATION_CONFIG_SOLID;
         }
 
-        room->sectors[i].floor_corners[0][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[0][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[0][2] = (float)sector->floor;
+        room->sectors[i].geometry->floor_corners[0][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[0][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[0][2] = (float)sector->floor;
 
-        room->sectors[i].floor_corners[1][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[1][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[1][2] = (float)sector->floor;
+        room->sectors[i].geometry->floor_corners[1][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[1][1] = (float)sector->index_y * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[1][2] = (float)sector->floor;
 
-        room->sectors[i].floor_corners[2][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[2][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[2][2] = (float)sector->floor;
+        room->sectors[i].geometry->floor_corners[2][0] = (float)sector->index_x * TR_METERING_SECTORSIZE + TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[2][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[2][2] = (float)sector->floor;
 
-        room->sectors[i].floor_corners[3][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[3][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
-        room->sectors[i].floor_corners[3][2] = (float)sector->floor;
+        room->sectors[i].geometry->floor_corners[3][0] = (float)sector->index_x * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[3][1] = (float)sector->index_y * TR_METERING_SECTORSIZE;
+        room->sectors[i].geometry->floor_corners[3][2] = (float)sector->floor;
     }
 
     /*
@@ -1903,7 +2153,7 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->content->lights_count = tr_room->num_lights;
     if(room->content->lights_count > 0)
     {
-        room->content->lights = (light_p)malloc(room->content->lights_count * sizeof(light_t));
+        room->content->lights = (light_p)MemArena_Alloc(&global_world.level_arena, room->content->lights_count * sizeof(light_t));
         for(uint16_t i = 0; i < tr_room->num_lights; i++)
         {
             Res_RoomLightCalculate(room->content->lights + i, tr_room->lights + i);
@@ -1999,7 +2249,7 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
 void World_GenRooms(class VT_Level *tr)
 {
     global_world.rooms_count = tr->rooms_count;
-    room_p r = global_world.rooms = (room_p)malloc(global_world.rooms_count * sizeof(room_t));
+    room_p r = global_world.rooms = (room_p)MemArena_Alloc(&global_world.level_arena, global_world.rooms_count * sizeof(room_t));
     for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
     {
         r->id = i;
@@ -2013,8 +2263,8 @@ void World_GenRoomFlipMap()
     // Flipmap count is hardcoded, as no original levels contain such info.
     global_world.flip_count = FLIPMAP_MAX_NUMBER;
 
-    global_world.flip_map   = (uint8_t*)malloc(global_world.flip_count * sizeof(uint8_t));
-    global_world.flip_state = (uint8_t*)malloc(global_world.flip_count * sizeof(uint8_t));
+    global_world.flip_map   = (uint8_t*)MemArena_Alloc(&global_world.level_arena, global_world.flip_count * sizeof(uint8_t));
+    global_world.flip_state = (uint8_t*)MemArena_Alloc(&global_world.level_arena, global_world.flip_count * sizeof(uint8_t));
 
     memset(global_world.flip_map,   0, global_world.flip_count);
     memset(global_world.flip_state, 0, global_world.flip_count);
@@ -2036,10 +2286,35 @@ void World_GenSkeletalModels(class VT_Level *tr)
         smodel->mesh_count = tr_moveable->num_meshes;
         TR_GenSkeletalModel(smodel, i, global_world.meshes, tr);
         SkeletalModel_FillTransparency(smodel);
+        SkeletalModel_GenAnimsBB(smodel);
     }
 }
 
 
+void World_GenBoneFramesPool(class VT_Level *tr)
+{
+    uint32_t bone_tags_count = 0;
+    uint16_t max_bones = 0;
+
+    for(uint32_t i = 0; i < global_world.skeletal_models_count; i++)
+    {
+        if(global_world.skeletal_models[i].mesh_count > max_bones)
+        {
+            max_bones = global_world.skeletal_models[i].mesh_count;
+        }
+    }
+
+    for(uint32_t i = 0; i < tr->items_count; i++)
+    {
+        skeletal_model_p model = World_GetModelByID(tr->items[i].object_id);
+        bone_tags_count += (model) ? (model->mesh_count) : (max_bones);         // model may be overridden by script
+    }
+    bone_tags_count += SS_POOL_SPAWN_RESERVE * max_bones;
+
+    SSPool_Init(bone_tags_count, (tr->items_count + SS_POOL_SPAWN_RESERVE) * SS_POOL_ANIMS_PER_FRAME, max_bones);
+}
+
+
 void World_GenEntities(class VT_Level *tr)
 {
     int top;
@@ -2303,6 +2578,103 @@ void World_GenRoomProperties(class VT_Level *tr)
 }
 
 
+static uint16_t World_FindVerticalGroup(uint16_t *parent, uint16_t i)
+{
+    while(parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+static void World_JoinVerticalGroups(uint16_t *parent, uint32_t a, uint32_t b)
+{
+    uint16_t ra = World_FindVerticalGroup(parent, a);
+    uint16_t rb = World_FindVerticalGroup(parent, b);
+    if(ra != rb)
+    {
+        parent[rb] = ra;
+    }
+}
+
+
+/*
+ * Rooms are grouped by room_above / room_below links (with all alternate rooms),
+ * so flip may change sectors chains only inside groups of flipped rooms.
+ */
+void World_GenSectorsDerived()
+{
+    uint32_t buf_size = global_world.rooms_count * sizeof(uint16_t);
+    mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
+    uint16_t *parent = (uint16_t*)Sys_GetTempMem(buf_size);
+
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        parent[i] = i;
+    }
+
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        room_p r = global_world.rooms + i;
+        if(r->real_room)
+        {
+            World_JoinVerticalGroups(parent, i, r->real_room->id);
+        }
+        if(r->alternate_room_next)
+        {
+            World_JoinVerticalGroups(parent, i, r->alternate_room_next->id);
+        }
+        for(uint32_t j = 0; j < r->sectors_count; j++)
+        {
+            room_sector_p rs = r->sectors + j;
+            if(rs->room_below)
+            {
+                World_JoinVerticalGroups(parent, i, rs->room_below->id);
+            }
+            if(rs->room_above)
+            {
+                World_JoinVerticalGroups(parent, i, rs->room_above->id);
+            }
+        }
+    }
+
+    global_world.vertical_groups_count = 0;
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        if(World_FindVerticalGroup(parent, i) == i)
+        {
+            global_world.rooms[i].vertical_group = global_world.vertical_groups_count++;
+        }
+    }
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        global_world.rooms[i].vertical_group = global_world.rooms[World_FindVerticalGroup(parent, i)].vertical_group;
+        Room_UpdateSectorsDerived(global_world.rooms + i);
+    }
+    Sys_RollbackTempMem(temp_marker);
+
+    global_world.vertical_groups_dirty = (uint8_t*)MemArena_Calloc(&global_world.level_arena, global_world.vertical_groups_count + 1, sizeof(uint8_t));
+}
+
+
+void World_UpdateSectorsDerived()
+{
+    if(global_world.vertical_groups_dirty)
+    {
+        for(uint32_t i = 0; i < global_world.rooms_count; i++)
+        {
+            if(global_world.vertical_groups_dirty[global_world.rooms[i].vertical_group])
+            {
+                Room_UpdateSectorsDerived(global_world.rooms + i);
+            }
+        }
+        memset(global_world.vertical_groups_dirty, 0, global_world.vertical_groups_count * sizeof(uint8_t));
+    }
+}
+
+
 void World_GenRoomCollision()
 {
     room_p r = global_world.rooms;
@@ -2324,6 +2696,7 @@ void World_GenRoomCollision()
 
         int num_tweens = r->sectors_count * 4;
         size_t buff_size = num_tweens * sizeof(sector_tween_t);
+        mem_stack_marker_t temp_marker = Sys_GetTempMemMarker();
         sector_tween_p room_tween = (sector_tween_p)Sys_GetTempMem(buff_size);
 
         // Clear tween array.
@@ -2343,7 +2716,7 @@ void World_GenRoomCollision()
         r->self->collision_group = COLLISION_GROUP_STATIC_ROOM;                 // meshtree
         r->self->collision_shape = COLLISION_SHAPE_TRIMESH;
 
-        Sys_ReturnTempMem(buff_size);
+        Sys_RollbackTempMem(temp_marker);
     }
 }
 
@@ -8,6 +8,8 @@
 #define FLIP_STATE_ON       (0x01)
 #define FLIP_STATE_BY_FLAG  (0x03)
 
+#define WORLD_LEVEL_ARENA_BLOCK_SIZE    (4 * 1024 * 1024)
+
 
 void World_Prepare();
 void World_Open(class VT_Level *tr);
@@ -19,6 +21,9 @@ struct entity_s *World_GetEntityByID(uint32_t id);
 void World_SetPlayer(struct entity_s *entity);
 struct entity_s *World_GetPlayer();
 void World_IterateAllEntities(int (*iterator)(struct entity_s *ent, void *data), void *data);
+void World_IterateActiveEntities(int (*iterator)(struct entity_s *ent, void *data), void *data);
+uint32_t World_GetActiveEntitiesCount();
+void World_UpdateEntityActivity(struct entity_s *entity);
 struct flyby_camera_sequence_s *World_GetFlyBySequences();
 struct base_item_s *World_GetBaseItemByID(uint32_t id);
 struct static_camera_sink_s *World_GetstaticCameraSink(uint32_t id);
@@ -27,6 +32,7 @@ void World_GetSkeletalModelsInfo(struct skeletal_model_s **models, uint32_t *mod
 void World_GetRoomInfo(struct room_s **rooms, uint32_t *rooms_count);
 void World_GetAnimSeqInfo(struct anim_seq_s **seq, uint32_t *seq_count);
 void World_GetFlipInfo(uint8_t **flip_map, uint8_t **flip_state, uint32_t *flip_count);
+void World_GetArenaStats(size_t *used, size_t *allocated, uint32_t *blocks_count, uint32_t *allocs);
 
 int World_AddAnimSeq(struct anim_seq_s *seq);
 int World_AddEntity(struct entity_s *entity);